@@ -0,0 +1,321 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * xfwm4-adopt maps a number of windows on $DISPLAY, starts the window
+ * manager given on the command line and times how long it takes to
+ * adopt them all, that is clientFrameAll () for xfwm4. It is meant to
+ * run on a display without a window manager, typically a fresh Xvfb:
+ *
+ *   Xvfb :9 & DISPLAY=:9 xfwm4-adopt -- ./xfwm4 --compositor=off
+ *
+ * For each count of windows the window manager is started, the time
+ * until the last window is reparented is reported as the total, then
+ * the window manager is terminated with SIGTERM. The server grab is
+ * measured from the outside by a second connection doing round trips,
+ * which cannot complete while another client holds the grab; the longest
+ * one is reported. xfwm4 reports the hold time it sees itself in the
+ * [GRABS] section of its SIGUSR2 state dump.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <glib.h>
+
+/* How long to wait for the window manager to adopt all the windows */
+#define ADOPT_TIMEOUT (30 * G_USEC_PER_SEC)
+
+typedef struct _Adopt Adopt;
+struct _Adopt
+{
+    Display *dpy;
+    Display *probe;
+    int screen;
+    Window root;
+    gchar **command;
+};
+
+typedef struct _AdoptRun AdoptRun;
+struct _AdoptRun
+{
+    guint adopted;
+    gint64 grab;
+    gint64 total;
+};
+
+static gint windows = 0;
+static gint runs = 3;
+
+static int
+ignore_errors (Display *dpy, XErrorEvent *err)
+{
+    /* The window manager may still be reparenting while we clean up */
+    return 0;
+}
+
+static Window *
+create_windows (Adopt *adopt, guint n)
+{
+    XSetWindowAttributes attrs;
+    Window *wins;
+    XEvent ev;
+    gchar *name;
+    guint i, mapped;
+
+    wins = g_new (Window, n);
+    attrs.event_mask = StructureNotifyMask;
+    attrs.background_pixel = WhitePixel (adopt->dpy, adopt->screen);
+    for (i = 0; i < n; i++)
+    {
+        /* Cascaded, so that they do not all overlap completely */
+        wins[i] = XCreateWindow (adopt->dpy, adopt->root,
+                                 (i * 17) % 800, (i * 13) % 600, 320, 240, 0,
+                                 CopyFromParent, InputOutput, CopyFromParent,
+                                 CWEventMask | CWBackPixel, &attrs);
+        name = g_strdup_printf ("xfwm4-adopt %u", i);
+        XStoreName (adopt->dpy, wins[i], name);
+        g_free (name);
+        XMapWindow (adopt->dpy, wins[i]);
+    }
+
+    /* Without a window manager the windows are mapped right away */
+    mapped = 0;
+    while (mapped < n)
+    {
+        XNextEvent (adopt->dpy, &ev);
+        if (ev.type == MapNotify)
+        {
+            mapped++;
+        }
+    }
+
+    return wins;
+}
+
+static void
+destroy_windows (Adopt *adopt, Window *wins, guint n)
+{
+    XEvent ev;
+    guint i;
+
+    for (i = 0; i < n; i++)
+    {
+        XDestroyWindow (adopt->dpy, wins[i]);
+    }
+    XSync (adopt->dpy, False);
+    while (XPending (adopt->dpy))
+    {
+        XNextEvent (adopt->dpy, &ev);
+    }
+    g_free (wins);
+}
+
+static gboolean
+adopt_run (Adopt *adopt, guint n, AdoptRun *run)
+{
+    GHashTable *pending;
+    GError *error = NULL;
+    GPid pid;
+    Window *wins;
+    XEvent ev;
+    gint64 start, deadline, sync_start, stall;
+    guint i;
+
+    wins = create_windows (adopt, n);
+    pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 0; i < n; i++)
+    {
+        g_hash_table_insert (pending, GUINT_TO_POINTER (wins[i]), GUINT_TO_POINTER (wins[i]));
+    }
+
+    XSync (adopt->dpy, False);
+    XSync (adopt->probe, False);
+    start = g_get_monotonic_time ();
+    if (!g_spawn_async (NULL, adopt->command, NULL,
+                        G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                        NULL, NULL, &pid, &error))
+    {
+        g_printerr ("Cannot start %s: %s\n", adopt->command[0], error->message);
+        g_error_free (error);
+        g_hash_table_destroy (pending);
+        destroy_windows (adopt, wins, n);
+        return FALSE;
+    }
+
+    run->grab = 0;
+    run->total = 0;
+    deadline = start + ADOPT_TIMEOUT;
+    while ((g_hash_table_size (pending)) && (g_get_monotonic_time () < deadline))
+    {
+        /* Blocks for as long as the window manager holds the server */
+        sync_start = g_get_monotonic_time ();
+        XSync (adopt->probe, False);
+        stall = g_get_monotonic_time () - sync_start;
+        run->grab = MAX (run->grab, stall);
+
+        if (!XPending (adopt->dpy))
+        {
+            g_usleep (100);
+            continue;
+        }
+        while (XPending (adopt->dpy))
+        {
+            XNextEvent (adopt->dpy, &ev);
+            if ((ev.type == ReparentNotify) && (ev.xreparent.parent != adopt->root))
+            {
+                g_hash_table_remove (pending, GUINT_TO_POINTER (ev.xreparent.window));
+            }
+        }
+        run->total = g_get_monotonic_time () - start;
+    }
+    run->adopted = n - g_hash_table_size (pending);
+
+    kill (pid, SIGTERM);
+    waitpid (pid, NULL, 0);
+    g_spawn_close_pid (pid);
+
+    g_hash_table_destroy (pending);
+    destroy_windows (adopt, wins, n);
+
+    return TRUE;
+}
+
+static gboolean
+adopt_windows (Adopt *adopt, guint n)
+{
+    AdoptRun run;
+    gint64 grab_total, grab_max, total_total, total_max;
+    guint adopted;
+    gint i;
+
+    grab_total = grab_max = 0;
+    total_total = total_max = 0;
+    adopted = n;
+    for (i = 0; i < runs; i++)
+    {
+        if (!adopt_run (adopt, n, &run))
+        {
+            return FALSE;
+        }
+        grab_total += run.grab;
+        grab_max = MAX (grab_max, run.grab);
+        total_total += run.total;
+        total_max = MAX (total_max, run.total);
+        adopted = MIN (adopted, run.adopted);
+    }
+
+    g_print ("%8u %8u %10.1f %10.1f %10.1f %10.1f\n", n, adopted,
+             (gdouble) grab_total / (runs * 1000.0), (gdouble) grab_max / 1000.0,
+             (gdouble) total_total / (runs * 1000.0), (gdouble) total_max / 1000.0);
+
+    if (adopted < n)
+    {
+        g_printerr ("Only %u of %u windows adopted\n", adopted, n);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    Adopt adopt;
+    gboolean success;
+    guint n;
+    GOptionEntry option_entries[] =
+    {
+        { "windows", 'w', 0, G_OPTION_ARG_INT, &windows, "Number of windows (default 25 to 400)", "N" },
+        { "runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Runs for each number of windows (default 3)", "N" },
+        { NULL }
+    };
+
+    context = g_option_context_new ("-- COMMAND [ARGS...]");
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    /* The separator is left in place when the command has options */
+    if ((argc > 1) && (strcmp (argv[1], "--") == 0))
+    {
+        argv++;
+        argc--;
+    }
+    if ((argc < 2) || (windows < 0) || (runs <= 0))
+    {
+        g_printerr ("Usage: %s [--windows=N] [--runs=N] -- COMMAND [ARGS...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    memset (&adopt, 0, sizeof (adopt));
+    adopt.command = &argv[1];
+    adopt.dpy = XOpenDisplay (NULL);
+    adopt.probe = XOpenDisplay (NULL);
+    if ((adopt.dpy == NULL) || (adopt.probe == NULL))
+    {
+        g_printerr ("Cannot open display\n");
+        return EXIT_FAILURE;
+    }
+    XSetErrorHandler (ignore_errors);
+    adopt.screen = DefaultScreen (adopt.dpy);
+    adopt.root = RootWindow (adopt.dpy, adopt.screen);
+
+    g_print ("%8s %8s %10s %10s %10s %10s\n", "windows", "adopted",
+             "grab", "grab max", "total", "total max");
+    success = TRUE;
+    if (windows)
+    {
+        success = adopt_windows (&adopt, windows);
+    }
+    else
+    {
+        for (n = 25; (n <= 400) && (success); n *= 2)
+        {
+            success = adopt_windows (&adopt, n);
+        }
+    }
+    g_print ("msec, the total includes the start of the window manager\n");
+
+    XCloseDisplay (adopt.probe);
+    XCloseDisplay (adopt.dpy);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -46,6 +46,7 @@
 #include "compositor.h"
 #include "focus.h"
 #include "frame.h"
+#include "geometry.h"
 #include "hints.h"
 #include "icons.h"
 #include "misc.h"
@@ -54,6 +55,7 @@
 #include "mywindow.h"
 #include "netwm.h"
 #include "placement.h"
+#include "prefetch.h"
 #include "screen.h"
 #include "session.h"
 #include "settings.h"
@@ -159,7 +161,7 @@ clientUpdateColormaps (Client *c)
         XFree (c->cmap_windows);
         c->ncmap = 0;
     }
-    if (!XGetWMColormapWindows (clientGetXDisplay (c), c->window, &c->cmap_windows, &c->ncmap))
+    if (!getWMColormapWindows (c->screen_info->display_info, c->window, &c->cmap_windows, &c->ncmap))
     {
         c->cmap_windows = NULL;
         c->ncmap = 0;
@@ -477,50 +479,7 @@ clientCoordGravitate (Client *c, int gravity, int mode, int *x, int *y)
     g_return_if_fail (c != NULL);
     TRACE ("entering clientCoordGravitate");
 
-    switch (gravity)
-    {
-        case CenterGravity:
-            dx = (frameLeft (c) - frameRight (c) + 1) / 2;
-            dy = (frameTop (c) - frameBottom (c) + 1) / 2;
-            break;
-        case NorthGravity:
-            dx = (frameLeft (c) - frameRight (c) + 1) / 2;
-            dy = frameTop (c);
-            break;
-        case SouthGravity:
-            dx = (frameLeft (c) - frameRight (c) + 1) / 2;
-            dy = - frameBottom (c);
-            break;
-        case EastGravity:
-            dx = - frameRight (c);
-            dy = (frameTop (c) - frameBottom (c) + 1) / 2;
-            break;
-        case WestGravity:
-            dx = frameLeft (c);
-            dy = (frameTop (c) - frameBottom (c) + 1) / 2;
-            break;
-        case NorthWestGravity:
-            dx = frameLeft (c);
-            dy = frameTop (c);
-            break;
-        case NorthEastGravity:
-            dx = - frameRight (c);
-            dy = frameTop (c);
-            break;
-        case SouthWestGravity:
-            dx = frameLeft (c);
-            dy = - frameBottom (c);
-            break;
-        case SouthEastGravity:
-            dx = - frameRight (c);
-            dy = - frameBottom (c);
-            break;
-        case StaticGravity:
-        default:
-            dx = 0;
-            dy = 0;
-            break;
-    }
+    geometryGravityOffset (gravity, frameLeft (c), frameRight (c), frameTop (c), frameBottom (c), &dx, &dy);
     *x = *x + (dx * mode);
     *y = *y + (dy * mode);
 }
@@ -1075,7 +1034,6 @@ clientGetWMNormalHints (Client *c, gboolean update)
 {
     XWindowChanges wc;
     unsigned long previous_value;
-    long dummy;
 
     g_return_if_fail (c != NULL);
     g_return_if_fail (c->window != None);
@@ -1089,8 +1047,7 @@ clientGetWMNormalHints (Client *c, gboolean update)
     }
     g_assert (c->size);
 
-    dummy = 0;
-    if (!XGetWMNormalHints (clientGetXDisplay (c), c->window, c->size, &dummy))
+    if (!getWMNormalHints (c->screen_info->display_info, c->window, c->size))
     {
         c->size->flags = 0;
     }
@@ -1573,14 +1530,15 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     TRACE ("entering clientFrame");
     TRACE ("framing client (0x%lx)", w);
 
-    gdk_error_trap_push ();
+    myDisplayErrorTrapPush (display_info);
     myDisplayGrabServer (display_info);
 
-    if (!XGetWindowAttributes (display_info->dpy, w, &attr))
+    if (!prefetchGetWindowAttributes (display_info, w, &attr) &&
+        !XGetWindowAttributes (display_info->dpy, w, &attr))
     {
         g_warning ("Cannot get window attributes for window (0x%lx)", w);
         myDisplayUngrabServer (display_info);
-        gdk_error_trap_pop ();
+        myDisplayErrorTrapPopIgnored (display_info);
         return NULL;
     }
 
@@ -1589,7 +1547,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     {
         g_warning ("Cannot determine screen info from window (0x%lx)", w);
         myDisplayUngrabServer (display_info);
-        gdk_error_trap_pop ();
+        myDisplayErrorTrapPopIgnored (display_info);
         return NULL;
     }
 
@@ -1598,7 +1556,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         TRACE ("Not managing our own event window");
         compositorAddWindow (display_info, w, NULL);
         myDisplayUngrabServer (display_info);
-        gdk_error_trap_pop ();
+        myDisplayErrorTrapPopIgnored (display_info);
         return NULL;
     }
 
@@ -1610,7 +1568,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         {
             sendSystrayReqDock (display_info, w, screen_info->systray);
             myDisplayUngrabServer (display_info);
-            gdk_error_trap_pop ();
+            myDisplayErrorTrapPopIgnored (display_info);
             return NULL;
         }
         TRACE ("No systray found for this screen");
@@ -1622,7 +1580,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         TRACE ("Override redirect window 0x%lx", w);
         compositorAddWindow (display_info, w, NULL);
         myDisplayUngrabServer (display_info);
-        gdk_error_trap_pop ();
+        myDisplayErrorTrapPopIgnored (display_info);
         return NULL;
     }
 
@@ -1631,7 +1589,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     {
         TRACE ("Cannot allocate memory for the window structure");
         myDisplayUngrabServer (display_info);
-        gdk_error_trap_pop ();
+        myDisplayErrorTrapPopIgnored (display_info);
         return NULL;
     }
 
@@ -1643,6 +1601,9 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     c->dialog_pid = 0;
     c->dialog_fd = -1;
 
+    /* Ask for all the properties we are about to read at once */
+    prefetchWindowProperties (display_info, &c->window, 1);
+
     getWindowName (display_info, c->window, &c->name);
     getWindowHostname (display_info, c->window, &c->hostname);
     getTransientFor (display_info, screen_info->xroot, c->window, &c->transient_for);
@@ -1694,7 +1655,7 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
         c->button_status[i] = BUTTON_STATE_NORMAL;
     }
 
-    if (!XGetWMColormapWindows (display_info->dpy, c->window, &c->cmap_windows, &c->ncmap))
+    if (!getWMColormapWindows (display_info, c->window, &c->cmap_windows, &c->ncmap))
     {
         c->ncmap = 0;
     }
@@ -1731,8 +1692,8 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
 
     c->class.res_name = NULL;
     c->class.res_class = NULL;
-    XGetClassHint (display_info->dpy, w, &c->class);
-    c->wmhints = XGetWMHints (display_info->dpy, c->window);
+    getClassHint (display_info, w, &c->class);
+    c->wmhints = getWMHints (display_info, c->window);
     c->group_leader = None;
     if (c->wmhints)
     {
@@ -1984,11 +1945,13 @@ clientFrame (DisplayInfo *display_info, Window w, gboolean recapture)
     }
 #endif /* HAVE_XSYNC */
 
+    prefetchCacheWindow (display_info, c->window);
+
     /* Window is reparented now, so we can safely release the grab
      * on the server
      */
     myDisplayUngrabServer (display_info);
-    gdk_error_trap_pop ();
+    myDisplayErrorTrapPopIgnored (display_info);
 
     DBG ("client \"%s\" (0x%lx) is now managed", c->name, c->window);
     DBG ("client_count=%d", screen_info->client_count);
@@ -2016,9 +1979,10 @@ clientUnframe (Client *c, gboolean remap)
 
     clientRemoveFromList (c);
     compositorSetClient (display_info, c->frame, NULL);
+    prefetchDiscard (display_info, c->window);
 
     myDisplayGrabServer (display_info);
-    gdk_error_trap_push ();
+    myDisplayErrorTrapPush (display_info);
     clientRemoveUserTimeWin (c);
     clientUngrabButtons (c);
     XUnmapWindow (display_info->dpy, c->frame);
@@ -2079,7 +2043,7 @@ clientUnframe (Client *c, gboolean remap)
     XDestroyWindow (display_info->dpy, c->frame);
 
     myDisplayUngrabServer (display_info);
-    gdk_error_trap_pop ();
+    myDisplayErrorTrapPopIgnored (display_info);
     clientFree (c);
 }
 
@@ -2089,8 +2053,8 @@ clientFrameAll (ScreenInfo *screen_info)
     DisplayInfo *display_info;
     XWindowAttributes attr;
     xfwmWindow shield;
-    Window w1, w2, *wins;
-    unsigned int count, i;
+    Window w1, w2, *wins, *viewable;
+    unsigned int count, n_viewable, i, j;
 
     TRACE ("entering clientFrameAll");
 
@@ -2109,29 +2073,63 @@ clientFrameAll (ScreenInfo *screen_info)
     XSync (display_info->dpy, FALSE);
     myDisplayGrabServer (display_info);
     XQueryTree (display_info->dpy, screen_info->xroot, &w1, &w2, &wins, &count);
+
+    /*
+     * Read everything we need from all the windows up front, so that
+     * framing them does not cost a few dozen round trips each while
+     * the server is grabbed.
+     */
+    prefetchWindowAttributes (display_info, wins, count);
+    viewable = g_new (Window, count + 1);
+    n_viewable = 0;
     for (i = 0; i < count; i++)
     {
-        XGetWindowAttributes (display_info->dpy, wins[i], &attr);
-        if ((attr.map_state == IsViewable) && (attr.root == screen_info->xroot))
+        if ((prefetchGetWindowAttributes (display_info, wins[i], &attr) ||
+             XGetWindowAttributes (display_info->dpy, wins[i], &attr)) &&
+            (attr.map_state == IsViewable) && (attr.root == screen_info->xroot))
+        {
+            viewable[n_viewable++] = wins[i];
+        }
+    }
+    prefetchWindowProperties (display_info, viewable, n_viewable);
+
+    /* Keep the stacking order, viewable is a subset of wins in the same order */
+    for (i = 0, j = 0; i < count; i++)
+    {
+        if ((j < n_viewable) && (wins[i] == viewable[j]))
         {
             Client *c = clientFrame (display_info, wins[i], TRUE);
             if ((c) && ((screen_info->params->raise_on_click) || (screen_info->params->click_to_focus)))
             {
                 clientGrabMouseButton (c);
             }
+            j++;
         }
         else
         {
              compositorAddWindow (display_info, wins[i], NULL);
         }
     }
+
+    /* Windows which were not framed in the end */
+    for (i = 0; i < count; i++)
+    {
+        if (!myDisplayGetClientFromWindow (display_info, wins[i], SEARCH_WINDOW))
+        {
+            prefetchDiscard (display_info, wins[i]);
+        }
+    }
+
+    /* The prefetched data is only accurate under the grab, we're done with it */
+    myDisplayUngrabServer (display_info);
+
+    g_free (viewable);
     if (wins)
     {
         XFree (wins);
     }
     clientFocusTop (screen_info, WIN_LAYER_FULLSCREEN, myDisplayGetCurrentTime (display_info));
     xfwmWindowDelete (&shield);
-    myDisplayUngrabServer (display_info);
     XSync (display_info->dpy, FALSE);
 }
 
@@ -2321,6 +2319,10 @@ clientShowSingle (Client *c, gboolean deiconify)
     {
         TRACE ("showing client \"%s\" (0x%lx)", c->name, c->window);
         FLAG_SET (c->xfwm_flags, XFWM_FLAG_VISIBLE);
+        if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+        {
+            clientInvalidateWorkArea (screen_info);
+        }
         XMapWindow (display_info->dpy, c->frame);
         if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
         {
@@ -2382,6 +2384,10 @@ clientWithdrawSingle (Client *c, GList *exclude_list, gboolean iconify)
     if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE))
     {
         FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_VISIBLE);
+        if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+        {
+            clientInvalidateWorkArea (screen_info);
+        }
         c->ignore_unmap++;
         /* Adjust to urgency state as the window is not visible */
         clientUpdateUrgency (c);
@@ -2532,7 +2538,7 @@ clientToggleShowDesktop (ScreenInfo *screen_info)
     }
     else
     {
-        for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+        for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
         {
             Client *c = (Client *) list->data;
             if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_WAS_SHOWN))
@@ -2714,7 +2720,7 @@ clientSetLayer (Client *c, guint l)
         {
             TRACE ("setting client \"%s\" (0x%lx) layer to %d", c2->name,
                 c2->window, l);
-            c2->win_layer = l;
+            clientSetStackingLayer (c2, l);
         }
     }
     g_list_free (list_of_windows);
@@ -286,6 +286,14 @@ struct _Client
     xfwmWindow buttons[BUTTON_COUNT];
     Window client_leader;
     Window group_leader;
+    /* Where this client is filed in the transient relations, see transients.c */
+    Window transient_key;
+    Window group_key;
+    guint transient_mark;
+    /* Position in the stacking order, see stacking.c */
+    GList *stack_link;
+    GSequenceIter *layer_iter;
+    guint64 stack_key;
     xfwmPixmap appmenu[STATE_TOGGLED];
     Colormap cmap;
     unsigned long win_layer;
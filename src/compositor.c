@@ -34,6 +34,7 @@
 
 #include <glib.h>
 #include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include <libxfce4util/libxfce4util.h>
 
@@ -48,10 +49,12 @@
 #endif /* HAVE_LIBDRM */
 
 #include "display.h"
+#include "prefetch.h"
 #include "screen.h"
 #include "client.h"
 #include "frame.h"
 #include "hints.h"
+#include "xsync.h"
 #include "compositor.h"
 
 #ifdef HAVE_COMPOSITOR
@@ -147,6 +150,22 @@ struct _CWindow
     gint shadow_height;
 
     guint32 opacity;
+
+    guint64 damage_count;
+
+    /* Last good contents, stretched during resize until the client redraws */
+    Picture stretch_picture;
+    gint stretch_width;
+    gint stretch_height;
+    guint stretch_timeout_id;
+
+#ifdef HAVE_XSYNC
+    /* Extended frame sync, see clientXSyncFrameComplete () */
+    gboolean frame_deferred;
+    gboolean frame_drawn_pending;
+    XSyncValue frame_value;
+    guint frame_timeout_id;
+#endif /* HAVE_XSYNC */
 };
 
 static CWindow*
@@ -211,7 +230,7 @@ is_shaped (DisplayInfo *display_info, Window id)
 static gboolean
 is_fullscreen (CWindow *cw)
 {
-    GdkRectangle rect;
+    GdkRectangle area, rect;
 
     /* First, check the good old way, the window is larger than the screen size */
     if (WIN_IS_FULLSCREEN(cw))
@@ -220,10 +239,11 @@ is_fullscreen (CWindow *cw)
     }
 
     /* Next check against the monitors which compose the entire screen */
-    myScreenFindMonitorAtPoint (cw->screen_info,
-                                cw->attr.x + (cw->attr.width + 2 * cw->attr.border_width) / 2,
-                                cw->attr.y + (cw->attr.height + 2 * cw->attr.border_width) / 2,
-                                &rect);
+    area.x = cw->attr.x;
+    area.y = cw->attr.y;
+    area.width = cw->attr.width + 2 * cw->attr.border_width;
+    area.height = cw->attr.height + 2 * cw->attr.border_width;
+    myScreenFindMonitorForRect (cw->screen_info, &area, &rect);
 
     return ((cw->attr.x == rect.x) &&
             (cw->attr.y == rect.y) &&
@@ -762,6 +782,18 @@ free_win_data (CWindow *cw, gboolean delete)
         cw->picture = None;
     }
 
+    if (cw->stretch_timeout_id)
+    {
+        g_source_remove (cw->stretch_timeout_id);
+        cw->stretch_timeout_id = 0;
+    }
+
+    if (cw->stretch_picture)
+    {
+        XRenderFreePicture (display_info->dpy, cw->stretch_picture);
+        cw->stretch_picture = None;
+    }
+
     if (cw->shadow)
     {
         XRenderFreePicture (display_info->dpy, cw->shadow);
@@ -812,6 +844,14 @@ free_win_data (CWindow *cw, gboolean delete)
 
     if (delete)
     {
+#ifdef HAVE_XSYNC
+        if (cw->frame_timeout_id)
+        {
+            g_source_remove (cw->frame_timeout_id);
+            cw->frame_timeout_id = 0;
+        }
+#endif /* HAVE_XSYNC */
+
         /* No need to keep this around */
         if (cw->saved_picture)
         {
@@ -961,6 +1001,106 @@ paint_root (ScreenInfo *screen_info)
                       screen_info->height);
 }
 
+static void
+get_win_bounds (CWindow *cw, XRectangle *r)
+{
+    XRectangle sr;
+
+    TRACE ("entering get_win_bounds");
+
+    r->x = cw->attr.x;
+    r->y = cw->attr.y;
+    r->width = cw->attr.width + cw->attr.border_width * 2;
+    r->height = cw->attr.height + cw->attr.border_width * 2;
+
+    if (!(cw->shadow))
+    {
+        return;
+    }
+
+    sr.x = cw->attr.x + cw->shadow_dx;
+    sr.y = cw->attr.y + cw->shadow_dy;
+    sr.width = cw->shadow_width;
+    sr.height = cw->shadow_height;
+
+    if (sr.x < r->x)
+    {
+        r->width = (r->x + r->width) - sr.x;
+        r->x = sr.x;
+    }
+    if (sr.y < r->y)
+    {
+        r->height = (r->y + r->height) - sr.y;
+        r->y = sr.y;
+    }
+    if (sr.x + sr.width > r->x + r->width)
+    {
+        r->width = sr.x + sr.width - r->x;
+    }
+    if (sr.y + sr.height > r->y + r->height)
+    {
+        r->height = sr.y + sr.height - r->y;
+    }
+}
+
+/* The outline is made of its four edges, so moving it damages only those */
+static gint
+get_outline_rects (ScreenInfo *screen_info, XRectangle *rects)
+{
+    XRectangle *r;
+    guint w;
+
+    r = &screen_info->outline;
+    w = screen_info->outline_width;
+    if ((r->width <= 2 * w) || (r->height <= 2 * w))
+    {
+        rects[0] = *r;
+        return 1;
+    }
+
+    rects[0].x = r->x;
+    rects[0].y = r->y;
+    rects[0].width = r->width;
+    rects[0].height = w;
+
+    rects[1].x = r->x;
+    rects[1].y = r->y + r->height - w;
+    rects[1].width = r->width;
+    rects[1].height = w;
+
+    rects[2].x = r->x;
+    rects[2].y = r->y + w;
+    rects[2].width = w;
+    rects[2].height = r->height - 2 * w;
+
+    rects[3].x = r->x + r->width - w;
+    rects[3].y = r->y + w;
+    rects[3].width = w;
+    rects[3].height = r->height - 2 * w;
+
+    return 4;
+}
+
+static gboolean
+rect_intersect (XRectangle *r1, XRectangle *r2)
+{
+    return ((r1->x < r2->x + (gint) r2->width) && (r2->x < r1->x + (gint) r1->width) &&
+            (r1->y < r2->y + (gint) r2->height) && (r2->y < r1->y + (gint) r1->height));
+}
+
+static void
+rect_union (XRectangle *dest, XRectangle *r)
+{
+    gint x2, y2;
+
+    x2 = MAX (dest->x + (gint) dest->width, r->x + (gint) r->width);
+    y2 = MAX (dest->y + (gint) dest->height, r->y + (gint) r->height);
+    dest->x = MIN (dest->x, r->x);
+    dest->y = MIN (dest->y, r->y);
+    dest->width = x2 - dest->x;
+    dest->height = y2 - dest->y;
+}
+
 static XserverRegion
 win_extents (CWindow *cw)
 {
@@ -973,10 +1113,6 @@ win_extents (CWindow *cw)
 
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
-    r.x = cw->attr.x;
-    r.y = cw->attr.y;
-    r.width = cw->attr.width + cw->attr.border_width * 2;
-    r.height = cw->attr.height + cw->attr.border_width * 2;
 
     /*
        We apply a shadow to the window if:
@@ -1001,8 +1137,6 @@ win_extents (CWindow *cw)
               !WIN_IS_OVERRIDE(cw) &&
               (!WIN_IS_SHAPED(cw))))
     {
-        XRectangle sr;
-
         TRACE ("window 0x%lx has extents", cw->id);
         cw->shadow_dx = SHADOW_OFFSET_X + screen_info->params->shadow_delta_x;
         cw->shadow_dy = SHADOW_OFFSET_Y + screen_info->params->shadow_delta_y;
@@ -1020,36 +1154,14 @@ win_extents (CWindow *cw)
                                          cw->attr.height + 2 * cw->attr.border_width,
                                          &cw->shadow_width, &cw->shadow_height);
         }
-
-        sr.x = cw->attr.x + cw->shadow_dx;
-        sr.y = cw->attr.y + cw->shadow_dy;
-        sr.width = cw->shadow_width;
-        sr.height = cw->shadow_height;
-
-        if (sr.x < r.x)
-        {
-            r.width = (r.x + r.width) - sr.x;
-            r.x = sr.x;
-        }
-        if (sr.y < r.y)
-        {
-            r.height = (r.y + r.height) - sr.y;
-            r.y = sr.y;
-        }
-        if (sr.x + sr.width > r.x + r.width)
-        {
-            r.width = sr.x + sr.width - r.x;
-        }
-        if (sr.y + sr.height > r.y + r.height)
-        {
-            r.height = sr.y + sr.height - r.y;
-        }
     }
     else if (cw->shadow)
     {
         XRenderFreePicture (display_info->dpy, cw->shadow);
         cw->shadow = None;
     }
+    get_win_bounds (cw, &r);
+
     return XFixesCreateRegion (display_info->dpy, &r, 1);
 }
 
@@ -1157,6 +1269,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
 {
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
+    Picture picture;
     gboolean paint_solid;
 
     g_return_if_fail (cw != NULL);
@@ -1165,6 +1278,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
     paint_solid = ((solid_part) && WIN_IS_OPAQUE(cw));
+    picture = (cw->stretch_picture) ? cw->stretch_picture : cw->picture;
 
     if (WIN_HAS_FRAME(cw) && (screen_info->params->frame_opacity < 100))
     {
@@ -1198,7 +1312,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
             }
 
             /* Top Border (title bar) */
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaBorderPict,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaBorderPict,
                               screen_info->rootBuffer,
                               0, 0,
                               0, 0,
@@ -1206,14 +1320,14 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
                               frame_width, frame_top);
 
             /* Bottom Border */
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaBorderPict,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaBorderPict,
                               screen_info->rootBuffer,
                               0, frame_height - frame_bottom,
                               0, 0,
                               frame_x, frame_y + frame_height - frame_bottom,
                               frame_width, frame_bottom);
             /* Left Border */
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaBorderPict,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaBorderPict,
                               screen_info->rootBuffer,
                               0, frame_top,
                               0, 0,
@@ -1221,7 +1335,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
                               frame_left, frame_height - frame_top - frame_bottom);
 
             /* Right Border */
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaBorderPict,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaBorderPict,
                               screen_info->rootBuffer,
                               frame_width - frame_right, frame_top,
                               0, 0,
@@ -1236,7 +1350,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
             XserverRegion client_region;
 
             XFixesSetPictureClipRegion (display_info->dpy, screen_info->rootBuffer, 0, 0, region);
-            XRenderComposite (display_info->dpy, PictOpSrc, cw->picture, None,
+            XRenderComposite (display_info->dpy, PictOpSrc, picture, None,
                               screen_info->rootBuffer,
                               frame_left, frame_top,
                               0, 0,
@@ -1253,7 +1367,7 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
         }
         else if (!solid_part)
         {
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaPict,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaPict,
                               screen_info->rootBuffer,
                               frame_left, frame_top,
                               0, 0,
@@ -1270,13 +1384,13 @@ paint_win (CWindow *cw, XserverRegion region, gboolean solid_part)
         if (paint_solid)
         {
             XFixesSetPictureClipRegion (display_info->dpy, screen_info->rootBuffer, 0, 0, region);
-            XRenderComposite (display_info->dpy, PictOpSrc, cw->picture, None, screen_info->rootBuffer,
+            XRenderComposite (display_info->dpy, PictOpSrc, picture, None, screen_info->rootBuffer,
                               0, 0, 0, 0, x, y, w, h);
             XFixesSubtractRegion (display_info->dpy, region, region, cw->borderSize);
         }
         else if (!solid_part)
         {
-            XRenderComposite (display_info->dpy, PictOpOver, cw->picture, cw->alphaPict, screen_info->rootBuffer,
+            XRenderComposite (display_info->dpy, PictOpOver, picture, cw->alphaPict, screen_info->rootBuffer,
                               0, 0, 0, 0, x, y, w, h);
         }
     }
@@ -1308,7 +1422,9 @@ close_dri (ScreenInfo *screen_info)
 static gboolean
 dri_enabled (ScreenInfo *screen_info)
 {
-    return (screen_info->dri_fd != -1 && screen_info->params->sync_to_vblank);
+    /* The vertical blank of a single DRM pipe cannot pace outputs with different rates */
+    return (screen_info->dri_fd != -1 && screen_info->params->sync_to_vblank &&
+            screen_info->outputs->len == 1);
 }
 
 static void
@@ -1371,7 +1487,7 @@ wait_vblank (ScreenInfo *screen_info)
 #endif /* HAVE_LIBDRM */
 
 #ifdef HAVE_RANDR
-static void
+static gint
 get_refresh_rate (ScreenInfo* screen_info)
 {
     gint refresh_rate;
@@ -1381,13 +1497,187 @@ get_refresh_rate (ScreenInfo* screen_info)
     refresh_rate = XRRConfigCurrentRate (randr_info);
     XRRFreeScreenConfigInfo (randr_info);
 
+    return refresh_rate;
+}
+
+static gint
+get_mode_refresh_rate (XRRScreenResources *resources, RRMode mode)
+{
+    XRRModeInfo *mode_info;
+    gdouble v_total;
+    gint i;
+
+    for (i = 0; i < resources->nmode; i++)
+    {
+        mode_info = &resources->modes[i];
+        if (mode_info->id != mode)
+        {
+            continue;
+        }
+        if ((mode_info->hTotal == 0) || (mode_info->vTotal == 0))
+        {
+            return 0;
+        }
+
+        v_total = (gdouble) mode_info->vTotal;
+        if (mode_info->modeFlags & RR_DoubleScan)
+        {
+            v_total *= 2.0;
+        }
+        if (mode_info->modeFlags & RR_Interlace)
+        {
+            v_total /= 2.0;
+        }
+
+        return (gint) (mode_info->dotClock / (mode_info->hTotal * v_total) + 0.5);
+    }
+
+    return 0;
+}
+#endif /* HAVE_RANDR */
+
+static CompositorOutput *
+add_output (ScreenInfo *screen_info, gint x, gint y, guint width, guint height, gint refresh_rate)
+{
+    CompositorOutput *output;
+    guint i;
+
+    /* Cloned outputs show the same pixels, paint them at the fastest rate */
+    for (i = 0; i < screen_info->outputs->len; i++)
+    {
+        output = g_ptr_array_index (screen_info->outputs, i);
+        if ((output->area.x == x) && (output->area.y == y) &&
+            (output->area.width == width) && (output->area.height == height))
+        {
+            output->refresh_rate = MAX (output->refresh_rate, refresh_rate);
+            return output;
+        }
+    }
+
+    output = g_new0 (CompositorOutput, 1);
+    output->screen_info = screen_info;
+    output->area.x = x;
+    output->area.y = y;
+    output->area.width = width;
+    output->area.height = height;
+    output->refresh_rate = refresh_rate;
+    output->damage = None;
+    output->timeout_id = 0;
+    g_ptr_array_add (screen_info->outputs, output);
+
+    return output;
+}
+
+static void
+free_outputs (ScreenInfo *screen_info)
+{
+    DisplayInfo *display_info;
+    CompositorOutput *output;
+    guint i;
+
+    display_info = screen_info->display_info;
+    for (i = 0; i < screen_info->outputs->len; i++)
+    {
+        output = g_ptr_array_index (screen_info->outputs, i);
+
+        DBG ("Output %ix%i+%i+%i at %i Hz: %" G_GUINT64_FORMAT " frames, "
+             "%" G_GUINT64_FORMAT " late, %" G_GINT64_FORMAT " usec max paint time",
+             output->area.width, output->area.height, output->area.x, output->area.y,
+             output->refresh_rate, output->frames, output->late_frames, output->paint_time_max);
+
+        if (output->timeout_id != 0)
+        {
+            g_source_remove (output->timeout_id);
+        }
+        if (output->damage != None)
+        {
+            XFixesDestroyRegion (display_info->dpy, output->damage);
+        }
+        g_free (output);
+    }
+    g_ptr_array_set_size (screen_info->outputs, 0);
+}
+
+static void
+update_outputs (ScreenInfo *screen_info)
+{
+    CompositorOutput *output;
+    gint refresh_rate;
+    gboolean mixed;
+    guint i;
+#ifdef HAVE_RANDR
+    DisplayInfo *display_info;
+    XRRScreenResources *resources;
+    XRRCrtcInfo *crtc_info;
+    gint j;
+#endif /* HAVE_RANDR */
+
+    g_return_if_fail (screen_info->outputs != NULL);
+    TRACE ("entering update_outputs");
+
+    free_outputs (screen_info);
+    refresh_rate = 0;
+
+#ifdef HAVE_RANDR
+    display_info = screen_info->display_info;
+    if (display_info->have_xrandr)
+    {
+        resources = XRRGetScreenResourcesCurrent (display_info->dpy, screen_info->xroot);
+        if (resources)
+        {
+            for (j = 0; j < resources->ncrtc; j++)
+            {
+                crtc_info = XRRGetCrtcInfo (display_info->dpy, resources, resources->crtcs[j]);
+                if (!crtc_info)
+                {
+                    continue;
+                }
+                if ((crtc_info->mode != None) && (crtc_info->noutput > 0))
+                {
+                    add_output (screen_info, crtc_info->x, crtc_info->y,
+                                crtc_info->width, crtc_info->height,
+                                get_mode_refresh_rate (resources, crtc_info->mode));
+                }
+                XRRFreeCrtcInfo (crtc_info);
+            }
+            XRRFreeScreenResources (resources);
+        }
+    }
+#endif /* HAVE_RANDR */
+
+    /* Only split the repaint when the refresh rates actually differ */
+    mixed = FALSE;
+    for (i = 0; i < screen_info->outputs->len; i++)
+    {
+        output = g_ptr_array_index (screen_info->outputs, i);
+        if ((i > 0) && (output->refresh_rate != refresh_rate))
+        {
+            mixed = TRUE;
+        }
+        refresh_rate = MAX (output->refresh_rate, refresh_rate);
+    }
+
+    if (!mixed)
+    {
+        free_outputs (screen_info);
+#ifdef HAVE_RANDR
+        if ((refresh_rate == 0) && (display_info->have_xrandr))
+        {
+            refresh_rate = get_refresh_rate (screen_info);
+        }
+#endif /* HAVE_RANDR */
+        add_output (screen_info, 0, 0, screen_info->width, screen_info->height, refresh_rate);
+    }
+
+#ifdef HAVE_RANDR
     if (refresh_rate != screen_info->refresh_rate)
     {
         DBG ("Detected refreshrate: %i hertz", refresh_rate);
         screen_info->refresh_rate = refresh_rate;
     }
-}
 #endif /* HAVE_RANDR */
+    DBG ("Using %i repaint schedule(s)", screen_info->outputs->len);
+}
 
 static void
 paint_all (ScreenInfo *screen_info, XserverRegion region)
@@ -1566,6 +1856,16 @@ paint_all (ScreenInfo *screen_info, XserverRegion region)
         /* Set clipping back to the given region */
         XFixesSetPictureClipRegion (dpy, screen_info->rootBuffer, 0, 0, region);
     }
+
+    if (screen_info->outline_visible)
+    {
+        XRectangle rects[4];
+        gint n;
+
+        n = get_outline_rects (screen_info, rects);
+        XRenderFillRectangles (dpy, PictOpOver, screen_info->rootBuffer,
+                               &screen_info->outline_color, rects, n);
+    }
 #ifdef HAVE_LIBDRM
 #if TIMEOUT_REPAINT
     use_dri = dri_enabled (screen_info);
@@ -1600,37 +1900,160 @@ paint_all (ScreenInfo *screen_info, XserverRegion region)
 static void
 remove_timeouts (ScreenInfo *screen_info)
 {
-    if (screen_info->compositor_timeout_id != 0)
+    CompositorOutput *output;
+    guint i;
+
+    if (screen_info->outputs == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < screen_info->outputs->len; i++)
     {
-        g_source_remove (screen_info->compositor_timeout_id);
-        screen_info->compositor_timeout_id = 0;
+        output = g_ptr_array_index (screen_info->outputs, i);
+        if (output->timeout_id != 0)
+        {
+            g_source_remove (output->timeout_id);
+            output->timeout_id = 0;
+        }
     }
 }
 #endif /* TIMEOUT_REPAINT */
 
+#ifdef HAVE_XSYNC
+static gboolean
+frame_sync_enabled (CWindow *cw)
+{
+    return ((cw->c) && (cw->screen_info->outputs) &&
+            FLAG_TEST (cw->c->flags, CLIENT_FLAG_XSYNC_ENABLED) &&
+            FLAG_TEST (cw->c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER));
+}
+
 static void
-repair_screen (ScreenInfo *screen_info)
+frame_drawn (CWindow *cw, gint64 drawn_time, gint32 refresh_interval)
+{
+    cw->frame_drawn_pending = FALSE;
+    if (cw->c)
+    {
+        /* The actual presentation time is not known */
+        clientXSyncFrameDrawn (cw->c, cw->frame_value, drawn_time);
+        clientXSyncFrameTimings (cw->c, cw->frame_value, 0, refresh_interval);
+    }
+}
+
+static void
+send_frame_drawn (CompositorOutput *output, gint64 drawn_time)
+{
+    ScreenInfo *screen_info;
+    CWindow *cw;
+    GList *list;
+    XRectangle bounds;
+    gint32 refresh_interval;
+
+    screen_info = output->screen_info;
+    refresh_interval = (output->refresh_rate > 0) ? 1000000 / output->refresh_rate : 0;
+
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        cw = (CWindow *) list->data;
+        if (!cw->frame_drawn_pending)
+        {
+            continue;
+        }
+        get_win_bounds (cw, &bounds);
+        if (!rect_intersect (&bounds, &output->area))
+        {
+            continue;
+        }
+
+        frame_drawn (cw, drawn_time, refresh_interval);
+    }
+}
+#endif /* HAVE_XSYNC */
+
+static void
+repair_output (CompositorOutput *output)
 {
+    ScreenInfo *screen_info;
     DisplayInfo *display_info;
+    CompositorFrame *frame;
+    CompositorPrePaintFunc pre_paint_func;
+    gint64 start, end;
 
-    g_return_if_fail (screen_info);
-    TRACE ("entering repair_screen");
+    g_return_if_fail (output);
+    TRACE ("entering repair_output");
 
+    screen_info = output->screen_info;
     if (!screen_info->compositor_active)
     {
         return;
     }
 
+    /* Last changes for this frame, the damage they add is painted below */
+    if (screen_info->pre_paint_func)
+    {
+        pre_paint_func = screen_info->pre_paint_func;
+        screen_info->pre_paint_func = NULL;
+        (*pre_paint_func) (screen_info->pre_paint_data);
+    }
+
 #if TIMEOUT_REPAINT
-    remove_timeouts (screen_info);
+    if (output->timeout_id != 0)
+    {
+        g_source_remove (output->timeout_id);
+        output->timeout_id = 0;
+    }
 #endif /* TIMEOUT_REPAINT */
 
     display_info = screen_info->display_info;
-    if (screen_info->allDamage != None)
+    if (output->damage != None)
+    {
+        start = g_get_monotonic_time ();
+        paint_all (screen_info, output->damage);
+        XFixesDestroyRegion (display_info->dpy, output->damage);
+        output->damage = None;
+        end = g_get_monotonic_time ();
+
+        output->frames++;
+        output->paint_time_total += end - start;
+        output->paint_time_max = MAX (output->paint_time_max, end - start);
+        if ((output->refresh_rate > 0) &&
+            (end > output->deadline + 1000000 / output->refresh_rate))
+        {
+            output->late_frames++;
+        }
+        output->present_time = end;
+
+        frame = &screen_info->frames[screen_info->frame_count++ % COMPOSITOR_FRAME_HISTORY];
+        frame->time = end;
+        frame->paint_time = end - start;
+        frame->output = output->area;
+        frame->nrects = output->nrects;
+        memcpy (frame->rects, output->rects, output->nrects * sizeof (XRectangle));
+
+#ifdef HAVE_XSYNC
+        send_frame_drawn (output, end);
+#endif /* HAVE_XSYNC */
+    }
+    output->nrects = 0;
+}
+
+static void
+repair_screen (ScreenInfo *screen_info)
+{
+    guint i;
+
+    g_return_if_fail (screen_info);
+    TRACE ("entering repair_screen");
+
+    if ((!screen_info->compositor_active) || (screen_info->outputs == NULL))
+    {
+        return;
+    }
+
+    for (i = 0; i < screen_info->outputs->len; i++)
     {
-        paint_all (screen_info, screen_info->allDamage);
-        XFixesDestroyRegion (display_info->dpy, screen_info->allDamage);
-        screen_info->allDamage = None;
+        repair_output ((CompositorOutput *) g_ptr_array_index (screen_info->outputs, i));
     }
 }
 
@@ -1638,71 +2061,69 @@ repair_screen (ScreenInfo *screen_info)
 static gboolean
 compositor_timeout_cb (gpointer data)
 {
-    ScreenInfo *screen_info;
+    CompositorOutput *output;
 
-    screen_info = (ScreenInfo *) data;
-    screen_info->compositor_timeout_id = 0;
-    repair_screen (screen_info);
+    output = (CompositorOutput *) data;
+    output->timeout_id = 0;
+    repair_output (output);
 
     return FALSE;
 }
 #endif /* TIMEOUT_REPAINT */
 
 static void
-add_repair (ScreenInfo *screen_info)
+add_repair (CompositorOutput *output)
 {
 #if TIMEOUT_REPAINT
-#ifdef HAVE_LIBDRM
+    ScreenInfo *screen_info;
     gint64 interval;
-#endif /* HAVE_LIBDRM */
 
-    if (screen_info->compositor_timeout_id != 0)
+    if (output->timeout_id != 0)
     {
         return;
     }
 
+    screen_info = output->screen_info;
 #ifdef HAVE_LIBDRM
     if (dri_enabled (screen_info))
     {
         /* schedule the next render to be half a refresh period after the last vertical blank,
            but at least 1 ms in the future so that all queued events can be processed,
            and to reduce latency if we didn't render for a while */
-#ifdef HAVE_RANDR
-        if (screen_info->refresh_rate > 0)
+        if (output->refresh_rate > 0)
         {
-            interval = (screen_info->vblank_time + 500000 / screen_info->refresh_rate -
+            interval = (screen_info->vblank_time + 500000 / output->refresh_rate -
                         g_get_monotonic_time ()) / 1000;
         }
         else
-#endif /* HAVE_RANDR */
         {
             interval = TIMEOUT_REPAINT - ((g_get_monotonic_time () - screen_info->vblank_time) / 1000);
         }
-
-        if (interval > TIMEOUT_REPAINT_MAX)
-        {
-            interval = TIMEOUT_REPAINT_MAX;
-        }
-        else if (interval < TIMEOUT_REPAINT_MIN)
-        {
-            interval = TIMEOUT_REPAINT_MIN;
-        }
+    }
+    else
+#endif /* HAVE_LIBDRM */
+    if ((output->refresh_rate > 0) && (screen_info->outputs->len > 1))
+    {
+        /* mixed rates, present at the output's own cadence, one refresh period after the last frame */
+        interval = (output->present_time + 1000000 / output->refresh_rate -
+                    g_get_monotonic_time ()) / 1000;
     }
     else
     {
         interval = TIMEOUT_REPAINT;
     }
-#endif /* HAVE_LIBDRM */
 
-    screen_info->compositor_timeout_id =
-#ifdef HAVE_LIBDRM
-        g_timeout_add (interval,
-                       compositor_timeout_cb, screen_info);
-#else
-        g_timeout_add (TIMEOUT_REPAINT,
-                       compositor_timeout_cb, screen_info);
-#endif /*HAVE_LIBDRM */
+    if (interval > TIMEOUT_REPAINT_MAX)
+    {
+        interval = TIMEOUT_REPAINT_MAX;
+    }
+    else if (interval < TIMEOUT_REPAINT_MIN)
+    {
+        interval = TIMEOUT_REPAINT_MIN;
+    }
 
+    output->deadline = g_get_monotonic_time () + interval * 1000;
+    output->timeout_id = g_timeout_add (interval, compositor_timeout_cb, output);
 #endif /* TIMEOUT_REPAINT */
 }
 
@@ -1723,9 +2144,28 @@ repair_display (DisplayInfo *display_info)
 #endif
 
 static void
-add_damage (ScreenInfo *screen_info, XserverRegion damage)
+add_output_bounds (CompositorOutput *output, XRectangle *bounds)
+{
+    XRectangle r;
+
+    r = (bounds) ? *bounds : output->area;
+    if (output->nrects < COMPOSITOR_FRAME_RECTS)
+    {
+        output->rects[output->nrects++] = r;
+    }
+    else
+    {
+        rect_union (&output->rects[COMPOSITOR_FRAME_RECTS - 1], &r);
+    }
+}
+
+static void
+add_damage (ScreenInfo *screen_info, XserverRegion damage, XRectangle *bounds)
 {
     DisplayInfo *display_info;
+    CompositorOutput *output;
+    XserverRegion region;
+    guint i;
 
     TRACE ("entering add_damage");
 
@@ -1735,21 +2175,59 @@ add_damage (ScreenInfo *screen_info, XserverRegion damage)
     }
 
     display_info = screen_info->display_info;
-    if (screen_info->allDamage != None)
+    if ((screen_info->outputs == NULL) || (screen_info->outputs->len == 0))
     {
-        XFixesUnionRegion (display_info->dpy,
-                           screen_info->allDamage,
-                           screen_info->allDamage,
-                           damage);
         XFixesDestroyRegion (display_info->dpy, damage);
+        return;
     }
-    else
+
+    /* Single schedule, no need to split the damage */
+    if (screen_info->outputs->len == 1)
     {
-        screen_info->allDamage = damage;
+        output = g_ptr_array_index (screen_info->outputs, 0);
+        if (output->damage != None)
+        {
+            XFixesUnionRegion (display_info->dpy, output->damage, output->damage, damage);
+            XFixesDestroyRegion (display_info->dpy, damage);
+        }
+        else
+        {
+            output->damage = damage;
+        }
+        add_output_bounds (output, bounds);
+        add_repair (output);
+
+        return;
     }
 
-    /* The per-screen allDamage region is freed by repair_screen () */
-    add_repair (screen_info);
+    /*
+     * Dispatch the damage to the outputs it covers. The bounds are computed
+     * client side so that the untouched outputs need no server request at all.
+     */
+    for (i = 0; i < screen_info->outputs->len; i++)
+    {
+        output = g_ptr_array_index (screen_info->outputs, i);
+        if ((bounds) && !rect_intersect (bounds, &output->area))
+        {
+            continue;
+        }
+
+        region = XFixesCreateRegion (display_info->dpy, &output->area, 1);
+        XFixesIntersectRegion (display_info->dpy, region, region, damage);
+        if (output->damage != None)
+        {
+            XFixesUnionRegion (display_info->dpy, output->damage, output->damage, region);
+            XFixesDestroyRegion (display_info->dpy, region);
+        }
+        else
+        {
+            output->damage = region;
+        }
+        /* The per-output damage region is freed by repair_output () */
+        add_output_bounds (output, bounds);
+        add_repair (output);
+    }
+    XFixesDestroyRegion (display_info->dpy, damage);
 }
 
 static void
@@ -1808,6 +2286,7 @@ repair_win (CWindow *cw, XRectangle *r)
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
     XserverRegion parts;
+    XRectangle bounds;
 
     g_return_if_fail (cw != NULL);
 
@@ -1840,8 +2319,9 @@ repair_win (CWindow *cw, XRectangle *r)
     if (parts)
     {
         fix_region (cw, parts);
+        get_win_bounds (cw, &bounds);
         /* parts region will be destroyed by add_damage () */
-        add_damage (cw->screen_info, parts);
+        add_damage (cw->screen_info, parts, &bounds);
         cw->damaged = TRUE;
     }
 }
@@ -1860,21 +2340,23 @@ damage_screen (ScreenInfo *screen_info)
     r.height = screen_info->height;
     region = XFixesCreateRegion (display_info->dpy, &r, 1);
     /* region will be freed by add_damage () */
-    add_damage (screen_info, region);
+    add_damage (screen_info, region, NULL);
 }
 
 static void
 damage_win (CWindow *cw)
 {
     XserverRegion extents;
+    XRectangle bounds;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering damage_win");
 
     extents = win_extents (cw);
     fix_region (cw, extents);
+    get_win_bounds (cw, &bounds);
     /* extents region will be freed by add_damage () */
-    add_damage (cw->screen_info, extents);
+    add_damage (cw->screen_info, extents, &bounds);
 }
 
 static void
@@ -1936,12 +2418,14 @@ determine_mode (CWindow *cw)
     if (cw->extents)
     {
         XserverRegion damage;
+        XRectangle bounds;
 
         damage = XFixesCreateRegion (display_info->dpy, NULL, 0);
         XFixesCopyRegion (display_info->dpy, damage, cw->extents);
         fix_region (cw, damage);
+        get_win_bounds (cw, &bounds);
         /* damage region will be destroyed by add_damage () */
-        add_damage (screen_info, damage);
+        add_damage (screen_info, damage, &bounds);
     }
 }
 
@@ -1950,15 +2434,23 @@ expose_area (ScreenInfo *screen_info, XRectangle *rects, gint nrects)
 {
     DisplayInfo *display_info;
     XserverRegion region;
+    XRectangle bounds;
+    gint i;
 
     g_return_if_fail (rects != NULL);
     g_return_if_fail (nrects > 0);
     TRACE ("entering expose_area");
 
+    bounds = rects[0];
+    for (i = 1; i < nrects; i++)
+    {
+        rect_union (&bounds, &rects[i]);
+    }
+
     display_info = screen_info->display_info;
     region = XFixesCreateRegion (display_info->dpy, rects, nrects);
     /* region will be destroyed by add_damage () */
-    add_damage (screen_info, region);
+    add_damage (screen_info, region, &bounds);
 }
 
 static void
@@ -1966,6 +2458,7 @@ set_win_opacity (CWindow *cw, guint32 opacity)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
+    guint i;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering set_win_opacity");
@@ -1984,7 +2477,10 @@ set_win_opacity (CWindow *cw, guint32 opacity)
             XFixesDestroyRegion (display_info->dpy, cw->extents);
         }
         cw->extents = win_extents (cw);
-        add_repair (screen_info);
+        for (i = 0; (screen_info->outputs) && (i < screen_info->outputs->len); i++)
+        {
+            add_repair ((CompositorOutput *) g_ptr_array_index (screen_info->outputs, i));
+        }
     }
 }
 
@@ -2081,6 +2577,24 @@ unmap_win (CWindow *cw)
         damage_win (cw);
     }
 
+#ifdef HAVE_XSYNC
+    /* Won't be painted anymore, don't leave the client waiting */
+    if (cw->frame_timeout_id)
+    {
+        g_source_remove (cw->frame_timeout_id);
+        cw->frame_timeout_id = 0;
+    }
+    if (cw->frame_deferred)
+    {
+        XDamageSubtract (display_info->dpy, cw->damage, None, None);
+        cw->frame_deferred = FALSE;
+    }
+    if (cw->frame_drawn_pending)
+    {
+        frame_drawn (cw, g_get_monotonic_time (), 0);
+    }
+#endif /* HAVE_XSYNC */
+
     cw->viewable = FALSE;
     cw->damaged = FALSE;
     cw->redirected = TRUE;
@@ -2138,12 +2652,16 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
         return;
     }
 
+    /*
+     * No server grab here, if the window goes away meanwhile the requests
+     * below just fail and the DestroyNotify we get as the window manager
+     * takes care of the rest.
+     */
     new = g_new0 (CWindow, 1);
-    myDisplayGrabServer (display_info);
-    if (!XGetWindowAttributes (display_info->dpy, id, &new->attr))
+    if (!prefetchGetWindowAttributes (display_info, id, &new->attr) &&
+        !XGetWindowAttributes (display_info->dpy, id, &new->attr))
     {
         g_free (new);
-        myDisplayUngrabServer (display_info);
         TRACE ("An error occured getting window attributes, 0x%lx not added", id);
         return;
     }
@@ -2160,7 +2678,6 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
     if (!screen_info)
     {
         g_free (new);
-        myDisplayUngrabServer (display_info);
         TRACE ("Couldn't get screen from window, 0x%lx not added", id);
         return;
     }
@@ -2168,7 +2685,6 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
     if (!(screen_info->compositor_active))
     {
         g_free (new);
-        myDisplayUngrabServer (display_info);
         TRACE ("Compositor not active on screen %i, 0x%lx not added", screen_info->screen, id);
         return;
     }
@@ -2236,8 +2752,6 @@ add_win (DisplayInfo *display_info, Window id, Client *c)
     }
 
     TRACE ("window 0x%lx added", id);
-
-    myDisplayUngrabServer (display_info);
 }
 
 static void
@@ -2252,13 +2766,14 @@ restack_win (CWindow *cw, Window above)
     TRACE ("entering restack_win, 0x%lx above 0x%lx", cw->id, above);
 
     screen_info = cw->screen_info;
+    screen_info->restack_notifies++;
     sibling = g_list_find (screen_info->cwindows, (gconstpointer) cw);
     next = g_list_next (sibling);
     previous_above = None;
 
     if (next)
     {
-        CWindow *ncw = (CWindow *) next;
+        CWindow *ncw = (CWindow *) next->data;
         previous_above = ncw->id;
     }
 
@@ -2270,6 +2785,7 @@ restack_win (CWindow *cw, Window above)
         /* Insert at bottom of window stack */
         screen_info->cwindows = g_list_delete_link (screen_info->cwindows, sibling);
         screen_info->cwindows = g_list_append (screen_info->cwindows, cw);
+        screen_info->restack_reorders++;
     }
     else if (previous_above != above)
     {
@@ -2288,16 +2804,145 @@ restack_win (CWindow *cw, Window above)
         {
             screen_info->cwindows = g_list_delete_link (screen_info->cwindows, sibling);
             screen_info->cwindows = g_list_insert_before (screen_info->cwindows, list, cw);
+            screen_info->restack_reorders++;
         }
     }
 }
 
+static gboolean
+can_stretch (CWindow *cw)
+{
+#if HAVE_NAME_WINDOW_PIXMAP
+    ScreenInfo *screen_info;
+
+    screen_info = cw->screen_info;
+    /* A picture of the window itself would show the new contents, not the last good ones */
+    return ((cw->c) && (screen_info->params->stretch_resize) &&
+            FLAG_TEST (cw->c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING) &&
+            WIN_IS_VISIBLE (cw) && WIN_IS_REDIRECTED (cw) && !(cw->shaped) &&
+            (cw->picture != None) && (cw->name_window_pixmap != None));
+#else /* HAVE_NAME_WINDOW_PIXMAP */
+    return FALSE;
+#endif /* HAVE_NAME_WINDOW_PIXMAP */
+}
+
+static void
+end_stretch (CWindow *cw)
+{
+    DisplayInfo *display_info;
+
+    if (cw->stretch_picture == None)
+    {
+        return;
+    }
+    TRACE ("entering end_stretch 0x%lx", cw->id);
+
+    display_info = cw->screen_info->display_info;
+    if (cw->stretch_timeout_id)
+    {
+        g_source_remove (cw->stretch_timeout_id);
+        cw->stretch_timeout_id = 0;
+    }
+    XRenderFreePicture (display_info->dpy, cw->stretch_picture);
+    cw->stretch_picture = None;
+
+    if (WIN_IS_VISIBLE (cw))
+    {
+        damage_win (cw);
+    }
+}
+
+static gboolean
+stretch_timeout_cb (gpointer data)
+{
+    CWindow *cw;
+
+    cw = (CWindow *) data;
+    TRACE ("entering stretch_timeout_cb 0x%lx", cw->id);
+
+    /* The client is too slow, show whatever it has drawn so far */
+    cw->stretch_timeout_id = 0;
+    end_stretch (cw);
+
+    return FALSE;
+}
+
+static void
+update_stretch (CWindow *cw)
+{
+    DisplayInfo *display_info;
+    XTransform transform;
+    gint width, height;
+
+    display_info = cw->screen_info->display_info;
+    width = cw->attr.width + 2 * cw->attr.border_width;
+    height = cw->attr.height + 2 * cw->attr.border_width;
+
+    /* The transform maps the new size back onto the saved contents */
+    memset (&transform, 0, sizeof (XTransform));
+    transform.matrix[0][0] = XDoubleToFixed ((double) cw->stretch_width / MAX (width, 1));
+    transform.matrix[1][1] = XDoubleToFixed ((double) cw->stretch_height / MAX (height, 1));
+    transform.matrix[2][2] = XDoubleToFixed (1.0);
+    XRenderSetPictureTransform (display_info->dpy, cw->stretch_picture, &transform);
+
+    if (cw->stretch_timeout_id)
+    {
+        g_source_remove (cw->stretch_timeout_id);
+    }
+    cw->stretch_timeout_id = g_timeout_add (CLIENT_XSYNC_TIMEOUT, stretch_timeout_cb, cw);
+}
+
+/*
+ * Whether the damage is the client drawing its contents, as opposed to
+ * the decorations being redrawn or the server exposing the area the
+ * resize uncovered, which both happen on every resize step.
+ */
+static gboolean
+stretch_client_damaged (CWindow *cw, XRectangle *area)
+{
+    Client *c;
+    XRectangle r;
+
+    c = cw->c;
+    if (c == NULL)
+    {
+        return TRUE;
+    }
+
+    r.x = frameLeft (c);
+    r.y = frameTop (c);
+    r.width = MAX (0, MIN (c->width, cw->stretch_width - frameLeft (c) - frameRight (c)));
+    r.height = MAX (0, MIN (c->height, cw->stretch_height - frameTop (c) - frameBottom (c)));
+
+    return rect_intersect (area, &r);
+}
+
+static void
+begin_stretch (CWindow *cw)
+{
+    DisplayInfo *display_info;
+
+    TRACE ("entering begin_stretch 0x%lx", cw->id);
+
+    display_info = cw->screen_info->display_info;
+    cw->stretch_picture = cw->picture;
+    cw->stretch_width = cw->attr.width + 2 * cw->attr.border_width;
+    cw->stretch_height = cw->attr.height + 2 * cw->attr.border_width;
+    cw->picture = None;
+
+    /* The clip was set for the old size by border_size () */
+    XFixesSetPictureClipRegion (display_info->dpy, cw->stretch_picture, 0, 0, None);
+    XRenderSetPictureFilter (display_info->dpy, cw->stretch_picture, FilterBilinear, NULL, 0);
+}
+
 static void
 resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
 {
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
     XserverRegion damage;
+    XRectangle bounds, new_bounds;
+    gboolean resized;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering resize_win");
@@ -2306,6 +2951,7 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
     screen_info = cw->screen_info;
     display_info = screen_info->display_info;
     damage = None;
+    get_win_bounds (cw, &bounds);
 
     if (WIN_IS_VISIBLE(cw))
     {
@@ -2322,8 +2968,14 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
         cw->extents = None;
     }
 
-    if ((cw->attr.width != width) || (cw->attr.height != height))
+    resized = ((cw->attr.width != width) || (cw->attr.height != height));
+    if (resized)
     {
+        if ((cw->stretch_picture == None) && can_stretch (cw))
+        {
+            /* Keep the current contents around until the client catches up */
+            begin_stretch (cw);
+        }
 #if HAVE_NAME_WINDOW_PIXMAP
         if (cw->name_window_pixmap)
         {
@@ -2372,14 +3024,21 @@ resize_win (CWindow *cw, gint x, gint y, gint width, gint height, gint bw)
     cw->attr.height = height;
     cw->attr.border_width = bw;
 
+    if ((resized) && (cw->stretch_picture))
+    {
+        update_stretch (cw);
+    }
+
     if (damage)
     {
         cw->extents = win_extents (cw);
         XFixesUnionRegion (display_info->dpy, damage, damage, cw->extents);
+        get_win_bounds (cw, &new_bounds);
+        rect_union (&bounds, &new_bounds);
 
         fix_region (cw, damage);
         /* damage region will be destroyed by add_damage () */
-        add_damage (screen_info, damage);
+        add_damage (screen_info, damage, &bounds);
     }
 }
 
@@ -2389,6 +3048,7 @@ reshape_win (CWindow *cw)
     DisplayInfo *display_info;
     ScreenInfo *screen_info;
     XserverRegion damage;
+    XRectangle bounds, new_bounds;
 
     g_return_if_fail (cw != NULL);
     TRACE ("entering reshape_win");
@@ -2397,6 +3057,7 @@ reshape_win (CWindow *cw)
     display_info = screen_info->display_info;
 
     damage = None;
+    get_win_bounds (cw, &bounds);
 
     if (WIN_IS_VISIBLE(cw))
     {
@@ -2435,6 +3096,8 @@ reshape_win (CWindow *cw)
     {
         cw->extents = win_extents (cw);
         XFixesUnionRegion (display_info->dpy, damage, damage, cw->extents);
+        get_win_bounds (cw, &new_bounds);
+        rect_union (&bounds, &new_bounds);
 
         /* A shape notify will likely change the shadows too, so clear the extents */
         XFixesDestroyRegion (display_info->dpy, cw->extents);
@@ -2442,7 +3105,7 @@ reshape_win (CWindow *cw)
 
         fix_region (cw, damage);
         /* damage region will be destroyed by add_damage () */
-        add_damage (screen_info, damage);
+        add_damage (screen_info, damage, &bounds);
     }
 }
 
@@ -2500,11 +3163,7 @@ static gboolean
 zoom_timeout_cb (gpointer data)
 {
     ScreenInfo   *screen_info;
-    Window       root_return;
-    Window       child_return;
     int          x_root, y_root;
-    int          x_win, y_win;
-    unsigned int mask;
     static int   x_old = -1, y_old = -1;
 
     screen_info = (ScreenInfo *) data;
@@ -2515,9 +3174,11 @@ zoom_timeout_cb (gpointer data)
         return FALSE; /* stop calling this callback */
     }
 
-    XQueryPointer (screen_info->display_info->dpy, screen_info->xroot,
-                            &root_return, &child_return,
-                            &x_root, &y_root, &x_win, &y_win, &mask);
+    if (!myDisplayGetPointer (screen_info->display_info, screen_info->xroot,
+                              &x_root, &y_root, NULL))
+    {
+        return TRUE;
+    }
     if (x_old != x_root || y_old != y_root)
     {
         x_old = x_root; y_old = y_root;
@@ -2526,6 +3187,75 @@ zoom_timeout_cb (gpointer data)
     return TRUE;
 }
 
+#ifdef HAVE_XSYNC
+static void
+thaw_frame (CWindow *cw)
+{
+    TRACE ("entering thaw_frame 0x%lx", cw->id);
+
+    if (cw->frame_timeout_id)
+    {
+        g_source_remove (cw->frame_timeout_id);
+        cw->frame_timeout_id = 0;
+    }
+
+    if (cw->frame_deferred)
+    {
+        cw->frame_deferred = FALSE;
+        repair_win (cw, NULL);
+    }
+}
+
+static gboolean
+frame_timeout_cb (gpointer data)
+{
+    CWindow *cw;
+
+    cw = (CWindow *) data;
+    TRACE ("entering frame_timeout_cb 0x%lx", cw->id);
+
+    /* The client never completed its frame, show what we have */
+    cw->frame_timeout_id = 0;
+    thaw_frame (cw);
+
+    return FALSE;
+}
+
+static void
+defer_frame (CWindow *cw)
+{
+    TRACE ("entering defer_frame 0x%lx", cw->id);
+
+    cw->frame_deferred = TRUE;
+    if (cw->frame_timeout_id == 0)
+    {
+        cw->frame_timeout_id = g_timeout_add (CLIENT_XSYNC_TIMEOUT, frame_timeout_cb, cw);
+    }
+}
+
+static gboolean
+is_repaint_pending (CWindow *cw)
+{
+    ScreenInfo *screen_info;
+    CompositorOutput *output;
+    XRectangle bounds;
+    guint i;
+
+    screen_info = cw->screen_info;
+    get_win_bounds (cw, &bounds);
+    for (i = 0; i < screen_info->outputs->len; i++)
+    {
+        output = g_ptr_array_index (screen_info->outputs, i);
+        if ((output->damage != None) && rect_intersect (&bounds, &output->area))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+#endif /* HAVE_XSYNC */
+
 static void
 compositorHandleDamage (DisplayInfo *display_info, XDamageNotifyEvent *ev)
 {
@@ -2547,7 +3277,33 @@ compositorHandleDamage (DisplayInfo *display_info, XDamageNotifyEvent *ev)
     if ((cw) && WIN_IS_REDIRECTED(cw))
     {
         screen_info = cw->screen_info;
-        repair_win (cw, &ev->area);
+        cw->damage_count++;
+#ifdef HAVE_XSYNC
+        /*
+         * The client is in the middle of a frame, leave the damage pending
+         * on the server until the frame is complete so that it gets painted
+         * in one go. With XDamageReportNonEmpty no more damage events are
+         * sent for this window meanwhile.
+         */
+        if (frame_sync_enabled (cw) && !clientXSyncFrameComplete (cw->c))
+        {
+            defer_frame (cw);
+        }
+        else
+#endif /* HAVE_XSYNC */
+        {
+            repair_win (cw, &ev->area);
+        }
+
+        /* Without XSync, new damage to the client area is all we know about it redrawing */
+        if ((cw->stretch_picture)
+#ifdef HAVE_XSYNC
+            && !((cw->c) && FLAG_TEST (cw->c->flags, CLIENT_FLAG_XSYNC_ENABLED))
+#endif /* HAVE_XSYNC */
+            && stretch_client_damaged (cw, &ev->area))
+        {
+            end_stretch (cw);
+        }
         screen_info->damages_pending = ev->more;
     }
 }
@@ -2855,9 +3611,10 @@ compositorHandleRandrNotify (DisplayInfo *display_info, XRRScreenChangeNotifyEve
     TRACE ("entering compositorHandleRandrNotify for 0x%lx", ev->window);
 
     screen_info = myDisplayGetScreenFromRoot (display_info, ev->window);
-    if (screen_info)
+    if ((screen_info) && (screen_info->outputs))
     {
-        get_refresh_rate (screen_info);
+        update_outputs (screen_info);
+        damage_screen (screen_info);
     }
     /* No need for RRUpdateConfiguration() here, leave that to gtk+ */
 }
@@ -3532,13 +4289,16 @@ compositorManageScreen (ScreenInfo *screen_info)
                                                0.0, /* green */
                                                0.0  /* blue  */);
     screen_info->rootTile = None;
-    screen_info->allDamage = None;
     screen_info->cwindows = NULL;
     screen_info->wins_unredirected = 0;
-    screen_info->compositor_timeout_id = 0;
+    screen_info->restack_notifies = 0;
+    screen_info->restack_reorders = 0;
     screen_info->zoomed = 0;
     screen_info->zoom_timeout_id = 0;
     screen_info->damages_pending = FALSE;
+    screen_info->outline_visible = FALSE;
+    screen_info->pre_paint_func = NULL;
+    screen_info->pre_paint_data = NULL;
 
     XClearArea (display_info->dpy, screen_info->output, 0, 0, 0, 0, TRUE);
     TRACE ("Manual compositing enabled");
@@ -3549,15 +4309,18 @@ compositorManageScreen (ScreenInfo *screen_info)
     screen_info->dri_secondary = FALSE;
     screen_info->dri_time = 0;
     screen_info->vblank_time = 0;
+#endif /* HAVE_LIBDRM */
 
+    screen_info->outputs = g_ptr_array_new ();
+    screen_info->frames = g_new0 (CompositorFrame, COMPOSITOR_FRAME_HISTORY);
+    screen_info->frame_count = 0;
+    update_outputs (screen_info);
 #ifdef HAVE_RANDR
     if (display_info->have_xrandr)
     {
-        get_refresh_rate(screen_info);
         XRRSelectInput(display_info->dpy, screen_info->xroot, RRScreenChangeNotifyMask);
     }
 #endif /* HAVE_RANDR */
-#endif /* HAVE_LIBDRM */
 
     return TRUE;
 #else
@@ -3588,6 +4351,8 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
         return;
     }
     screen_info->compositor_active = FALSE;
+    screen_info->pre_paint_func = NULL;
+    screen_info->pre_paint_data = NULL;
 
 #if TIMEOUT_REPAINT
     remove_timeouts (screen_info);
@@ -3654,6 +4419,7 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
 
 #ifdef HAVE_LIBDRM
     close_dri (screen_info);
+#endif /* HAVE_LIBDRM */
 
 #ifdef HAVE_RANDR
     if (display_info->have_xrandr)
@@ -3661,7 +4427,15 @@ compositorUnmanageScreen (ScreenInfo *screen_info)
         XRRSelectInput (display_info->dpy, screen_info->xroot, 0);
     }
 #endif /* HAVE_RANDR */
-#endif /* HAVE_LIBDRM */
+
+    if (screen_info->outputs)
+    {
+        free_outputs (screen_info);
+        g_ptr_array_free (screen_info->outputs, TRUE);
+        screen_info->outputs = NULL;
+    }
+    g_free (screen_info->frames);
+    screen_info->frames = NULL;
 
 #endif /* HAVE_COMPOSITOR */
 }
@@ -3682,8 +4456,9 @@ compositorAddAllWindows (ScreenInfo *screen_info)
         return;
     }
 
-    myDisplayGrabServer (display_info);
+    /* Windows created after the query get a CreateNotify, no need to grab */
     XQueryTree (display_info->dpy, screen_info->xroot, &w1, &w2, &wins, &count);
+    prefetchWindowAttributes (display_info, wins, count);
 
     for (i = 0; i < count; i++)
     {
@@ -3691,12 +4466,12 @@ compositorAddAllWindows (ScreenInfo *screen_info)
 
         c = myScreenGetClientFromWindow (screen_info, wins[i], SEARCH_FRAME);
         compositorAddWindow (display_info, wins[i], c);
+        prefetchDiscard (display_info, wins[i]);
     }
     if (wins)
     {
         XFree (wins);
     }
-    myDisplayUngrabServer (display_info);
 #endif /* HAVE_COMPOSITOR */
 }
 
@@ -3762,6 +4537,10 @@ compositorUpdateScreenSize (ScreenInfo *screen_info)
         XRenderFreePicture (display_info->dpy, screen_info->rootBuffer);
         screen_info->rootBuffer = None;
     }
+    if (screen_info->outputs)
+    {
+        update_outputs (screen_info);
+    }
     damage_screen (screen_info);
 #endif /* HAVE_COMPOSITOR */
 }
@@ -3789,6 +4568,165 @@ compositorWindowSetOpacity (DisplayInfo *display_info, Window id, guint32 opacit
 #endif /* HAVE_COMPOSITOR */
 }
 
+/*
+ * Called when a client using the extended sync counter completes a frame.
+ * Returns TRUE if the compositor takes care of sending _NET_WM_FRAME_DRAWN
+ * once the frame is painted, FALSE if the caller should send it right away.
+ */
+gboolean
+compositorWindowFrameComplete (DisplayInfo *display_info, Window id)
+{
+#if defined (HAVE_COMPOSITOR) && defined (HAVE_XSYNC)
+    CWindow *cw;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (id != None, FALSE);
+    TRACE ("entering compositorWindowFrameComplete for 0x%lx", id);
+
+    if (!compositorIsUsable (display_info))
+    {
+        return FALSE;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (!(cw) || !frame_sync_enabled (cw) || !WIN_IS_VIEWABLE (cw) || !WIN_IS_REDIRECTED (cw))
+    {
+        return FALSE;
+    }
+
+    cw->frame_value = cw->c->xsync_value;
+    cw->frame_drawn_pending = TRUE;
+    if (cw->frame_deferred)
+    {
+        /* Paint the complete frame now */
+        thaw_frame (cw);
+    }
+    else if (!is_repaint_pending (cw))
+    {
+        /* The frame did not damage anything, nothing to wait for */
+        cw->frame_drawn_pending = FALSE;
+        return FALSE;
+    }
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR && HAVE_XSYNC */
+    return FALSE;
+#endif /* HAVE_COMPOSITOR && HAVE_XSYNC */
+}
+
+/*
+ * The client has updated its XSync counter, so its contents match the
+ * last configure and the stretched preview is no longer needed.
+ */
+void
+compositorWindowRedrawn (DisplayInfo *display_info, Window id)
+{
+#ifdef HAVE_COMPOSITOR
+    CWindow *cw;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (id != None);
+    TRACE ("entering compositorWindowRedrawn for 0x%lx", id);
+
+    if (!compositorIsUsable (display_info))
+    {
+        return;
+    }
+
+    cw = find_cwindow_in_display (display_info, id);
+    if (cw)
+    {
+        end_stretch (cw);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
+
+/*
+ * Paint the move/resize outline as part of the scene instead of using a
+ * window for it. Returns FALSE if the compositor is not painting the screen.
+ */
+gboolean
+compositorSetOutline (ScreenInfo *screen_info, XRectangle *rect, guint line_width,
+                      gdouble red, gdouble green, gdouble blue, gdouble alpha)
+{
+#ifdef HAVE_COMPOSITOR
+    XRectangle rects[8];
+    XRectangle bounds;
+    XserverRegion region;
+    gint n;
+
+    g_return_val_if_fail (screen_info != NULL, FALSE);
+    g_return_val_if_fail (rect != NULL, FALSE);
+    TRACE ("entering compositorSetOutline");
+
+    if (!compositorIsUsable (screen_info->display_info) ||
+        !(screen_info->compositor_active) || !(screen_info->outputs))
+    {
+        return FALSE;
+    }
+
+    if ((screen_info->outline_visible) &&
+        (screen_info->outline.x == rect->x) && (screen_info->outline.y == rect->y) &&
+        (screen_info->outline.width == rect->width) && (screen_info->outline.height == rect->height))
+    {
+        return TRUE;
+    }
+
+    n = 0;
+    bounds = *rect;
+    if (screen_info->outline_visible)
+    {
+        n = get_outline_rects (screen_info, rects);
+        rect_union (&bounds, &screen_info->outline);
+    }
+
+    screen_info->outline = *rect;
+    screen_info->outline_width = line_width;
+    /* Premultiplied */
+    screen_info->outline_color.alpha = (unsigned short) (alpha * 0xffff);
+    screen_info->outline_color.red   = (unsigned short) (red * alpha * 0xffff);
+    screen_info->outline_color.green = (unsigned short) (green * alpha * 0xffff);
+    screen_info->outline_color.blue  = (unsigned short) (blue * alpha * 0xffff);
+    screen_info->outline_visible = TRUE;
+    n += get_outline_rects (screen_info, rects + n);
+
+    region = XFixesCreateRegion (myScreenGetXDisplay (screen_info), rects, n);
+    add_damage (screen_info, region, &bounds);
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR */
+    return FALSE;
+#endif /* HAVE_COMPOSITOR */
+}
+
+void
+compositorClearOutline (ScreenInfo *screen_info)
+{
+#ifdef HAVE_COMPOSITOR
+    XRectangle rects[4];
+    XserverRegion region;
+    gint n;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering compositorClearOutline");
+
+    if (!(screen_info->outline_visible))
+    {
+        return;
+    }
+    screen_info->outline_visible = FALSE;
+
+    if (!compositorIsUsable (screen_info->display_info) || !(screen_info->compositor_active))
+    {
+        return;
+    }
+
+    n = get_outline_rects (screen_info, rects);
+    region = XFixesCreateRegion (myScreenGetXDisplay (screen_info), rects, n);
+    add_damage (screen_info, region, &screen_info->outline);
+#endif /* HAVE_COMPOSITOR */
+}
+
 void
 compositorRebuildScreen (ScreenInfo *screen_info)
 {
@@ -3842,3 +4780,240 @@ compositorTestServer (DisplayInfo *display_info)
     return FALSE;
 #endif /* HAVE_COMPOSITOR */
 }
+
+/* Refresh rate of the screen in hertz, 0 when unknown */
+gint
+compositorGetRefreshRate (ScreenInfo *screen_info)
+{
+#if defined (HAVE_COMPOSITOR) && defined (HAVE_RANDR)
+    g_return_val_if_fail (screen_info != NULL, 0);
+    TRACE ("entering compositorGetRefreshRate");
+
+    if (screen_info->refresh_rate > 0)
+    {
+        return screen_info->refresh_rate;
+    }
+    if (screen_info->display_info->have_xrandr)
+    {
+        return get_refresh_rate (screen_info);
+    }
+#endif /* HAVE_COMPOSITOR && HAVE_RANDR */
+    return 0;
+}
+
+/*
+ * Have func called right before the next repaint of the screen, making
+ * sure there is one, so that changes it makes show in that very frame.
+ * It is called once; setting it again replaces the pending call and NULL
+ * cancels it. Returns FALSE if the compositor is not painting the screen,
+ * func is then not called.
+ */
+gboolean
+compositorSetPrePaintFunc (ScreenInfo *screen_info, CompositorPrePaintFunc func, gpointer data)
+{
+#ifdef HAVE_COMPOSITOR
+    guint i;
+
+    g_return_val_if_fail (screen_info != NULL, FALSE);
+    TRACE ("entering compositorSetPrePaintFunc");
+
+    screen_info->pre_paint_func = NULL;
+    screen_info->pre_paint_data = NULL;
+
+    if (!compositorIsUsable (screen_info->display_info) ||
+        !(screen_info->compositor_active) ||
+        !(screen_info->outputs) || (screen_info->outputs->len == 0))
+    {
+        return FALSE;
+    }
+
+    if (func)
+    {
+        screen_info->pre_paint_func = func;
+        screen_info->pre_paint_data = data;
+        for (i = 0; i < screen_info->outputs->len; i++)
+        {
+            add_repair ((CompositorOutput *) g_ptr_array_index (screen_info->outputs, i));
+        }
+    }
+
+    return TRUE;
+#else /* HAVE_COMPOSITOR */
+    return FALSE;
+#endif /* HAVE_COMPOSITOR */
+}
+
+#ifdef HAVE_COMPOSITOR
+static void
+dump_rect (FILE *f, const gchar *key, XRectangle *r)
+{
+    fprintf (f, "  [%s] (%i,%i,%u,%u)\n", key, r->x, r->y, r->width, r->height);
+}
+
+static void
+dump_cwindow (FILE *f, CWindow *cw, guint position)
+{
+    fprintf (f, "[CWINDOW] 0x%lx\n", cw->id);
+    fprintf (f, "  [STACKING] %u\n", position);
+    if (cw->c)
+    {
+        fprintf (f, "  [CLIENT] 0x%lx %s\n", cw->c->window, cw->c->name ? cw->c->name : "");
+    }
+    fprintf (f, "  [GEOMETRY] (%i,%i,%i,%i,%i)\n",
+             cw->attr.x, cw->attr.y, cw->attr.width, cw->attr.height, cw->attr.border_width);
+    fprintf (f, "  [FLAGS]%s%s%s%s%s%s%s%s%s\n",
+             cw->viewable ? " viewable" : "",
+             cw->damaged ? " damaged" : "",
+             cw->redirected ? " redirected" : "",
+             cw->argb ? " argb" : "",
+             cw->shaped ? " shaped" : "",
+             cw->fulloverlay ? " fulloverlay" : "",
+             cw->skipped ? " skipped" : "",
+             cw->attr.override_redirect ? " override" : "",
+             cw->opacity_locked ? " opacity_locked" : "");
+    fprintf (f, "  [OPACITY] 0x%08x\n", cw->opacity);
+
+    /* Server side resources currently held for this window */
+    fprintf (f, "  [RESOURCES]");
+    if (cw->damage)
+    {
+        fprintf (f, " damage=0x%lx", cw->damage);
+    }
+#if HAVE_NAME_WINDOW_PIXMAP
+    if (cw->name_window_pixmap)
+    {
+        fprintf (f, " pixmap=0x%lx", cw->name_window_pixmap);
+    }
+#endif /* HAVE_NAME_WINDOW_PIXMAP */
+    if (cw->picture)
+    {
+        fprintf (f, " picture=0x%lx", cw->picture);
+    }
+    if (cw->saved_picture)
+    {
+        fprintf (f, " saved_picture=0x%lx", cw->saved_picture);
+    }
+    if (cw->stretch_picture)
+    {
+        fprintf (f, " stretch_picture=0x%lx", cw->stretch_picture);
+    }
+    if (cw->shadow)
+    {
+        fprintf (f, " shadow=0x%lx", cw->shadow);
+    }
+    if (cw->alphaPict)
+    {
+        fprintf (f, " alpha=0x%lx", cw->alphaPict);
+    }
+    if (cw->shadowPict)
+    {
+        fprintf (f, " shadow_alpha=0x%lx", cw->shadowPict);
+    }
+    if (cw->alphaBorderPict)
+    {
+        fprintf (f, " border_alpha=0x%lx", cw->alphaBorderPict);
+    }
+    if (cw->borderSize)
+    {
+        fprintf (f, " border_size=0x%lx", cw->borderSize);
+    }
+    if (cw->clientSize)
+    {
+        fprintf (f, " client_size=0x%lx", cw->clientSize);
+    }
+    if (cw->borderClip)
+    {
+        fprintf (f, " border_clip=0x%lx", cw->borderClip);
+    }
+    if (cw->extents)
+    {
+        fprintf (f, " extents=0x%lx", cw->extents);
+    }
+    fprintf (f, "\n");
+    fprintf (f, "  [DAMAGE_EVENTS] %" G_GUINT64_FORMAT "\n", cw->damage_count);
+}
+
+static void
+dump_screen (FILE *f, ScreenInfo *screen_info)
+{
+    CompositorOutput *output;
+    CompositorFrame *frame;
+    GList *list;
+    guint64 n;
+    guint i;
+
+    fprintf (f, "[SCREEN] %i\n", screen_info->screen);
+    fprintf (f, "  [SIZE] (%i,%i)\n", screen_info->width, screen_info->height);
+    fprintf (f, "  [COMPOSITOR] %s\n",
+             screen_info->compositor_active ? "on" : "off");
+    fprintf (f, "  [UNREDIRECTED] %u\n", screen_info->wins_unredirected);
+    fprintf (f, "  [RESTACKS] %" G_GUINT64_FORMAT " notified, %" G_GUINT64_FORMAT " reordered\n",
+             screen_info->restack_notifies, screen_info->restack_reorders);
+
+    if (screen_info->outputs)
+    {
+        fprintf (f, "  [REPAINT] %s\n", (screen_info->outputs->len > 1) ? "per-output" : "single");
+        for (i = 0; i < screen_info->outputs->len; i++)
+        {
+            output = g_ptr_array_index (screen_info->outputs, i);
+            dump_rect (f, "OUTPUT", &output->area);
+            fprintf (f, "    [REFRESH_RATE] %i\n", output->refresh_rate);
+            fprintf (f, "    [FRAMES] %" G_GUINT64_FORMAT "\n", output->frames);
+            fprintf (f, "    [LATE_FRAMES] %" G_GUINT64_FORMAT "\n", output->late_frames);
+            fprintf (f, "    [PAINT_TIME] avg=%" G_GINT64_FORMAT " max=%" G_GINT64_FORMAT " usec\n",
+                     output->frames ? output->paint_time_total / (gint64) output->frames : 0,
+                     output->paint_time_max);
+            fprintf (f, "    [PENDING] %s\n", (output->damage != None) ? "yes" : "no");
+        }
+    }
+
+    /* Top of the stack first, as painted */
+    i = 0;
+    for (list = screen_info->cwindows; list; list = g_list_next (list))
+    {
+        dump_cwindow (f, (CWindow *) list->data, i++);
+    }
+
+    if (screen_info->frames == NULL)
+    {
+        return;
+    }
+
+    /* Most recent frame first */
+    for (n = 0; (n < screen_info->frame_count) && (n < COMPOSITOR_FRAME_HISTORY); n++)
+    {
+        frame = &screen_info->frames[(screen_info->frame_count - n - 1) % COMPOSITOR_FRAME_HISTORY];
+        fprintf (f, "[FRAME] %" G_GUINT64_FORMAT "\n", screen_info->frame_count - n - 1);
+        fprintf (f, "  [TIME] %" G_GINT64_FORMAT "\n", frame->time);
+        fprintf (f, "  [PAINT_TIME] %" G_GINT64_FORMAT " usec\n", frame->paint_time);
+        dump_rect (f, "OUTPUT", &frame->output);
+        for (i = 0; i < frame->nrects; i++)
+        {
+            dump_rect (f, "DAMAGE", &frame->rects[i]);
+        }
+    }
+}
+#endif /* HAVE_COMPOSITOR */
+
+void
+compositorDumpScene (DisplayInfo *display_info, FILE *f)
+{
+#ifdef HAVE_COMPOSITOR
+    GSList *screens;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (f != NULL);
+    TRACE ("entering compositorDumpScene");
+
+    fprintf (f, "[COMPOSITOR] %s\n", display_info->enable_compositor ? "enabled" : "disabled");
+    if (!display_info->enable_compositor)
+    {
+        return;
+    }
+
+    for (screens = display_info->screens; screens; screens = g_slist_next (screens))
+    {
+        dump_screen (f, (ScreenInfo *) screens->data);
+    }
+#endif /* HAVE_COMPOSITOR */
+}
@@ -28,6 +28,7 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <X11/Xlib.h>
 
 #include "display.h"
@@ -76,7 +77,25 @@ void                     compositorUpdateScreenSize             (ScreenInfo *);
 void                     compositorWindowSetOpacity             (DisplayInfo *,
                                                                  Window,
                                                                  guint32);
+gboolean                 compositorWindowFrameComplete          (DisplayInfo *,
+                                                                 Window);
+void                     compositorWindowRedrawn                (DisplayInfo *,
+                                                                 Window);
+gboolean                 compositorSetOutline                   (ScreenInfo *,
+                                                                 XRectangle *,
+                                                                 guint,
+                                                                 gdouble,
+                                                                 gdouble,
+                                                                 gdouble,
+                                                                 gdouble);
+void                     compositorClearOutline                 (ScreenInfo *);
 void                     compositorRebuildScreen                (ScreenInfo *);
 gboolean                 compositorTestServer                   (DisplayInfo *);
+gint                     compositorGetRefreshRate               (ScreenInfo *);
+gboolean                 compositorSetPrePaintFunc              (ScreenInfo *,
+                                                                 CompositorPrePaintFunc,
+                                                                 gpointer);
+void                     compositorDumpScene                    (DisplayInfo *,
+                                                                 FILE *);
 
 #endif /* INC_COMPOSITOR_H */
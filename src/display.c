@@ -57,12 +57,110 @@
 #define CURSOR_MOVE XC_fleur
 #endif
 
+/* Upper bounds of the grab hold time histogram buckets, in usec */
+static const gint64 grab_bucket_limits[] =
+{
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000
+};
+
+typedef struct _GrabStats GrabStats;
+struct _GrabStats
+{
+    const gchar *site;
+    guint count;
+    gint64 total;
+    gint64 max;
+    guint buckets[G_N_ELEMENTS (grab_bucket_limits) + 1];
+};
+
+/* Error traps, kept in the order they were pushed */
+typedef struct _ErrorTrap ErrorTrap;
+struct _ErrorTrap
+{
+    unsigned long start_serial;
+    unsigned long end_serial;
+    gboolean closed;
+    int error_code;
+};
+
+/* The X error handler has no user data */
+static DisplayInfo *error_display = NULL;
+
+static gboolean
+serial_is_before (unsigned long a, unsigned long b)
+{
+    /* Serials wrap around */
+    return ((long) (a - b) < 0);
+}
+
+static ErrorTrap *
+find_error_trap (DisplayInfo *display, unsigned long serial)
+{
+    ErrorTrap *trap;
+    GList *l;
+
+    /* Innermost first */
+    for (l = g_queue_peek_tail_link (display->error_traps); l; l = g_list_previous (l))
+    {
+        trap = (ErrorTrap *) l->data;
+        if (serial_is_before (serial, trap->start_serial))
+        {
+            continue;
+        }
+        if ((!trap->closed) || !serial_is_before (trap->end_serial, serial))
+        {
+            return trap;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+prune_error_traps (DisplayInfo *display)
+{
+    unsigned long processed;
+    ErrorTrap *trap;
+    GList *l, *next;
+
+    processed = LastKnownRequestProcessed (display->dpy);
+    for (l = g_queue_peek_head_link (display->error_traps); l; l = next)
+    {
+        next = g_list_next (l);
+        trap = (ErrorTrap *) l->data;
+        /* Any error for these requests would have been reported by now */
+        if ((trap->closed) && !serial_is_before (processed, trap->end_serial))
+        {
+            g_queue_delete_link (display->error_traps, l);
+            g_free (trap);
+        }
+    }
+}
+
 static int
 handleXError (Display * dpy, XErrorEvent * err)
 {
+    ErrorTrap *trap;
 #if DEBUG
     char buf[64];
+#endif
+
+    if ((error_display) && (error_display->dpy == dpy))
+    {
+        trap = find_error_trap (error_display, err->serial);
+        if (trap)
+        {
+            if (trap->error_code == 0)
+            {
+                trap->error_code = err->error_code;
+            }
+            error_display->errors_trapped++;
+            return 0;
+        }
+        error_display->errors_untrapped++;
+    }
 
+#if DEBUG
     XGetErrorText (dpy, err->error_code, buf, 63);
     fprintf (stderr, "XError: %s\n", buf);
     fprintf (stderr, "==>  XID 0x%lx, Request %d, Error %d <==\n",
@@ -116,6 +214,8 @@ myDisplayInitAtoms (DisplayInfo *display_info)
         "_NET_WM_ALLOWED_ACTIONS",
         "_NET_WM_CONTEXT_HELP",
         "_NET_WM_DESKTOP",
+        "_NET_WM_FRAME_DRAWN",
+        "_NET_WM_FRAME_TIMINGS",
         "_NET_WM_FULLSCREEN_MONITORS",
         "_NET_WM_ICON",
         "_NET_WM_ICON_GEOMETRY",
@@ -197,6 +297,38 @@ myDisplayCreateTimestampWin (DisplayInfo *display_info)
                        CWEventMask | CWOverrideRedirect, &attributes);
 }
 
+/*
+ * The core events only tell where the pointer is when it is over our own
+ * windows, XInput2 raw events tell us whenever it moves anywhere so we
+ * know when the position we have is outdated.
+ */
+static void
+myDisplayTrackPointer (DisplayInfo *display)
+{
+#ifdef HAVE_XI2
+    XIEventMask mask;
+    unsigned char bits[XIMaskLen (XI_LASTEVENT)] = { 0 };
+    int i;
+
+    if (!display->have_xi2)
+    {
+        return;
+    }
+
+    XISetMask (bits, XI_RawMotion);
+    XISetMask (bits, XI_RawButtonPress);
+    XISetMask (bits, XI_RawButtonRelease);
+    mask.deviceid = XIAllMasterDevices;
+    mask.mask_len = sizeof (bits);
+    mask.mask = bits;
+
+    for (i = 0; i < ScreenCount (display->dpy); i++)
+    {
+        XISelectEvents (display->dpy, RootWindow (display->dpy, i), &mask, 1);
+    }
+#endif /* HAVE_XI2 */
+}
+
 DisplayInfo *
 myDisplayInit (GdkDisplay *gdisplay)
 {
@@ -213,7 +345,20 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->session = NULL;
     display->quit = FALSE;
     display->reload = FALSE;
-
+    display->dump = FALSE;
+    display->prefetch = NULL;
+    display->prefetch_hits = 0;
+    display->prefetch_misses = 0;
+    display->grab_stats = NULL;
+    display->grab_site = NULL;
+    display->grab_start = 0;
+    display->error_traps = g_queue_new ();
+    display->error_traps_async = 0;
+    display->error_traps_synced = 0;
+    display->errors_trapped = 0;
+    display->errors_untrapped = 0;
+
+    error_display = display;
     XSetErrorHandler (handleXError);
 
     /* Initialize internal atoms */
@@ -270,6 +415,29 @@ myDisplayInit (GdkDisplay *gdisplay)
     }
 #endif /* HAVE_XSYNC */
 
+#ifdef HAVE_XI2
+    display->have_xi2 = FALSE;
+    display->xi2_opcode = 0;
+
+    /* Before 2.1, raw events only go to the grabbing client while a grab is active */
+    major = 2;
+    minor = 1;
+    if (XQueryExtension (display->dpy, "XInputExtension",
+                         &display->xi2_opcode, &dummy, &dummy)
+        && (XIQueryVersion (display->dpy, &major, &minor) == Success)
+        && ((major > 2) || ((major == 2) && (minor >= 1))))
+    {
+        display->have_xi2 = TRUE;
+    }
+    else
+    {
+        g_warning ("The display does not support XInput 2.1.");
+        display->xi2_opcode = 0;
+    }
+#else  /* HAVE_XI2 */
+    display->have_xi2 = FALSE;
+#endif /* HAVE_XI2 */
+
 #ifdef HAVE_RENDER
     if (XRenderQueryExtension (display->dpy,
                                &display->render_event_base,
@@ -318,6 +486,13 @@ myDisplayInit (GdkDisplay *gdisplay)
     display->double_click_distance = 5;
     display->nb_screens = 0;
     display->current_time = CurrentTime;
+    display->current_time_clock = 0;
+    display->timestamp_pending = FALSE;
+    display->pointer_root = None;
+    display->pointer_valid = FALSE;
+    display->pointer_hits = 0;
+    display->pointer_queries = 0;
+    myDisplayTrackPointer (display);
 
     hostnametmp = g_new0 (gchar, (size_t) MAX_HOSTNAME_LENGTH + 1);
     if (gethostname ((char *) hostnametmp, MAX_HOSTNAME_LENGTH))
@@ -354,6 +529,29 @@ myDisplayClose (DisplayInfo *display)
     g_slist_free (display->screens);
     display->screens = NULL;
 
+    if (display->prefetch)
+    {
+        g_hash_table_destroy (display->prefetch);
+        display->prefetch = NULL;
+    }
+
+    if (display->grab_stats)
+    {
+        g_hash_table_destroy (display->grab_stats);
+        display->grab_stats = NULL;
+    }
+
+    while (!g_queue_is_empty (display->error_traps))
+    {
+        g_free (g_queue_pop_head (display->error_traps));
+    }
+    g_queue_free (display->error_traps);
+    display->error_traps = NULL;
+    if (error_display == display)
+    {
+        error_display = NULL;
+    }
+
     return display;
 }
 
@@ -461,16 +659,51 @@ myDisplayGetCursorResize (DisplayInfo *display, guint list)
 }
 
 
+static void
+record_grab (DisplayInfo *display, const gchar *site, gint64 duration)
+{
+    GrabStats *stats;
+    guint i;
+
+    if (display->grab_stats == NULL)
+    {
+        display->grab_stats = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    }
+
+    stats = g_hash_table_lookup (display->grab_stats, site);
+    if (stats == NULL)
+    {
+        stats = g_new0 (GrabStats, 1);
+        stats->site = site;
+        g_hash_table_insert (display->grab_stats, (gpointer) site, stats);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (grab_bucket_limits); i++)
+    {
+        if (duration < grab_bucket_limits[i])
+        {
+            break;
+        }
+    }
+    stats->buckets[i]++;
+    stats->count++;
+    stats->total += duration;
+    stats->max = MAX (stats->max, duration);
+}
+
 void
-myDisplayGrabServer (DisplayInfo *display)
+myDisplayGrabServerAt (DisplayInfo *display, const gchar *site)
 {
     g_return_if_fail (display);
 
-    DBG ("entering myDisplayGrabServer");
+    DBG ("entering myDisplayGrabServer from %s", site);
     if (display->xgrabcount == 0)
     {
         DBG ("grabbing server");
         XGrabServer (display->dpy);
+        /* Nested grabs are accounted to the outermost one */
+        display->grab_site = site;
+        display->grab_start = g_get_monotonic_time ();
     }
     display->xgrabcount++;
     DBG ("grabs : %i", display->xgrabcount);
@@ -492,10 +725,164 @@ myDisplayUngrabServer (DisplayInfo *display)
         DBG ("ungrabbing server");
         XUngrabServer (display->dpy);
         XFlush (display->dpy);
+        if (display->grab_site)
+        {
+            record_grab (display, display->grab_site,
+                         g_get_monotonic_time () - display->grab_start);
+            display->grab_site = NULL;
+        }
     }
     DBG ("grabs : %i", display->xgrabcount);
 }
 
+/*
+ * Replacements for gdk_error_trap_push/pop (). The errors are matched with
+ * the trap by their request serial number as they come in, so that a trap
+ * can be popped without waiting for the server.
+ */
+void
+myDisplayErrorTrapPush (DisplayInfo *display)
+{
+    ErrorTrap *trap;
+
+    g_return_if_fail (display != NULL);
+
+    prune_error_traps (display);
+    trap = g_new0 (ErrorTrap, 1);
+    trap->start_serial = NextRequest (display->dpy);
+    trap->closed = FALSE;
+    g_queue_push_tail (display->error_traps, trap);
+}
+
+static ErrorTrap *
+close_error_trap (DisplayInfo *display)
+{
+    ErrorTrap *trap;
+    GList *l;
+
+    for (l = g_queue_peek_tail_link (display->error_traps); l; l = g_list_previous (l))
+    {
+        trap = (ErrorTrap *) l->data;
+        if (!trap->closed)
+        {
+            trap->end_serial = NextRequest (display->dpy) - 1;
+            trap->closed = TRUE;
+            return trap;
+        }
+    }
+
+    g_warning ("Error trap popped without being pushed");
+    return NULL;
+}
+
+/* Returns the first error caught, waits for the server only if needed */
+int
+myDisplayErrorTrapPop (DisplayInfo *display)
+{
+    ErrorTrap *trap;
+    int error_code;
+
+    g_return_val_if_fail (display != NULL, 0);
+
+    trap = close_error_trap (display);
+    if (trap == NULL)
+    {
+        return 0;
+    }
+
+    if (serial_is_before (LastKnownRequestProcessed (display->dpy), trap->end_serial))
+    {
+        XSync (display->dpy, FALSE);
+        display->error_traps_synced++;
+    }
+    else
+    {
+        /* The last request had a reply, all errors are in already */
+        display->error_traps_async++;
+    }
+
+    error_code = trap->error_code;
+    g_queue_remove (display->error_traps, trap);
+    g_free (trap);
+
+    return error_code;
+}
+
+/* For when the caller does not care, never waits for the server */
+void
+myDisplayErrorTrapPopIgnored (DisplayInfo *display)
+{
+    g_return_if_fail (display != NULL);
+
+    if (close_error_trap (display))
+    {
+        display->error_traps_async++;
+    }
+    prune_error_traps (display);
+}
+
+void
+myDisplayDumpErrorTraps (DisplayInfo *display, FILE *f)
+{
+    g_return_if_fail (display != NULL);
+    g_return_if_fail (f != NULL);
+
+    fprintf (f, "[ERROR_TRAPS] %u pending\n", g_queue_get_length (display->error_traps));
+    fprintf (f, "  [ASYNC] %u\n", display->error_traps_async);
+    fprintf (f, "  [SYNCED] %u\n", display->error_traps_synced);
+    fprintf (f, "  [ERRORS] trapped=%u untrapped=%u\n",
+             display->errors_trapped, display->errors_untrapped);
+}
+
+static gint
+compare_grab_stats (gconstpointer a, gconstpointer b)
+{
+    const GrabStats *sa = a;
+    const GrabStats *sb = b;
+
+    /* Worst offenders first */
+    if (sa->total != sb->total)
+    {
+        return (sa->total > sb->total) ? -1 : 1;
+    }
+    return g_strcmp0 (sa->site, sb->site);
+}
+
+void
+myDisplayDumpGrabs (DisplayInfo *display, FILE *f)
+{
+    GrabStats *stats;
+    GList *list, *l;
+    guint i;
+
+    g_return_if_fail (display != NULL);
+    g_return_if_fail (f != NULL);
+
+    fprintf (f, "[GRABS] %s\n", display->xgrabcount ? display->grab_site : "none held");
+    if (display->grab_stats == NULL)
+    {
+        return;
+    }
+
+    list = g_list_sort (g_hash_table_get_values (display->grab_stats), compare_grab_stats);
+    for (l = list; l; l = g_list_next (l))
+    {
+        stats = (GrabStats *) l->data;
+        fprintf (f, "  [SITE] %s\n", stats->site);
+        fprintf (f, "    [COUNT] %u\n", stats->count);
+        fprintf (f, "    [HOLD_TIME] avg=%" G_GINT64_FORMAT " max=%" G_GINT64_FORMAT
+                    " total=%" G_GINT64_FORMAT " usec\n",
+                 stats->total / stats->count, stats->max, stats->total);
+        fprintf (f, "    [HISTOGRAM]");
+        for (i = 0; i < G_N_ELEMENTS (grab_bucket_limits); i++)
+        {
+            fprintf (f, " <%" G_GINT64_FORMAT ":%u", grab_bucket_limits[i], stats->buckets[i]);
+        }
+        fprintf (f, " more:%u\n", stats->buckets[i]);
+    }
+    g_list_free (list);
+}
+
 void
 myDisplayAddClient (DisplayInfo *display, Client *c)
 {
@@ -709,6 +1096,66 @@ myDisplayGetDefaultScreen (DisplayInfo *display)
     return NULL;
 }
 
+static void
+update_pointer (DisplayInfo *display, XEvent *ev)
+{
+    switch (ev->type)
+    {
+        case KeyPress:
+        case KeyRelease:
+            display->pointer_root = ev->xkey.root;
+            display->pointer_x = ev->xkey.x_root;
+            display->pointer_y = ev->xkey.y_root;
+            display->pointer_mask = ev->xkey.state;
+            break;
+        case ButtonPress:
+        case ButtonRelease:
+            display->pointer_root = ev->xbutton.root;
+            display->pointer_x = ev->xbutton.x_root;
+            display->pointer_y = ev->xbutton.y_root;
+            display->pointer_mask = ev->xbutton.state;
+            /* The state is the one before the event */
+            if ((ev->xbutton.button >= Button1) && (ev->xbutton.button <= Button5))
+            {
+                if (ev->type == ButtonPress)
+                {
+                    display->pointer_mask |= (Button1Mask << (ev->xbutton.button - Button1));
+                }
+                else
+                {
+                    display->pointer_mask &= ~(Button1Mask << (ev->xbutton.button - Button1));
+                }
+            }
+            break;
+        case MotionNotify:
+            display->pointer_root = ev->xmotion.root;
+            display->pointer_x = ev->xmotion.x_root;
+            display->pointer_y = ev->xmotion.y_root;
+            display->pointer_mask = ev->xmotion.state;
+            break;
+        case EnterNotify:
+        case LeaveNotify:
+            display->pointer_root = ev->xcrossing.root;
+            display->pointer_x = ev->xcrossing.x_root;
+            display->pointer_y = ev->xcrossing.y_root;
+            display->pointer_mask = ev->xcrossing.state;
+            break;
+        default:
+#ifdef HAVE_XI2
+            if ((display->have_xi2) && (ev->type == GenericEvent)
+                && (ev->xcookie.extension == display->xi2_opcode))
+            {
+                /* Moved or clicked somewhere, we don't know where */
+                display->pointer_valid = FALSE;
+            }
+#endif /* HAVE_XI2 */
+            return;
+    }
+
+    /* Synthetic events can say anything */
+    display->pointer_valid = !(ev->xany.send_event);
+}
+
 guint32
 myDisplayUpdateCurrentTime (DisplayInfo *display, XEvent *ev)
 {
@@ -716,6 +1163,8 @@ myDisplayUpdateCurrentTime (DisplayInfo *display, XEvent *ev)
 
     g_return_val_if_fail (display != NULL, (guint32) CurrentTime);
 
+    update_pointer (display, ev);
+
     timestamp = (guint32) CurrentTime;
     switch (ev->type)
     {
@@ -736,6 +1185,10 @@ myDisplayUpdateCurrentTime (DisplayInfo *display, XEvent *ev)
             break;
         case PropertyNotify:
             timestamp = (guint32) ev->xproperty.time;
+            if (ev->xproperty.window == display->timestamp_win)
+            {
+                display->timestamp_pending = FALSE;
+            }
             break;
         case SelectionClear:
             timestamp = (guint32) ev->xselectionclear.time;
@@ -759,6 +1212,7 @@ myDisplayUpdateCurrentTime (DisplayInfo *display, XEvent *ev)
     if ((timestamp != (guint32) CurrentTime) && TIMESTAMP_IS_BEFORE(display->current_time, timestamp))
     {
         display->current_time = timestamp;
+        display->current_time_clock = g_get_monotonic_time ();
     }
 
     return display->current_time;
@@ -822,6 +1276,92 @@ myDisplayUpdateLastUserTime (DisplayInfo *display, guint32 timestamp)
     }
 }
 
+/*
+ * Pointer position in root coordinates, from the events we got when they
+ * still tell where it is, from the server otherwise. Returns FALSE, with
+ * the position set to 0,0, if the pointer is not on the given root
+ * window. Without XInput2 there is no way to tell the position is still
+ * accurate, so this always asks.
+ */
+gboolean
+myDisplayGetPointer (DisplayInfo *display, Window root, int *x, int *y, unsigned int *mask)
+{
+    Window dr, window;
+    unsigned int modifiers;
+    int rx, ry, wx, wy;
+    gboolean same_screen;
+
+    g_return_val_if_fail (display != NULL, FALSE);
+    g_return_val_if_fail (root != None, FALSE);
+
+    if ((display->have_xi2) && (display->pointer_valid) && (display->pointer_root == root))
+    {
+        display->pointer_hits++;
+    }
+    else
+    {
+        display->pointer_queries++;
+        same_screen = XQueryPointer (display->dpy, root, &dr, &window,
+                                     &rx, &ry, &wx, &wy, &modifiers);
+        display->pointer_root = dr;
+        display->pointer_x = rx;
+        display->pointer_y = ry;
+        display->pointer_mask = modifiers;
+        display->pointer_valid = TRUE;
+        if (!same_screen)
+        {
+            /* Like XQueryPointer () relative to a root on another screen */
+            if (x)
+            {
+                *x = 0;
+            }
+            if (y)
+            {
+                *y = 0;
+            }
+            if (mask)
+            {
+                *mask = modifiers;
+            }
+            return FALSE;
+        }
+    }
+
+    if (x)
+    {
+        *x = display->pointer_x;
+    }
+    if (y)
+    {
+        *y = display->pointer_y;
+    }
+    if (mask)
+    {
+        *mask = display->pointer_mask;
+    }
+
+    return TRUE;
+}
+
+void
+myDisplayInvalidatePointer (DisplayInfo *display)
+{
+    g_return_if_fail (display != NULL);
+
+    display->pointer_valid = FALSE;
+}
+
+void
+myDisplayDumpPointer (DisplayInfo *display, FILE *f)
+{
+    g_return_if_fail (display != NULL);
+    g_return_if_fail (f != NULL);
+
+    fprintf (f, "[POINTER] %s\n", display->have_xi2 ? "tracked" : "queried");
+    fprintf (f, "  [CACHED] %u\n", display->pointer_hits);
+    fprintf (f, "  [QUERIED] %u\n", display->pointer_queries);
+}
+
 gboolean
 myDisplayTestXrender (DisplayInfo *display, gdouble min_time)
 {
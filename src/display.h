@@ -27,6 +27,7 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <X11/X.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -45,6 +46,10 @@
 #include <X11/extensions/sync.h>
 #endif /* HAVE_XSYNC */
 
+#ifdef HAVE_XI2
+#include <X11/extensions/XInput2.h>
+#endif /* HAVE_XI2 */
+
 #ifdef HAVE_COMPOSITOR
 #include <X11/extensions/Xcomposite.h>
 #include <X11/extensions/Xdamage.h>
@@ -210,6 +215,8 @@ enum
     NET_WM_ALLOWED_ACTIONS,
     NET_WM_CONTEXT_HELP,
     NET_WM_DESKTOP,
+    NET_WM_FRAME_DRAWN,
+    NET_WM_FRAME_TIMINGS,
     NET_WM_FULLSCREEN_MONITORS,
     NET_WM_ICON,
     NET_WM_ICON_GEOMETRY,
@@ -288,6 +295,24 @@ struct _DisplayInfo
     XfceSMClient *session;
     gboolean quit;
     gboolean reload;
+    gboolean dump;
+
+    /* Properties read ahead or cached, see prefetch.c */
+    GHashTable *prefetch;
+    guint64 prefetch_hits;
+    guint64 prefetch_misses;
+
+    /* Server grab hold times per call site, see myDisplayDumpGrabs () */
+    GHashTable *grab_stats;
+    const gchar *grab_site;
+    gint64 grab_start;
+
+    /* See myDisplayErrorTrapPush () */
+    GQueue *error_traps;
+    guint error_traps_async;
+    guint error_traps_synced;
+    guint errors_trapped;
+    guint errors_untrapped;
 
     Window timestamp_win;
     Cursor busy_cursor;
@@ -305,6 +330,7 @@ struct _DisplayInfo
     gboolean have_render;
     gboolean have_xrandr;
     gboolean have_xsync;
+    gboolean have_xi2;
     gint shape_version;
     gint shape_event_base;
     gint double_click_time;
@@ -315,6 +341,18 @@ struct _DisplayInfo
 
     guint32 current_time;
     guint32 last_user_time;
+    /* When current_time was last advanced, see getXServerTime () */
+    gint64 current_time_clock;
+    gboolean timestamp_pending;
+
+    /* Last known pointer position, see myDisplayGetPointer () */
+    Window pointer_root;
+    gint pointer_x;
+    gint pointer_y;
+    guint pointer_mask;
+    gboolean pointer_valid;
+    guint pointer_hits;
+    guint pointer_queries;
 
     gboolean enable_compositor;
 #ifdef HAVE_RENDER
@@ -329,6 +367,9 @@ struct _DisplayInfo
     gint xsync_event_base;
     gint xsync_error_base;
 #endif /* HAVE_XSYNC */
+#ifdef HAVE_XI2
+    gint xi2_opcode;
+#endif /* HAVE_XI2 */
 #ifdef HAVE_COMPOSITOR
     gint composite_error_base;
     gint composite_event_base;
@@ -365,8 +406,16 @@ Cursor                   myDisplayGetCursorMove                 (DisplayInfo *);
 Cursor                   myDisplayGetCursorRoot                 (DisplayInfo *);
 Cursor                   myDisplayGetCursorResize               (DisplayInfo *,
                                                                  guint);
-void                     myDisplayGrabServer                    (DisplayInfo *);
+void                     myDisplayGrabServerAt                  (DisplayInfo *,
+                                                                 const gchar *);
 void                     myDisplayUngrabServer                  (DisplayInfo *);
+void                     myDisplayDumpGrabs                     (DisplayInfo *,
+                                                                 FILE *);
+void                     myDisplayErrorTrapPush                 (DisplayInfo *);
+int                      myDisplayErrorTrapPop                  (DisplayInfo *);
+void                     myDisplayErrorTrapPopIgnored           (DisplayInfo *);
+void                     myDisplayDumpErrorTraps                (DisplayInfo *,
+                                                                 FILE *);
 void                     myDisplayAddClient                     (DisplayInfo *,
                                                                  Client *);
 void                     myDisplayRemoveClient                  (DisplayInfo *,
@@ -405,7 +454,18 @@ void                     myDisplaySetLastUserTime               (DisplayInfo *,
                                                                  guint32);
 void                     myDisplayUpdateLastUserTime            (DisplayInfo *,
                                                                  guint32);
+gboolean                 myDisplayGetPointer                    (DisplayInfo *,
+                                                                 Window,
+                                                                 int *,
+                                                                 int *,
+                                                                 unsigned int *);
+void                     myDisplayInvalidatePointer             (DisplayInfo *);
+void                     myDisplayDumpPointer                   (DisplayInfo *,
+                                                                 FILE *);
 gboolean                 myDisplayTestXrender                   (DisplayInfo *,
                                                                  gdouble);
 
+/* Account the grab to the calling function */
+#define myDisplayGrabServer(display) myDisplayGrabServerAt (display, G_STRFUNC)
+
 #endif /* INC_DISPLAY_H */
@@ -30,7 +30,49 @@
 #include <X11/Xlib.h>
 
 #include <libxfce4util/libxfce4util.h>
+#include <string.h>
 #include "event_filter.h"
+#include "event_record.h"
+
+static const gchar *event_names[] =
+{
+    NULL,
+    NULL,
+    "KeyPress",
+    "KeyRelease",
+    "ButtonPress",
+    "ButtonRelease",
+    "MotionNotify",
+    "EnterNotify",
+    "LeaveNotify",
+    "FocusIn",
+    "FocusOut",
+    "KeymapNotify",
+    "Expose",
+    "GraphicsExpose",
+    "NoExpose",
+    "VisibilityNotify",
+    "CreateNotify",
+    "DestroyNotify",
+    "UnmapNotify",
+    "MapNotify",
+    "MapRequest",
+    "ReparentNotify",
+    "ConfigureNotify",
+    "ConfigureRequest",
+    "GravityNotify",
+    "ResizeRequest",
+    "CirculateNotify",
+    "CirculateRequest",
+    "PropertyNotify",
+    "SelectionClear",
+    "SelectionRequest",
+    "SelectionNotify",
+    "ColormapNotify",
+    "ClientMessage",
+    "MappingNotify",
+    "GenericEvent"
+};
 
 static eventFilterStatus
 default_event_filter (XEvent * xevent, gpointer data)
@@ -135,6 +177,125 @@ default_event_filter (XEvent * xevent, gpointer data)
     return EVENT_FILTER_STOP;
 }
 
+/* Only what xfwm4-replay uses is kept, the rest is recorded as XAnyEvent */
+static gsize
+record_event_size (XEvent *xevent)
+{
+    switch (xevent->type)
+    {
+        case KeyPress:
+        case KeyRelease:
+            return sizeof (XKeyEvent);
+        case ButtonPress:
+        case ButtonRelease:
+            return sizeof (XButtonEvent);
+        case MotionNotify:
+            return sizeof (XMotionEvent);
+        case CreateNotify:
+            return sizeof (XCreateWindowEvent);
+        case DestroyNotify:
+            return sizeof (XDestroyWindowEvent);
+        case UnmapNotify:
+            return sizeof (XUnmapEvent);
+        case MapRequest:
+            return sizeof (XMapRequestEvent);
+        case ConfigureRequest:
+            return sizeof (XConfigureRequestEvent);
+        case PropertyNotify:
+            return sizeof (XPropertyEvent);
+        case ClientMessage:
+            return sizeof (XClientMessageEvent);
+        default:
+            break;
+    }
+    return sizeof (XAnyEvent);
+}
+
+static void
+record_entry (eventFilterSetup *setup, guint16 kind, gconstpointer data, gsize size)
+{
+    EventRecordEntry entry;
+    gint64 now;
+
+    now = g_get_monotonic_time ();
+    entry.delta = (guint32) MIN (now - setup->record_time, G_MAXUINT32);
+    entry.kind = kind;
+    entry.size = (guint16) size;
+    setup->record_time = now;
+
+    if ((fwrite (&entry, sizeof (entry), 1, setup->record) != 1) ||
+        (fwrite (data, size, 1, setup->record) != 1))
+    {
+        g_warning ("Cannot write the event recording, stopping");
+        fclose (setup->record);
+        setup->record = NULL;
+    }
+}
+
+/* Atoms differ from one server to another, store their name once */
+static void
+record_atom (eventFilterSetup *setup, Display *dpy, Atom atom)
+{
+    guchar *buffer;
+    gchar *name;
+    guint32 id;
+    gsize len;
+
+    if ((atom == None) || (setup->record == NULL) ||
+        (g_hash_table_lookup (setup->record_atoms, GUINT_TO_POINTER (atom))))
+    {
+        return;
+    }
+    g_hash_table_insert (setup->record_atoms, GUINT_TO_POINTER (atom), GUINT_TO_POINTER (TRUE));
+
+    gdk_error_trap_push ();
+    name = XGetAtomName (dpy, atom);
+    gdk_error_trap_pop ();
+    if (name == NULL)
+    {
+        return;
+    }
+
+    id = (guint32) atom;
+    len = MIN (strlen (name), G_MAXUINT16 - sizeof (id));
+    buffer = g_malloc (sizeof (id) + len);
+    memcpy (buffer, &id, sizeof (id));
+    memcpy (buffer + sizeof (id), name, len);
+    XFree (name);
+
+    record_entry (setup, EVENT_RECORD_ATOM, buffer, sizeof (id) + len);
+    g_free (buffer);
+}
+
+static void
+record_event (eventFilterSetup *setup, XEvent *xevent)
+{
+    Display *dpy;
+    Atom net_wm_state;
+
+    dpy = xevent->xany.display;
+    if (xevent->type == PropertyNotify)
+    {
+        record_atom (setup, dpy, xevent->xproperty.atom);
+    }
+    else if (xevent->type == ClientMessage)
+    {
+        record_atom (setup, dpy, xevent->xclient.message_type);
+        /* The only message carrying atoms that the replay translates */
+        net_wm_state = XInternAtom (dpy, "_NET_WM_STATE", FALSE);
+        if ((xevent->xclient.message_type == net_wm_state) && (xevent->xclient.format == 32))
+        {
+            record_atom (setup, dpy, (Atom) xevent->xclient.data.l[1]);
+            record_atom (setup, dpy, (Atom) xevent->xclient.data.l[2]);
+        }
+    }
+
+    if (setup->record)
+    {
+        record_entry (setup, EVENT_RECORD_EVENT, xevent, record_event_size (xevent));
+    }
+}
+
 static GdkFilterReturn
 eventXfwmFilter (GdkXEvent * gdk_xevent, GdkEvent * event, gpointer data)
 {
@@ -142,6 +303,9 @@ eventXfwmFilter (GdkXEvent * gdk_xevent, GdkEvent * event, gpointer data)
     eventFilterStatus loop;
     eventFilterSetup *setup;
     eventFilterStack *filterelt;
+    eventFilterTiming *timing;
+    gint64 start, elapsed, outer_nested;
+    guint queued, type;
 
     setup = (eventFilterSetup *) data;
     g_return_val_if_fail (setup != NULL, GDK_FILTER_CONTINUE);
@@ -152,17 +316,59 @@ eventXfwmFilter (GdkXEvent * gdk_xevent, GdkEvent * event, gpointer data)
     xevent = (XEvent *) gdk_xevent;
     loop = EVENT_FILTER_CONTINUE;
 
+    if (setup->record)
+    {
+        record_event (setup, xevent);
+    }
+
+    /* Whatever is still waiting behind this event */
+    queued = XEventsQueued (xevent->xany.display, QueuedAlready);
+    type = xevent->type % EVENT_FILTER_TYPE_COUNT;
+
     while ((filterelt) && (loop == EVENT_FILTER_CONTINUE))
     {
         eventFilterStack *filterelt_next = filterelt->next;
+        /* The filter may pop itself */
+        timing = &filterelt->timings->types[type];
+
+        /* Move, resize, cycle and menus run a loop from inside a filter, see eventFilterPop () */
+        outer_nested = setup->nested_time;
+        setup->nested_time = 0;
+        start = g_get_monotonic_time ();
+
         loop = (*filterelt->filter) (xevent, filterelt->data);
+
+        elapsed = g_get_monotonic_time () - start;
+        timing->count++;
+        timing->total_time += elapsed - setup->nested_time;
+        timing->max_time = MAX (timing->max_time, elapsed - setup->nested_time);
+        timing->total_queued += queued;
+        timing->max_queued = MAX (timing->max_queued, queued);
+        setup->nested_time = outer_nested + elapsed;
+
         filterelt = filterelt_next;
     }
     return (loop & EVENT_FILTER_REMOVE) ? GDK_FILTER_REMOVE : GDK_FILTER_CONTINUE;
 }
 
+static eventFilterTimings *
+get_timings (eventFilterSetup *setup, const gchar *name)
+{
+    eventFilterTimings *timings;
+
+    timings = g_hash_table_lookup (setup->timings, name);
+    if (timings == NULL)
+    {
+        timings = g_new0 (eventFilterTimings, 1);
+        timings->name = name;
+        g_hash_table_insert (setup->timings, (gpointer) name, timings);
+    }
+
+    return timings;
+}
+
 eventFilterStack *
-eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
+eventFilterPushNamed (eventFilterSetup *setup, XfwmFilter filter, gpointer data, const gchar *name)
 {
     g_assert (filter != NULL);
     if (setup->filterstack)
@@ -171,6 +377,9 @@ eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
             (eventFilterStack *) g_new (eventFilterStack, 1);
         newfilterstack->filter = filter;
         newfilterstack->data = data;
+        newfilterstack->timings = get_timings (setup, name);
+        newfilterstack->push_time = g_get_monotonic_time ();
+        newfilterstack->push_nested = setup->nested_time;
         newfilterstack->next = setup->filterstack;
         setup->filterstack = newfilterstack;
     }
@@ -180,6 +389,9 @@ eventFilterPush (eventFilterSetup *setup, XfwmFilter filter, gpointer data)
             (eventFilterStack *) g_new (eventFilterStack, 1);
         setup->filterstack->filter = filter;
         setup->filterstack->data = data;
+        setup->filterstack->timings = get_timings (setup, name);
+        setup->filterstack->push_time = g_get_monotonic_time ();
+        setup->filterstack->push_nested = setup->nested_time;
         setup->filterstack->next = NULL;
     }
     return (setup->filterstack);
@@ -194,6 +406,16 @@ eventFilterPop (eventFilterSetup *setup)
 
     oldfilterstack = setup->filterstack;
     setup->filterstack = oldfilterstack->next;
+
+    /*
+     * A filter is pushed for the main loop it runs in, move, resize, cycle
+     * and menus do that from inside the filter handling an event. All the
+     * time it was in place, idle and other sources included, belongs to
+     * that loop and not to the event that started it. This replaces the
+     * time of the filters called meanwhile, which it covers.
+     */
+    setup->nested_time = oldfilterstack->push_nested +
+        (g_get_monotonic_time () - oldfilterstack->push_time);
     g_free (oldfilterstack);
 
     return (setup->filterstack);
@@ -241,6 +463,10 @@ eventFilterInit (gpointer data)
 
     setup = g_new0 (eventFilterSetup, 1);
     setup->filterstack = NULL;
+    setup->timings = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    setup->nested_time = 0;
+    setup->record = NULL;
+    setup->record_atoms = NULL;
     eventFilterPush (setup, default_event_filter, data);
     gdk_window_add_filter (NULL, eventXfwmFilter, (gpointer) setup);
 
@@ -256,4 +482,136 @@ eventFilterClose (eventFilterSetup *setup)
     while ((filterelt = eventFilterPop (setup)));
     gdk_window_remove_filter (NULL, eventXfwmFilter, NULL);
     setup->filterstack = NULL;
+    g_hash_table_destroy (setup->timings);
+    setup->timings = NULL;
+
+    if (setup->record)
+    {
+        fclose (setup->record);
+        setup->record = NULL;
+    }
+    if (setup->record_atoms)
+    {
+        g_hash_table_destroy (setup->record_atoms);
+        setup->record_atoms = NULL;
+    }
+}
+
+/*
+ * Writes every event going through the filters to the given file, for
+ * use with xfwm4-replay. See event_record.h for the format.
+ */
+gboolean
+eventFilterRecord (eventFilterSetup *setup, Display *dpy, const gchar *filename)
+{
+    EventRecordHeader header;
+
+    g_return_val_if_fail (setup != NULL, FALSE);
+    g_return_val_if_fail (filename != NULL, FALSE);
+
+    if (setup->record)
+    {
+        fclose (setup->record);
+    }
+    setup->record = fopen (filename, "wb");
+    if (setup->record == NULL)
+    {
+        g_warning ("Cannot open %s to record events", filename);
+        return FALSE;
+    }
+
+    memset (&header, 0, sizeof (header));
+    header.magic = EVENT_RECORD_MAGIC;
+    header.version = EVENT_RECORD_VERSION;
+    header.long_size = sizeof (long);
+    header.root = (guint32) DefaultRootWindow (dpy);
+    if (fwrite (&header, sizeof (header), 1, setup->record) != 1)
+    {
+        g_warning ("Cannot write to %s", filename);
+        fclose (setup->record);
+        setup->record = NULL;
+        return FALSE;
+    }
+
+    if (setup->record_atoms == NULL)
+    {
+        setup->record_atoms = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+    setup->record_time = g_get_monotonic_time ();
+
+    return TRUE;
+}
+
+/*
+ * For the events a handler takes off the queue itself, e.g. to merge them
+ * with the one it is handling, so that they still get recorded and
+ * counted. They are counted against the top filter, the time spent on
+ * them is already accounted to the event they were merged into.
+ */
+void
+eventFilterRecordEvent (eventFilterSetup *setup, XEvent *xevent)
+{
+    eventFilterTiming *timing;
+    guint queued;
+
+    g_return_if_fail (setup != NULL);
+    g_return_if_fail (xevent != NULL);
+
+    if (setup->record)
+    {
+        record_event (setup, xevent);
+    }
+
+    if (setup->filterstack)
+    {
+        queued = XEventsQueued (xevent->xany.display, QueuedAlready);
+        timing = &setup->filterstack->timings->types[xevent->type % EVENT_FILTER_TYPE_COUNT];
+        timing->count++;
+        timing->total_queued += queued;
+        timing->max_queued = MAX (timing->max_queued, queued);
+    }
+}
+
+static void
+dump_timings (gpointer key, gpointer value, gpointer user_data)
+{
+    eventFilterTimings *timings;
+    eventFilterTiming *timing;
+    FILE *f;
+    guint i;
+
+    timings = (eventFilterTimings *) value;
+    f = (FILE *) user_data;
+
+    fprintf (f, "  [FILTER] %s\n", timings->name);
+    for (i = 0; i < EVENT_FILTER_TYPE_COUNT; i++)
+    {
+        timing = &timings->types[i];
+        if (timing->count == 0)
+        {
+            continue;
+        }
+        if ((i < G_N_ELEMENTS (event_names)) && (event_names[i]))
+        {
+            fprintf (f, "    [%s]", event_names[i]);
+        }
+        else
+        {
+            fprintf (f, "    [EVENT %u]", i);
+        }
+        fprintf (f, " count=%u time avg=%" G_GINT64_FORMAT " max=%" G_GINT64_FORMAT " usec"
+                    " queued avg=%" G_GUINT64_FORMAT " max=%u\n",
+                 timing->count, timing->total_time / timing->count, timing->max_time,
+                 timing->total_queued / timing->count, timing->max_queued);
+    }
+}
+
+void
+eventFilterDump (eventFilterSetup *setup, FILE *f)
+{
+    g_return_if_fail (setup != NULL);
+    g_return_if_fail (f != NULL);
+
+    fprintf (f, "[EVENT_FILTERS]\n");
+    g_hash_table_foreach (setup->timings, dump_timings, f);
 }
@@ -27,10 +27,14 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 #include <X11/Xlib.h>
 
+/* Event types are 7 bits wide, the top bit is the send_event flag */
+#define EVENT_FILTER_TYPE_COUNT 128
+
 /* this formatting is needed by glib-mkenums */
 typedef enum {
     EVENT_FILTER_STOP     = 0x0,
@@ -42,10 +46,32 @@ eventFilterStatus;
 
 typedef eventFilterStatus (*XfwmFilter) (XEvent * xevent, gpointer data);
 
+typedef struct eventFilterTiming
+{
+    guint count;
+    gint64 total_time;
+    gint64 max_time;
+    guint64 total_queued;
+    guint max_queued;
+}
+eventFilterTiming;
+
+/* Kept across pushes, per filter function */
+typedef struct eventFilterTimings
+{
+    const gchar *name;
+    eventFilterTiming types[EVENT_FILTER_TYPE_COUNT];
+}
+eventFilterTimings;
+
 typedef struct eventFilterStack
 {
     XfwmFilter filter;
     gpointer data;
+    eventFilterTimings *timings;
+    /* When pushed, to take the loop it runs out of the outer filter time */
+    gint64 push_time;
+    gint64 push_nested;
     struct eventFilterStack *next;
 }
 eventFilterStack;
@@ -53,16 +79,34 @@ eventFilterStack;
 typedef struct eventFilterSetup
 {
     eventFilterStack *filterstack;
+    GHashTable *timings;
+    /* Time spent in nested filters and loops, not accounted to the outer filter */
+    gint64 nested_time;
+    /* See eventFilterRecord () */
+    FILE *record;
+    gint64 record_time;
+    GHashTable *record_atoms;
 }
 eventFilterSetup;
 
 GdkWindow               *eventFilterAddWin                      (GdkScreen *,
                                                                  long);
-eventFilterStack        *eventFilterPush                        (eventFilterSetup *,
+eventFilterStack        *eventFilterPushNamed                   (eventFilterSetup *,
                                                                  XfwmFilter,
-                                                                 gpointer );
+                                                                 gpointer,
+                                                                 const gchar *);
 eventFilterStack        *eventFilterPop                         (eventFilterSetup *);
 eventFilterSetup        *eventFilterInit                        (gpointer);
 void                     eventFilterClose                       (eventFilterSetup *);
+void                     eventFilterDump                        (eventFilterSetup *,
+                                                                 FILE *);
+gboolean                 eventFilterRecord                      (eventFilterSetup *,
+                                                                 Display *,
+                                                                 const gchar *);
+void                     eventFilterRecordEvent                 (eventFilterSetup *,
+                                                                 XEvent *);
+
+/* Timings are reported under the name of the filter function */
+#define eventFilterPush(setup, filter, data) eventFilterPushNamed (setup, filter, data, #filter)
 
 #endif /* INC_EVENT_FILTER_H */
@@ -0,0 +1,59 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * File format of the event recordings written with --record-events and
+ * read back by xfwm4-replay. Events are stored as the Xlib structures,
+ * so a recording can only be replayed on the same architecture.
+ */
+
+#ifndef INC_EVENT_RECORD_H
+#define INC_EVENT_RECORD_H
+
+#include <glib.h>
+
+#define EVENT_RECORD_MAGIC   0x56454658 /* "XFEV" */
+#define EVENT_RECORD_VERSION 1
+
+/* Entry kinds */
+#define EVENT_RECORD_EVENT   0   /* followed by the first size bytes of an XEvent */
+#define EVENT_RECORD_ATOM    1   /* followed by a guint32 atom and its name */
+
+typedef struct _EventRecordHeader EventRecordHeader;
+struct _EventRecordHeader
+{
+    guint32 magic;
+    guint16 version;
+    guint16 long_size;
+    guint32 root;
+    guint32 reserved;
+};
+
+typedef struct _EventRecordEntry EventRecordEntry;
+struct _EventRecordEntry
+{
+    guint32 delta;               /* usec since the previous entry */
+    guint16 kind;
+    guint16 size;                /* of what follows */
+};
+
+#endif /* INC_EVENT_RECORD_H */
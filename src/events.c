@@ -25,7 +25,9 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
@@ -56,6 +58,7 @@
 #include "transients.h"
 #include "focus.h"
 #include "netwm.h"
+#include "prefetch.h"
 #include "menu.h"
 #include "hints.h"
 #include "startup_notification.h"
@@ -1307,6 +1310,128 @@ handleConfigureNotify (DisplayInfo *display_info, XConfigureEvent * ev)
     return EVENT_FILTER_PASS;
 }
 
+typedef struct
+{
+    Window window;
+    gboolean blocked;
+} ConfigureRequestMatch;
+
+static Bool
+match_configure_request (Display *dpy, XEvent *ev, XPointer data)
+{
+    ConfigureRequestMatch *match;
+    Window w;
+
+    match = (ConfigureRequestMatch *) data;
+    if (match->blocked)
+    {
+        return False;
+    }
+
+    switch (ev->type)
+    {
+        case ConfigureRequest:
+            return (ev->xconfigurerequest.window == match->window);
+        case DestroyNotify:
+            w = ev->xdestroywindow.window;
+            break;
+        case UnmapNotify:
+            w = ev->xunmap.window;
+            break;
+        case MapNotify:
+            w = ev->xmap.window;
+            break;
+        case MapRequest:
+            w = ev->xmaprequest.window;
+            break;
+        case ReparentNotify:
+            w = ev->xreparent.window;
+            break;
+        case ConfigureNotify:
+            w = ev->xconfigure.window;
+            break;
+        default:
+            w = ev->xany.window;
+            break;
+    }
+
+    /* Don't merge requests across anything else happening to that window */
+    if (w == match->window)
+    {
+        match->blocked = TRUE;
+    }
+
+    return False;
+}
+
+static void
+merge_configure_request (XConfigureRequestEvent *ev, XConfigureRequestEvent *next)
+{
+    if (next->value_mask & CWX)
+    {
+        ev->x = next->x;
+    }
+    if (next->value_mask & CWY)
+    {
+        ev->y = next->y;
+    }
+    if (next->value_mask & CWWidth)
+    {
+        ev->width = next->width;
+    }
+    if (next->value_mask & CWHeight)
+    {
+        ev->height = next->height;
+    }
+    if (next->value_mask & CWBorderWidth)
+    {
+        ev->border_width = next->border_width;
+    }
+    if (next->value_mask & CWStackMode)
+    {
+        /* Only the last restack matters, with or without its sibling */
+        ev->value_mask &= ~CWSibling;
+        ev->detail = next->detail;
+        if (next->value_mask & CWSibling)
+        {
+            ev->above = next->above;
+        }
+    }
+    ev->value_mask |= next->value_mask;
+    ev->serial = next->serial;
+    ev->send_event = next->send_event;
+}
+
+/*
+ * Some clients (video players, Java, Electron...) send bursts of
+ * ConfigureRequests, fold the ones already queued for the same window
+ * into the current one so that only the final geometry gets applied.
+ */
+static void
+coalesceConfigureRequests (DisplayInfo *display_info, XConfigureRequestEvent * ev)
+{
+    ConfigureRequestMatch match;
+    XEvent next;
+    int merged;
+
+    merged = 0;
+    match.window = ev->window;
+    match.blocked = FALSE;
+    while (XCheckIfEvent (display_info->dpy, &next, match_configure_request, (XPointer) &match))
+    {
+        /* These never go through the event filter */
+        eventFilterRecordEvent (display_info->xfilter, &next);
+        merge_configure_request (ev, &next.xconfigurerequest);
+        match.blocked = FALSE;
+        merged++;
+    }
+
+    if (merged)
+    {
+        TRACE ("coalesced %i ConfigureRequest for window (0x%lx)", merged, ev->window);
+    }
+}
+
 static eventFilterStatus
 handleConfigureRequest (DisplayInfo *display_info, XConfigureRequestEvent * ev)
 {
@@ -1316,6 +1441,8 @@ handleConfigureRequest (DisplayInfo *display_info, XConfigureRequestEvent * ev)
     TRACE ("entering handleConfigureRequest");
     TRACE ("ConfigureRequest on window (0x%lx)", ev->window);
 
+    coalesceConfigureRequests (display_info, ev);
+
     wc.x = ev->x;
     wc.y = ev->y;
     wc.width = ev->width;
@@ -1684,6 +1811,9 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
     TRACE ("entering handlePropertyNotify");
 
     status = EVENT_FILTER_PASS;
+    /* Before anyone gets a chance to read the old value */
+    prefetchForget (display_info, ev->window, ev->atom);
+
     c = myDisplayGetClientFromWindow (display_info, ev->window, SEARCH_WINDOW | SEARCH_WIN_USER_TIME);
     if (c)
     {
@@ -1716,12 +1846,13 @@ handlePropertyNotify (DisplayInfo *display_info, XPropertyEvent * ev)
                 XFree (c->wmhints);
             }
 
-            c->wmhints = XGetWMHints (display_info->dpy, c->window);
+            c->wmhints = getWMHints (display_info, c->window);
             if (c->wmhints)
             {
                 if (c->wmhints->flags & WindowGroupHint)
                 {
                     c->group_leader = c->wmhints->window_group;
+                    clientUpdateTransientRelations (c);
                 }
                 if ((c->wmhints->flags & IconPixmapHint) && (screen_info->params->show_app_icon))
                 {
@@ -2170,12 +2301,63 @@ handleXSyncAlarmNotify (DisplayInfo *display_info, XSyncAlarmNotifyEvent * ev)
         if (c)
         {
             clientXSyncUpdateValue (c, ev->counter_value);
+            if (!FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER) || clientXSyncFrameComplete (c))
+            {
+                compositorWindowRedrawn (display_info, c->frame);
+            }
+            if (clientXSyncFrameComplete (c) &&
+                !compositorWindowFrameComplete (display_info, c->frame))
+            {
+                /* Not composited by us, the frame is on screen already */
+                clientXSyncFrameDrawn (c, c->xsync_value, g_get_monotonic_time ());
+                clientXSyncFrameTimings (c, c->xsync_value, 0, 0);
+            }
         }
     }
     return EVENT_FILTER_REMOVE;
 }
 #endif /* HAVE_XSYNC */
 
+void
+dumpState (DisplayInfo *display_info)
+{
+    gchar *path;
+    gchar *filename;
+    FILE *f;
+
+    TRACE ("entering dumpState");
+
+    path = xfce_resource_save_location (XFCE_RESOURCE_CACHE, "xfwm4", TRUE);
+    if (!path)
+    {
+        g_warning ("Cannot create the directory for the state dump");
+        return;
+    }
+
+    filename = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "state-%d-%" G_GINT64_FORMAT ".txt",
+                                path, (gint) getpid (), g_get_real_time () / G_USEC_PER_SEC);
+    g_free (path);
+
+    if (!(f = fopen (filename, "w")))
+    {
+        g_warning ("Cannot write the state dump to %s", filename);
+        g_free (filename);
+        return;
+    }
+
+    compositorDumpScene (display_info, f);
+    clientDumpStacking (display_info, f);
+    myDisplayDumpGrabs (display_info, f);
+    myDisplayDumpErrorTraps (display_info, f);
+    myDisplayDumpPointer (display_info, f);
+    prefetchDump (display_info, f);
+    eventFilterDump (display_info->xfilter, f);
+    fclose (f);
+
+    g_message ("State dumped to %s", filename);
+    g_free (filename);
+}
+
 static eventFilterStatus
 handleEvent (DisplayInfo *display_info, XEvent * ev)
 {
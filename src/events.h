@@ -42,4 +42,5 @@ eventFilterStatus        xfwm4_event_filter                     (XEvent *,
                                                                  gpointer);
 void                     initPerScreenCallbacks                 (ScreenInfo *);
 void                     initPerDisplayCallbacks                (DisplayInfo *);
+void                     dumpState                              (DisplayInfo *);
 #endif /* INC_EVENTS_H */
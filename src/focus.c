@@ -341,9 +341,7 @@ clientPassFocus (ScreenInfo *screen_info, Client *c, GList *exclude_list)
     ClientPair top_most;
     Client *new_focus;
     Client *current_focus;
-    Window dr, window;
-    unsigned int mask;
-    int rx, ry, wx, wy;
+    int rx, ry;
     int look_in_layer;
 
     TRACE ("entering clientPassFocus");
@@ -366,7 +364,7 @@ clientPassFocus (ScreenInfo *screen_info, Client *c, GList *exclude_list)
     top_most = clientGetTopMostFocusable (screen_info, look_in_layer, exclude_list);
 
     if (!(screen_info->params->click_to_focus) &&
-        XQueryPointer (myScreenGetXDisplay (screen_info), screen_info->xroot, &dr, &window, &rx, &ry, &wx, &wy, &mask))
+        myDisplayGetPointer (display_info, screen_info->xroot, &rx, &ry, NULL))
     {
         new_focus = clientAtPosition (screen_info, rx, ry, exclude_list);
     }
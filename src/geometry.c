@@ -0,0 +1,1200 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <glib.h>
+#include <gdk/gdk.h>
+
+#include "geometry.h"
+
+#define MAX_VALID_STRUT(n) (n / 4) /* 25% of available space */
+
+/* Compute segment overlap length */
+
+unsigned long
+geometrySegmentOverlap (gint x0, gint x1, gint tx0, gint tx1)
+{
+    if (tx0 > x0)
+    {
+        x0 = tx0;
+    }
+    if (tx1 < x1)
+    {
+        x1 = tx1;
+    }
+    if (x1 <= x0)
+    {
+        return 0;
+    }
+    return (x1 - x0);
+}
+
+/*
+ * Occupancy of a set of rectangles, such as the windows smartPlacement()
+ * has to avoid. Their edges cut the area in cells, each covered by a known
+ * number of rectangles, and sums[] holds for each cell corner the covered
+ * area above and left of it, counted once per covering rectangle. The
+ * overlap of any rectangle with the whole set is then read from its four
+ * corners.
+ */
+static gint
+compare_edges (gconstpointer a, gconstpointer b)
+{
+    return *((const gint *) a) - *((const gint *) b);
+}
+
+static guint
+sort_edges (gint *edges, guint n)
+{
+    guint i, j;
+
+    if (n == 0)
+    {
+        return 0;
+    }
+    qsort (edges, n, sizeof (gint), compare_edges);
+    for (i = 1, j = 1; i < n; i++)
+    {
+        if (edges[i] != edges[j - 1])
+        {
+            edges[j++] = edges[i];
+        }
+    }
+    return j;
+}
+
+/* Index of the last edge at or before v, -1 if there is none */
+static gint
+find_edge (const gint *edges, guint n, gint v)
+{
+    guint lo, hi, mid;
+
+    lo = 0;
+    hi = n;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (edges[mid] <= v)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (gint) lo - 1;
+}
+
+/* First edge after v, G_MAXINT if there is none */
+static gint
+next_edge (const gint *edges, guint n, gint v)
+{
+    gint i;
+
+    i = find_edge (edges, n, v) + 1;
+    return ((guint) i < n) ? edges[i] : G_MAXINT;
+}
+
+void
+geometryIndexInit (GeometryIndex *index, GdkRectangle *rects, guint n)
+{
+    GdkRectangle *rect;
+    gint64 *sums;
+    gint *count;
+    guint nx, ny, i, j;
+    gint x0, x1, y0, y1;
+
+    index->xs = g_new (gint, 2 * n + 1);
+    index->ys = g_new (gint, 2 * n + 1);
+    for (i = 0; i < n; i++)
+    {
+        rect = &rects[i];
+        index->xs[2 * i] = rect->x;
+        index->xs[2 * i + 1] = rect->x + rect->width;
+        index->ys[2 * i] = rect->y;
+        index->ys[2 * i + 1] = rect->y + rect->height;
+    }
+    nx = index->nx = sort_edges (index->xs, 2 * n);
+    ny = index->ny = sort_edges (index->ys, 2 * n);
+
+    /* Number of windows over each cell, from the changes at their corners */
+    count = index->count = g_new0 (gint, nx * ny + 1);
+    for (i = 0; i < n; i++)
+    {
+        rect = &rects[i];
+        x0 = find_edge (index->xs, nx, rect->x);
+        x1 = find_edge (index->xs, nx, rect->x + rect->width);
+        y0 = find_edge (index->ys, ny, rect->y);
+        y1 = find_edge (index->ys, ny, rect->y + rect->height);
+        count[y0 * nx + x0]++;
+        count[y0 * nx + x1]--;
+        count[y1 * nx + x0]--;
+        count[y1 * nx + x1]++;
+    }
+    for (j = 0; j < ny; j++)
+    {
+        for (i = 0; i < nx; i++)
+        {
+            if (i > 0)
+            {
+                count[j * nx + i] += count[j * nx + i - 1];
+            }
+            if (j > 0)
+            {
+                count[j * nx + i] += count[(j - 1) * nx + i];
+            }
+            if ((i > 0) && (j > 0))
+            {
+                count[j * nx + i] -= count[(j - 1) * nx + i - 1];
+            }
+        }
+    }
+
+    sums = index->sums = g_new0 (gint64, nx * ny + 1);
+    for (j = 1; j < ny; j++)
+    {
+        for (i = 1; i < nx; i++)
+        {
+            sums[j * nx + i] = sums[(j - 1) * nx + i] + sums[j * nx + i - 1]
+                             - sums[(j - 1) * nx + i - 1]
+                             + (gint64) count[(j - 1) * nx + i - 1]
+                               * (index->xs[i] - index->xs[i - 1])
+                               * (index->ys[j] - index->ys[j - 1]);
+        }
+    }
+}
+
+void
+geometryIndexFree (GeometryIndex *index)
+{
+    g_free (index->xs);
+    g_free (index->ys);
+    g_free (index->count);
+    g_free (index->sums);
+}
+
+/* Covered area above and left of (x,y) */
+static gint64
+index_area (GeometryIndex *index, gint x, gint y)
+{
+    gint64 area;
+    gint64 dx, dy;
+    guint nx;
+    gint i, j;
+
+    nx = index->nx;
+    i = find_edge (index->xs, nx, x);
+    j = find_edge (index->ys, index->ny, y);
+    if ((i < 0) || (j < 0))
+    {
+        return 0;
+    }
+
+    area = index->sums[j * nx + i];
+    dx = ((guint) i + 1 < nx) ? x - index->xs[i] : 0;
+    dy = ((guint) j + 1 < index->ny) ? y - index->ys[j] : 0;
+    if (dx > 0)
+    {
+        area += dx * ((index->sums[j * nx + i + 1] - index->sums[j * nx + i])
+                      / (index->xs[i + 1] - index->xs[i]));
+    }
+    if (dy > 0)
+    {
+        area += dy * ((index->sums[(j + 1) * nx + i] - index->sums[j * nx + i])
+                      / (index->ys[j + 1] - index->ys[j]));
+    }
+    if ((dx > 0) && (dy > 0))
+    {
+        area += dx * dy * index->count[j * nx + i];
+    }
+
+    return area;
+}
+
+gint64
+geometryIndexOverlap (GeometryIndex *index, gint x0, gint y0, gint x1, gint y1)
+{
+    return index_area (index, x1, y1)
+         - index_area (index, x0, y1)
+         - index_area (index, x1, y0)
+         + index_area (index, x0, y0);
+}
+
+gint
+geometryIndexNextX (GeometryIndex *index, gint x)
+{
+    return next_edge (index->xs, index->nx, x);
+}
+
+gint
+geometryIndexNextY (GeometryIndex *index, gint y)
+{
+    return next_edge (index->ys, index->ny, y);
+}
+
+/*
+ * Look for the position of a frame_width x frame_height frame overlapping
+ * the rectangles the least, with its client at x between xmin and xmax,
+ * y between ymin and ymax. Rows are scanned from the top and the first
+ * position without any overlap wins. Returns the overlap at the position
+ * found.
+ *
+ * geometrySmartPlacementScan () is the original search, summing the
+ * overlap with each rectangle at each candidate. From the left edge of a
+ * rectangle it steps to its right edge, and takes the y steps from the
+ * rectangles seen at the start of each row.
+ *
+ * geometrySmartPlacementIndexed () reads overlaps from a GeometryIndex
+ * and steps to every x and y edge, a superset of the candidates above,
+ * so it may settle on a different position. Building the index only pays
+ * off with many windows, see GEOMETRY_INDEX_MIN.
+ */
+gint64
+geometrySmartPlacement (GdkRectangle *rects, guint n, gint xmin, gint ymin, gint xmax, gint ymax,
+                        gint frame_left, gint frame_top, gint frame_width, gint frame_height,
+                        gint *x, gint *y)
+{
+    if (n < GEOMETRY_INDEX_MIN)
+    {
+        return geometrySmartPlacementScan (rects, n, xmin, ymin, xmax, ymax,
+                                           frame_left, frame_top, frame_width, frame_height,
+                                           x, y);
+    }
+    return geometrySmartPlacementIndexed (rects, n, xmin, ymin, xmax, ymax,
+                                          frame_left, frame_top, frame_width, frame_height,
+                                          x, y);
+}
+
+gint64
+geometrySmartPlacementScan (GdkRectangle *rects, guint n, gint xmin, gint ymin, gint xmax, gint ymax,
+                            gint frame_left, gint frame_top, gint frame_width, gint frame_height,
+                            gint *x, gint *y)
+{
+    gint64 best_overlaps, count_overlaps;
+    gint test_x, test_y, best_x, best_y;
+    gint next_test_x, next_test_y;
+    gint c2_x, c2_y;
+    gboolean first_test_x;
+    guint i;
+
+    /* start with worst-case position at top-left */
+    best_overlaps = G_MAXINT64;
+    best_x = xmin;
+    best_y = ymin;
+
+    test_y = ymin;
+    do
+    {
+        next_test_y = G_MAXINT;
+        first_test_x = TRUE;
+
+        test_x = xmin;
+        do
+        {
+            count_overlaps = 0;
+            next_test_x = G_MAXINT;
+
+            for (i = 0; i < n; i++)
+            {
+                c2_x = rects[i].x;
+                c2_y = rects[i].y;
+                count_overlaps += (gint64) geometrySegmentOverlap (test_x - frame_left,
+                                                                   test_x - frame_left + frame_width,
+                                                                   c2_x, c2_x + rects[i].width)
+                                         * geometrySegmentOverlap (test_y - frame_top,
+                                                                   test_y - frame_top + frame_height,
+                                                                   c2_y, c2_y + rects[i].height);
+
+                /* find the next x boundary for the step */
+                if (test_x > c2_x)
+                {
+                    /* test location is beyond the x of the window,
+                     * take the window right corner as next target */
+                    c2_x += rects[i].width;
+                }
+                if ((MIN (c2_x, xmax) < next_test_x) && (MIN (c2_x, xmax) > test_x))
+                {
+                    /* set new optimal next x step position */
+                    next_test_x = MIN (c2_x, xmax);
+                }
+
+                if (first_test_x)
+                {
+                    /* find the next y boundary step */
+                    if (test_y > c2_y)
+                    {
+                        /* test location is beyond the y of the window,
+                         * take the window bottom corner as next target */
+                        c2_y += rects[i].height;
+                    }
+                    if ((MIN (c2_y, ymax) < next_test_y) && (MIN (c2_y, ymax) > test_y))
+                    {
+                        /* set new optimal next y step position */
+                        next_test_y = MIN (c2_y, ymax);
+                    }
+                }
+            }
+
+            /* don't look for the next y boundary this x row */
+            first_test_x = FALSE;
+
+            if (count_overlaps < best_overlaps)
+            {
+                /* found position with less overlap */
+                best_x = test_x;
+                best_y = test_y;
+                best_overlaps = count_overlaps;
+
+                if (count_overlaps == 0)
+                {
+                    /* overlap is ideal, stop searching */
+                    goto found_best;
+                }
+            }
+
+            if (G_LIKELY (next_test_x != G_MAXINT))
+            {
+                test_x = MAX (next_test_x, next_test_x + frame_left);
+                if (test_x > xmax)
+                {
+                   /* always clamp on the monitor */
+                   test_x = xmax;
+                }
+            }
+            else
+            {
+                test_x++;
+            }
+        }
+        while (test_x <= xmax);
+
+        if (G_LIKELY (next_test_y != G_MAXINT))
+        {
+            test_y = MAX (next_test_y, next_test_y + frame_top);
+            if (test_y > ymax)
+            {
+                /* always clamp on the monitor */
+                test_y = ymax;
+            }
+        }
+        else
+        {
+            test_y++;
+        }
+    }
+    while (test_y <= ymax);
+
+    found_best:
+    *x = best_x;
+    *y = best_y;
+
+    return best_overlaps;
+}
+
+gint64
+geometrySmartPlacementIndexed (GdkRectangle *rects, guint n, gint xmin, gint ymin, gint xmax, gint ymax,
+                               gint frame_left, gint frame_top, gint frame_width, gint frame_height,
+                               gint *x, gint *y)
+{
+    GeometryIndex index;
+    gint64 best_overlaps, count_overlaps;
+    gint test_x, test_y, best_x, best_y;
+    gint next_test_x, next_test_y;
+
+    /* start with worst-case position at top-left */
+    best_overlaps = G_MAXINT64;
+    best_x = xmin;
+    best_y = ymin;
+
+    geometryIndexInit (&index, rects, n);
+
+    test_y = ymin;
+    do
+    {
+        /* the next y step is the next window edge below */
+        next_test_y = geometryIndexNextY (&index, test_y);
+        if ((next_test_y != G_MAXINT) && (MIN (next_test_y, ymax) > test_y))
+        {
+            next_test_y = MIN (next_test_y, ymax);
+        }
+        else
+        {
+            next_test_y = G_MAXINT;
+        }
+
+        test_x = xmin;
+        do
+        {
+            count_overlaps = geometryIndexOverlap (&index,
+                                                   test_x - frame_left,
+                                                   test_y - frame_top,
+                                                   test_x - frame_left + frame_width,
+                                                   test_y - frame_top + frame_height);
+
+            if (count_overlaps < best_overlaps)
+            {
+                /* found position with less overlap */
+                best_x = test_x;
+                best_y = test_y;
+                best_overlaps = count_overlaps;
+
+                if (count_overlaps == 0)
+                {
+                    /* overlap is ideal, stop searching */
+                    goto found_best;
+                }
+            }
+
+            /* the next x step is the next window edge on the right */
+            next_test_x = geometryIndexNextX (&index, test_x);
+            if ((next_test_x != G_MAXINT) && (MIN (next_test_x, xmax) > test_x))
+            {
+                test_x = MAX (next_test_x, next_test_x + frame_left);
+                if (test_x > xmax)
+                {
+                   /* always clamp on the monitor */
+                   test_x = xmax;
+                }
+            }
+            else
+            {
+                test_x++;
+            }
+        }
+        while (test_x <= xmax);
+
+        if (G_LIKELY (next_test_y != G_MAXINT))
+        {
+            test_y = MAX (next_test_y, next_test_y + frame_top);
+            if (test_y > ymax)
+            {
+                /* always clamp on the monitor */
+                test_y = ymax;
+            }
+        }
+        else
+        {
+            test_y++;
+        }
+    }
+    while (test_y <= ymax);
+
+    found_best:
+    geometryIndexFree (&index);
+
+    *x = best_x;
+    *y = best_y;
+
+    return best_overlaps;
+}
+
+/*
+ * Edge lists, one per side, let snapping look at the few edges within
+ * reach instead of every window.
+ */
+
+static gint
+compare_geometry_edges (gconstpointer a, gconstpointer b)
+{
+    const GeometryEdge *e1 = a;
+    const GeometryEdge *e2 = b;
+
+    return e1->pos - e2->pos;
+}
+
+void
+geometryEdgeAdd (GArray *edges, gint pos, gint start, gint end, guint seq)
+{
+    GeometryEdge edge;
+
+    edge.pos = pos;
+    edge.start = start;
+    edge.end = end;
+    edge.seq = seq;
+    g_array_append_val (edges, edge);
+}
+
+void
+geometryEdgesInit (GeometryEdges *edges)
+{
+    edges->left = g_array_new (FALSE, FALSE, sizeof (GeometryEdge));
+    edges->right = g_array_new (FALSE, FALSE, sizeof (GeometryEdge));
+    edges->top = g_array_new (FALSE, FALSE, sizeof (GeometryEdge));
+    edges->bottom = g_array_new (FALSE, FALSE, sizeof (GeometryEdge));
+}
+
+void
+geometryEdgesFree (GeometryEdges *edges)
+{
+    g_array_free (edges->left, TRUE);
+    g_array_free (edges->right, TRUE);
+    g_array_free (edges->top, TRUE);
+    g_array_free (edges->bottom, TRUE);
+}
+
+void
+geometryEdgesSort (GeometryEdges *edges)
+{
+    g_array_sort (edges->left, compare_geometry_edges);
+    g_array_sort (edges->right, compare_geometry_edges);
+    g_array_sort (edges->top, compare_geometry_edges);
+    g_array_sort (edges->bottom, compare_geometry_edges);
+}
+
+/*
+ * Look for the edge closest to pos, between min_pos and max_pos, of a
+ * window overlapping [start,end] on the other axis. It must be closer
+ * than *best_delta, or as close but earlier than *best_seq.
+ */
+gboolean
+geometryEdgesClosest (GArray *edges, gint pos, gint min_pos, gint max_pos,
+                      gint start, gint end, gint *best_delta, guint *best_seq, gint *best_pos)
+{
+    GeometryEdge *edge;
+    gboolean found;
+    guint lo, hi, mid;
+    gint delta;
+
+    found = FALSE;
+    lo = 0;
+    hi = edges->len;
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (g_array_index (edges, GeometryEdge, mid).pos < pos - *best_delta)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for (; lo < edges->len; lo++)
+    {
+        edge = &g_array_index (edges, GeometryEdge, lo);
+        if (edge->pos > pos + *best_delta)
+        {
+            break;
+        }
+        if ((edge->pos < min_pos) || (edge->pos > max_pos)
+            || (edge->start > end) || (edge->end < start))
+        {
+            continue;
+        }
+        delta = abs (edge->pos - pos);
+        if ((delta < *best_delta) || ((delta == *best_delta) && (edge->seq < *best_seq)))
+        {
+            *best_delta = delta;
+            *best_seq = edge->seq;
+            *best_pos = edge->pos;
+            found = TRUE;
+        }
+    }
+
+    return found;
+}
+
+
+/*
+ * Snap the frame to the monitor borders and to the edges within
+ * snap_width, the closest on each axis winning. With snap_resist, only
+ * edges the frame is moving into, along dx and dy, are taken. Returns
+ * which of frame->x and frame->y were changed.
+ */
+guint
+geometrySnapFrame (GeometryEdges *edges, GdkRectangle *frame, GdkRectangle *monitor,
+                   gint snap_width, gboolean snap_to_border, gboolean snap_resist, gint dx, gint dy)
+{
+    guint best_seq_x, best_seq_y;
+    gint edge;
+    gint min_edge, max_edge;
+    gint disp_x, disp_y, disp_max_x, disp_max_y;
+    gint frame_x, frame_y, frame_x2, frame_y2;
+    gint best_frame_x, best_frame_y;
+    gint best_delta_x, best_delta_y;
+    guint ret;
+
+    best_delta_x = snap_width + 1;
+    best_delta_y = snap_width + 1;
+    /* Snapping to a border wins over windows as close */
+    best_seq_x = 0;
+    best_seq_y = 0;
+
+    frame_x = frame->x;
+    frame_y = frame->y;
+    frame_x2 = frame_x + frame->width;
+    frame_y2 = frame_y + frame->height;
+    best_frame_x = frame_x;
+    best_frame_y = frame_y;
+
+    disp_x = monitor->x;
+    disp_y = monitor->y;
+    disp_max_x = monitor->x + monitor->width;
+    disp_max_y = monitor->y + monitor->height;
+
+    if (snap_to_border)
+    {
+        if (abs (disp_x - frame_x) < abs (disp_max_x - frame_x2))
+        {
+            if (!snap_resist || ((frame_x <= disp_x) && (dx < 0)))
+            {
+                best_delta_x = abs (disp_x - frame_x);
+                best_frame_x = disp_x;
+            }
+        }
+        else
+        {
+            if (!snap_resist || ((frame_x2 >= disp_max_x) && (dx > 0)))
+            {
+                best_delta_x = abs (disp_max_x - frame_x2);
+                best_frame_x = disp_max_x - frame->width;
+            }
+        }
+
+        if (abs (disp_y - frame_y) < abs (disp_max_y - frame_y2))
+        {
+            if (!snap_resist || ((frame_y <= disp_y) && (dy < 0)))
+            {
+                best_delta_y = abs (disp_y - frame_y);
+                best_frame_y = disp_y;
+            }
+        }
+        else
+        {
+            if (!snap_resist || ((frame_y2 >= disp_max_y) && (dy > 0)))
+            {
+                best_delta_y = abs (disp_max_y - frame_y2);
+                best_frame_y = disp_max_y - frame->height;
+            }
+        }
+    }
+
+    /* Nothing further than the snapping distance can be used */
+    best_delta_x = MIN (best_delta_x, snap_width + 1);
+    best_delta_y = MIN (best_delta_y, snap_width + 1);
+
+    min_edge = snap_resist ? frame_x : G_MININT;
+    if ((!snap_resist || (dx < 0))
+        && geometryEdgesClosest (edges->right, frame_x, min_edge, G_MAXINT, frame_y, frame_y2,
+                                 &best_delta_x, &best_seq_x, &edge))
+    {
+        best_frame_x = edge;
+    }
+    max_edge = snap_resist ? frame_x2 : G_MAXINT;
+    if ((!snap_resist || (dx > 0))
+        && geometryEdgesClosest (edges->left, frame_x2, G_MININT, max_edge, frame_y, frame_y2,
+                                 &best_delta_x, &best_seq_x, &edge))
+    {
+        best_frame_x = edge - frame->width;
+    }
+
+    min_edge = snap_resist ? frame_y : G_MININT;
+    if ((!snap_resist || (dy < 0))
+        && geometryEdgesClosest (edges->bottom, frame_y, min_edge, G_MAXINT, frame_x, frame_x2,
+                                 &best_delta_y, &best_seq_y, &edge))
+    {
+        best_frame_y = edge;
+    }
+    max_edge = snap_resist ? frame_y2 : G_MAXINT;
+    if ((!snap_resist || (dy > 0))
+        && geometryEdgesClosest (edges->top, frame_y2, G_MININT, max_edge, frame_x, frame_x2,
+                                 &best_delta_y, &best_seq_y, &edge))
+    {
+        best_frame_y = edge - frame->height;
+    }
+
+    ret = 0;
+    if (best_delta_x <= snap_width)
+    {
+        frame->x = best_frame_x;
+        ret |= GEOMETRY_SNAPPED_X;
+    }
+    if (best_delta_y <= snap_width)
+    {
+        frame->y = best_frame_y;
+        ret |= GEOMETRY_SNAPPED_Y;
+    }
+
+    return ret;
+}
+
+void
+geometryStrutsToRectangles (const gint *struts, gint screen_width, gint screen_height,
+                            GdkRectangle *left, GdkRectangle *right,
+                            GdkRectangle *top, GdkRectangle *bottom)
+{
+    if (left)
+    {
+        left->x = 0;
+        left->y = struts[STRUTS_LEFT_START_Y];
+        left->width = struts[STRUTS_LEFT];
+        left->height = struts[STRUTS_LEFT_END_Y] - struts[STRUTS_LEFT_START_Y];
+    }
+
+    if (right)
+    {
+        right->x = screen_width - struts[STRUTS_RIGHT];
+        right->y = struts[STRUTS_RIGHT_START_Y];
+        right->width = struts[STRUTS_RIGHT];
+        right->height = struts[STRUTS_RIGHT_END_Y] - struts[STRUTS_RIGHT_START_Y];
+    }
+
+    if (top)
+    {
+        top->x = struts[STRUTS_TOP_START_X];
+        top->y = 0;
+        top->width = struts[STRUTS_TOP_END_X] - struts[STRUTS_TOP_START_X];
+        top->height = struts[STRUTS_TOP];
+    }
+
+    if (bottom)
+    {
+        bottom->x = struts[STRUTS_BOTTOM_START_X];
+        bottom->y = screen_height - struts[STRUTS_BOTTOM];
+        bottom->width = struts[STRUTS_BOTTOM_END_X] - struts[STRUTS_BOTTOM_START_X];
+        bottom->height = struts[STRUTS_BOTTOM];
+    }
+}
+
+static gboolean
+rectangle_intersect (GdkRectangle *r1, GdkRectangle *r2, GdkRectangle *dest)
+{
+    gint x1, y1, x2, y2;
+
+    x1 = MAX (r1->x, r2->x);
+    y1 = MAX (r1->y, r2->y);
+    x2 = MIN (r1->x + r1->width, r2->x + r2->width);
+    y2 = MIN (r1->y + r1->height, r2->y + r2->height);
+    if ((x2 <= x1) || (y2 <= y1))
+    {
+        return FALSE;
+    }
+    if (dest)
+    {
+        dest->x = x1;
+        dest->y = y1;
+        dest->width = x2 - x1;
+        dest->height = y2 - y1;
+    }
+    return TRUE;
+}
+
+/* Struts covering too much of the monitor are ignored */
+gboolean
+geometryStrutsValid (GdkRectangle *struts, GdkRectangle *monitor, gint side)
+{
+    GdkRectangle intersect;
+
+    if (rectangle_intersect (struts, monitor, &intersect))
+    {
+        switch (side)
+        {
+            case STRUTS_LEFT:
+            case STRUTS_RIGHT:
+                return (intersect.width < MAX_VALID_STRUT(monitor->width));
+                break;
+            case STRUTS_TOP:
+            case STRUTS_BOTTOM:
+                return (intersect.height < MAX_VALID_STRUT(monitor->height));
+                break;
+            default:
+                break;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Keep the frame accessible on the monitor, fully visible if show_full,
+ * and out of the struts, except those of skip. Without show_full, at
+ * least min_visible of it and all of the title_visible first pixels of
+ * it are kept visible. Returns the GEOMETRY_CONSTRAINED_* sides that
+ * frame->x and frame->y were adjusted against.
+ */
+guint
+geometryConstrainFrame (GdkRectangle *frame, GdkRectangle *monitor, GeometryStruts *struts, guint n,
+                        gpointer skip, gint frame_top, gint title_visible, gint min_visible, gboolean show_full)
+{
+    GeometryStruts *s;
+    guint i;
+    guint ret;
+
+    ret = 0;
+    if (show_full)
+    {
+        for (i = 0; i < n; i++)
+        {
+            s = &struts[i];
+            if (s->data == skip)
+            {
+                continue;
+            }
+
+            /* right */
+            if (geometryStrutsValid (&s->right, monitor, STRUTS_RIGHT) &&
+                rectangle_intersect (&s->right, frame, NULL))
+            {
+                frame->x = s->right.x - frame->width;
+                ret |= GEOMETRY_CONSTRAINED_RIGHT;
+            }
+
+            /* Bottom */
+            if (geometryStrutsValid (&s->bottom, monitor, STRUTS_BOTTOM) &&
+                rectangle_intersect (&s->bottom, frame, NULL))
+            {
+                frame->y = s->bottom.y - frame->height;
+                ret |= GEOMETRY_CONSTRAINED_BOTTOM;
+            }
+        }
+
+        if (frame->x + frame->width >= monitor->x + monitor->width)
+        {
+            frame->x = monitor->x + monitor->width - frame->width;
+            ret |= GEOMETRY_CONSTRAINED_RIGHT;
+        }
+        if (frame->x <= monitor->x)
+        {
+            frame->x = monitor->x;
+            ret |= GEOMETRY_CONSTRAINED_LEFT;
+        }
+        if (frame->y + frame->height >= monitor->y + monitor->height)
+        {
+            frame->y = monitor->y + monitor->height - frame->height;
+            ret |= GEOMETRY_CONSTRAINED_BOTTOM;
+        }
+        if (frame->y <= monitor->y)
+        {
+            frame->y = monitor->y;
+            ret |= GEOMETRY_CONSTRAINED_TOP;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            s = &struts[i];
+            if (s->data == skip)
+            {
+                continue;
+            }
+
+            /* Left */
+            if (geometryStrutsValid (&s->left, monitor, STRUTS_LEFT) &&
+                rectangle_intersect (&s->left, frame, NULL))
+            {
+                frame->x = s->left.x + s->left.width;
+                ret |= GEOMETRY_CONSTRAINED_LEFT;
+            }
+
+            /* Top */
+            if (geometryStrutsValid (&s->top, monitor, STRUTS_TOP) &&
+                rectangle_intersect (&s->top, frame, NULL))
+            {
+                frame->y = s->top.y + s->top.height;
+                ret |= GEOMETRY_CONSTRAINED_TOP;
+            }
+        }
+    }
+    else
+    {
+        if (frame->x + frame->width <= monitor->x + min_visible)
+        {
+            frame->x = monitor->x + min_visible - frame->width;
+            ret |= GEOMETRY_CONSTRAINED_LEFT;
+        }
+        if (frame->x + min_visible >= monitor->x + monitor->width)
+        {
+            frame->x = monitor->x + monitor->width - min_visible;
+            ret |= GEOMETRY_CONSTRAINED_RIGHT;
+        }
+        if (frame->y + frame->height <= monitor->y + min_visible)
+        {
+            frame->y = monitor->y + min_visible - frame->height;
+            ret |= GEOMETRY_CONSTRAINED_TOP;
+        }
+        if (frame->y + min_visible >= monitor->y + monitor->height)
+        {
+            frame->y = monitor->y + monitor->height - min_visible;
+            ret |= GEOMETRY_CONSTRAINED_BOTTOM;
+        }
+        if ((frame->y <= monitor->y) && (frame->y >= monitor->y - frame_top))
+        {
+            frame->y = monitor->y;
+            ret |= GEOMETRY_CONSTRAINED_TOP;
+        }
+
+        /* Struts and other partial struts */
+        for (i = 0; i < n; i++)
+        {
+            s = &struts[i];
+            if (s->data == skip)
+            {
+                continue;
+            }
+
+            /* Right */
+            if (geometryStrutsValid (&s->right, monitor, STRUTS_RIGHT) &&
+                rectangle_intersect (&s->right, frame, NULL))
+            {
+                if (frame->x >= s->right.x - min_visible)
+                {
+                    frame->x = s->right.x - min_visible;
+                    ret |= GEOMETRY_CONSTRAINED_RIGHT;
+                }
+            }
+
+            /* Left */
+            if (geometryStrutsValid (&s->left, monitor, STRUTS_LEFT) &&
+                rectangle_intersect (&s->left, frame, NULL))
+            {
+                if (frame->x + frame->width <= s->left.x + s->left.width + min_visible)
+                {
+                    frame->x = s->left.x + s->left.width + min_visible - frame->width;
+                    ret |= GEOMETRY_CONSTRAINED_LEFT;
+                }
+            }
+
+            /* Bottom */
+            if (geometryStrutsValid (&s->bottom, monitor, STRUTS_BOTTOM) &&
+                rectangle_intersect (&s->bottom, frame, NULL))
+            {
+                if (frame->y >= s->bottom.y - min_visible)
+                {
+                    frame->y = s->bottom.y - min_visible;
+                    ret |= GEOMETRY_CONSTRAINED_BOTTOM;
+                }
+            }
+
+            /* Top */
+            if (geometryStrutsValid (&s->top, monitor, STRUTS_TOP) &&
+                rectangle_intersect (&s->top, frame, NULL))
+            {
+                if (geometrySegmentOverlap (frame->y, frame->y + title_visible,
+                                            s->top.y, s->top.y + s->top.height))
+                {
+                    frame->y = s->top.y + s->top.height;
+                    ret |= GEOMETRY_CONSTRAINED_TOP;
+                }
+                if (frame->y + frame->height <= s->top.y + s->top.height + min_visible)
+                {
+                    frame->y = s->top.y + s->top.height + min_visible - frame->height;
+                    ret |= GEOMETRY_CONSTRAINED_TOP;
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Offset of the client window from the reference point of its gravity */
+void
+geometryGravityOffset (gint gravity, gint left, gint right, gint top, gint bottom, gint *dx, gint *dy)
+{
+    switch (gravity)
+    {
+        case CenterGravity:
+            *dx = (left - right + 1) / 2;
+            *dy = (top - bottom + 1) / 2;
+            break;
+        case NorthGravity:
+            *dx = (left - right + 1) / 2;
+            *dy = top;
+            break;
+        case SouthGravity:
+            *dx = (left - right + 1) / 2;
+            *dy = - bottom;
+            break;
+        case EastGravity:
+            *dx = - right;
+            *dy = (top - bottom + 1) / 2;
+            break;
+        case WestGravity:
+            *dx = left;
+            *dy = (top - bottom + 1) / 2;
+            break;
+        case NorthWestGravity:
+            *dx = left;
+            *dy = top;
+            break;
+        case NorthEastGravity:
+            *dx = - right;
+            *dy = top;
+            break;
+        case SouthWestGravity:
+            *dx = left;
+            *dy = - bottom;
+            break;
+        case SouthEastGravity:
+            *dx = - right;
+            *dy = - bottom;
+            break;
+        case StaticGravity:
+        default:
+            *dx = 0;
+            *dy = 0;
+            break;
+    }
+}
+
+/*
+ * Apply the size hints to one dimension. Fullscreen and borderless
+ * maximized windows are not held to the increments and maximum size,
+ * and neither are applications resizing themselves to the increments.
+ */
+gint
+geometryCheckSize (XSizeHints *hints, gint size, gint base, gint min, gint max, gint incr,
+                   gboolean constrained, gboolean use_increments)
+{
+    gint size_return;
+
+    size_return = size;
+
+    if (constrained)
+    {
+        if (use_increments && (hints->flags & PResizeInc) && (incr))
+        {
+            gint a;
+            gint b = 0;
+
+            if (hints->flags & PBaseSize)
+            {
+                b = base;
+            }
+
+            a = (size_return - b) / incr;
+            size_return = b + (a * incr);
+        }
+        if (hints->flags & PMaxSize)
+        {
+            if (size_return > max)
+            {
+                size_return = max;
+            }
+        }
+    }
+
+    if (hints->flags & PMinSize)
+    {
+        if (size_return < min)
+        {
+            size_return = min;
+        }
+    }
+    if (size_return < 1)
+    {
+        size_return = 1;
+    }
+    return size_return;
+}
+
+/*
+ * Adjust width and height to the aspect ratio of the size hints. The
+ * other dimension is only grown to match when resizing from a side
+ * handle, adjust_width for the top and bottom ones, adjust_height for
+ * the left and right ones.
+ *
+ * The aspect ratio stuff is borrowed from uwm's CheckConsistency routine.
+ */
+
+#define MAKE_MULT(a,b) ((b==1) ? (a) : (((int)((a)/(b))) * (b)) )
+void
+geometryConstrainRatio (XSizeHints *hints, gboolean adjust_width, gboolean adjust_height,
+                        gint *width, gint *height)
+{
+    if (hints->flags & PAspect)
+    {
+        int xinc, yinc, minx, miny, maxx, maxy, delta;
+
+        xinc = hints->width_inc;
+        yinc = hints->height_inc;
+        minx = hints->min_aspect.x;
+        miny = hints->min_aspect.y;
+        maxx = hints->max_aspect.x;
+        maxy = hints->max_aspect.y;
+
+        if ((minx * *height > miny * *width) && (miny) && adjust_width)
+        {
+            /* Change width to match */
+            delta = MAKE_MULT (minx * *height /  miny - *width, xinc);
+            if (!(hints->flags & PMaxSize) ||
+                (*width + delta <= hints->max_width))
+            {
+                *width += delta;
+            }
+        }
+        if ((minx * *height > miny * *width) && (minx))
+        {
+            delta = MAKE_MULT (*height - *width * miny / minx, yinc);
+            if (!(hints->flags & PMinSize) ||
+                (*height - delta >= hints->min_height))
+            {
+                *height -= delta;
+            }
+            else
+            {
+                delta = MAKE_MULT (minx * *height / miny - *width, xinc);
+                if (!(hints->flags & PMaxSize) ||
+                    (*width + delta <= hints->max_width))
+                {
+                    *width += delta;
+                }
+            }
+        }
+
+        if ((maxx * *height < maxy * *width) && (maxx) && adjust_height)
+        {
+            delta = MAKE_MULT (*width * maxy / maxx - *height, yinc);
+            if (!(hints->flags & PMaxSize) ||
+                (*height + delta <= hints->max_height))
+            {
+                *height += delta;
+            }
+        }
+        if ((maxx * *height < maxy * *width) && (maxy))
+        {
+            delta = MAKE_MULT (*width - maxx * *height / maxy, xinc);
+            if (!(hints->flags & PMinSize) ||
+                (*width - delta >= hints->min_width))
+            {
+                *width -= delta;
+            }
+            else
+            {
+                delta = MAKE_MULT (*width * maxy / maxx - *height, yinc);
+                if (!(hints->flags & PMaxSize) ||
+                    (*height + delta <= hints->max_height))
+                {
+                    *height += delta;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,231 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * Geometry computations used by placement, snapping, constraints and
+ * size hints. Nothing in here knows about clients, screens or the X
+ * connection, so it can be built and exercised on its own.
+ */
+
+#ifndef INC_GEOMETRY_H
+#define INC_GEOMETRY_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <glib.h>
+#include <gdk/gdk.h>
+
+/* Layout of _NET_WM_STRUT_PARTIAL */
+#define STRUTS_LEFT                             0
+#define STRUTS_RIGHT                            1
+#define STRUTS_TOP                              2
+#define STRUTS_BOTTOM                           3
+#define STRUTS_LEFT_START_Y                     4
+#define STRUTS_LEFT_END_Y                       5
+#define STRUTS_RIGHT_START_Y                    6
+#define STRUTS_RIGHT_END_Y                      7
+#define STRUTS_TOP_START_X                      8
+#define STRUTS_TOP_END_X                        9
+#define STRUTS_BOTTOM_START_X                   10
+#define STRUTS_BOTTOM_END_X                     11
+
+/* Returned by geometryConstrainFrame () */
+#define GEOMETRY_CONSTRAINED_TOP                (1<<0)
+#define GEOMETRY_CONSTRAINED_BOTTOM             (1<<1)
+#define GEOMETRY_CONSTRAINED_LEFT               (1<<2)
+#define GEOMETRY_CONSTRAINED_RIGHT              (1<<3)
+
+/*
+ * Fewest windows for geometrySmartPlacement () to build a GeometryIndex,
+ * below that the scan is faster, see bench_placement_scaling ()
+ */
+#define GEOMETRY_INDEX_MIN                      200
+
+/* Returned by geometrySnapFrame () */
+#define GEOMETRY_SNAPPED_X                      (1<<0)
+#define GEOMETRY_SNAPPED_Y                      (1<<1)
+
+/* Covered area of a set of rectangles, see geometry.c */
+typedef struct _GeometryIndex GeometryIndex;
+struct _GeometryIndex
+{
+    gint *xs;
+    guint nx;
+    gint *ys;
+    guint ny;
+    gint *count;
+    gint64 *sums;
+};
+
+/* An edge of a rectangle, sorted on its position along one axis */
+typedef struct _GeometryEdge GeometryEdge;
+struct _GeometryEdge
+{
+    gint pos;
+    gint start, end;            /* extent on the other axis */
+    guint seq;                  /* wins ties with later ones */
+};
+
+/* Edges to snap to, one sorted GArray of GeometryEdge per side */
+typedef struct _GeometryEdges GeometryEdges;
+struct _GeometryEdges
+{
+    GArray *left;
+    GArray *right;
+    GArray *top;
+    GArray *bottom;
+};
+
+/* The struts of one window as rectangles, data is its owner */
+typedef struct _GeometryStruts GeometryStruts;
+struct _GeometryStruts
+{
+    gpointer data;
+    GdkRectangle left;
+    GdkRectangle right;
+    GdkRectangle top;
+    GdkRectangle bottom;
+};
+
+unsigned long            geometrySegmentOverlap                 (gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint);
+void                     geometryIndexInit                      (GeometryIndex *,
+                                                                 GdkRectangle *,
+                                                                 guint);
+void                     geometryIndexFree                      (GeometryIndex *);
+gint64                   geometryIndexOverlap                   (GeometryIndex *,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint);
+gint                     geometryIndexNextX                     (GeometryIndex *,
+                                                                 gint);
+gint                     geometryIndexNextY                     (GeometryIndex *,
+                                                                 gint);
+gint64                   geometrySmartPlacement                 (GdkRectangle *,
+                                                                 guint,
+                                                                 gint /* xmin */,
+                                                                 gint /* ymin */,
+                                                                 gint /* xmax */,
+                                                                 gint /* ymax */,
+                                                                 gint /* frame_left */,
+                                                                 gint /* frame_top */,
+                                                                 gint /* frame_width */,
+                                                                 gint /* frame_height */,
+                                                                 gint *,
+                                                                 gint *);
+gint64                   geometrySmartPlacementScan             (GdkRectangle *,
+                                                                 guint,
+                                                                 gint /* xmin */,
+                                                                 gint /* ymin */,
+                                                                 gint /* xmax */,
+                                                                 gint /* ymax */,
+                                                                 gint /* frame_left */,
+                                                                 gint /* frame_top */,
+                                                                 gint /* frame_width */,
+                                                                 gint /* frame_height */,
+                                                                 gint *,
+                                                                 gint *);
+gint64                   geometrySmartPlacementIndexed          (GdkRectangle *,
+                                                                 guint,
+                                                                 gint /* xmin */,
+                                                                 gint /* ymin */,
+                                                                 gint /* xmax */,
+                                                                 gint /* ymax */,
+                                                                 gint /* frame_left */,
+                                                                 gint /* frame_top */,
+                                                                 gint /* frame_width */,
+                                                                 gint /* frame_height */,
+                                                                 gint *,
+                                                                 gint *);
+void                     geometryEdgeAdd                        (GArray *,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 guint);
+void                     geometryEdgesInit                      (GeometryEdges *);
+void                     geometryEdgesFree                      (GeometryEdges *);
+void                     geometryEdgesSort                      (GeometryEdges *);
+gboolean                 geometryEdgesClosest                   (GArray *,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint *,
+                                                                 guint *,
+                                                                 gint *);
+guint                    geometrySnapFrame                      (GeometryEdges *,
+                                                                 GdkRectangle * /* frame */,
+                                                                 GdkRectangle * /* monitor */,
+                                                                 gint /* snap_width */,
+                                                                 gboolean /* snap_to_border */,
+                                                                 gboolean /* snap_resist */,
+                                                                 gint /* dx */,
+                                                                 gint /* dy */);
+void                     geometryStrutsToRectangles             (const gint *,
+                                                                 gint,
+                                                                 gint,
+                                                                 GdkRectangle * /* left */,
+                                                                 GdkRectangle * /* right */,
+                                                                 GdkRectangle * /* top */,
+                                                                 GdkRectangle * /* bottom */);
+gboolean                 geometryStrutsValid                    (GdkRectangle * /* struts */,
+                                                                 GdkRectangle * /* monitor */,
+                                                                 gint);
+guint                    geometryConstrainFrame                 (GdkRectangle * /* frame */,
+                                                                 GdkRectangle * /* monitor */,
+                                                                 GeometryStruts *,
+                                                                 guint,
+                                                                 gpointer /* skip */,
+                                                                 gint /* frame_top */,
+                                                                 gint /* title_visible */,
+                                                                 gint /* min_visible */,
+                                                                 gboolean /* show_full */);
+void                     geometryGravityOffset                  (gint,
+                                                                 gint /* left */,
+                                                                 gint /* right */,
+                                                                 gint /* top */,
+                                                                 gint /* bottom */,
+                                                                 gint *,
+                                                                 gint *);
+gint                     geometryCheckSize                      (XSizeHints *,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gint,
+                                                                 gboolean,
+                                                                 gboolean);
+void                     geometryConstrainRatio                 (XSizeHints *,
+                                                                 gboolean,
+                                                                 gboolean,
+                                                                 gint *,
+                                                                 gint *);
+
+#endif /* INC_GEOMETRY_H */
@@ -0,0 +1,682 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * geometry-bench runs the computations of geometry.c on random layouts
+ * of hundreds of windows over two monitors, without any X server:
+ *
+ *   ./geometry-bench --windows=500 --iterations=100 --seed=42
+ *
+ * It reports the time per call of each entry point and checks the
+ * results, against a plain scan where there is one to compare with. The
+ * exit status is non zero if any check failed, "make check" runs it with
+ * the defaults.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <glib.h>
+
+#include "geometry.h"
+
+#define BENCH_SCREEN_WIDTH  3840
+#define BENCH_SCREEN_HEIGHT 1080
+#define BENCH_QUERIES       1000
+#define BENCH_SNAP_WIDTH    10
+#define BENCH_FRAME_LEFT    4
+#define BENCH_FRAME_RIGHT   4
+#define BENCH_FRAME_TOP     24
+#define BENCH_FRAME_BOTTOM  4
+#define BENCH_MIN_VISIBLE   24
+
+static gint n_windows = 0;
+static gint iterations = 100;
+static gint seed = 1;
+static guint failures = 0;
+
+static void
+check (gboolean condition, const gchar *format, ...)
+{
+    va_list args;
+
+    if (condition)
+    {
+        return;
+    }
+    if (failures++ < 20)
+    {
+        va_start (args, format);
+        g_printerr ("FAILED: ");
+        vfprintf (stderr, format, args);
+        g_printerr ("\n");
+        va_end (args);
+    }
+}
+
+static void
+report (const gchar *name, guint n, const gchar *what, guint calls, gint64 elapsed)
+{
+    if (*what)
+    {
+        g_print ("%-28s %5u %-7s", name, n, what);
+    }
+    else
+    {
+        g_print ("%-28s %13s", name, "");
+    }
+    g_print (" %12.3f usec/call\n", calls ? (gdouble) elapsed / calls : 0.0);
+}
+
+/* Both monitors side by side, windows anywhere on them and a bit beyond */
+static void
+bench_monitor (guint i, GdkRectangle *monitor)
+{
+    monitor->x = (i % 2) * (BENCH_SCREEN_WIDTH / 2);
+    monitor->y = 0;
+    monitor->width = BENCH_SCREEN_WIDTH / 2;
+    monitor->height = BENCH_SCREEN_HEIGHT;
+}
+
+static GdkRectangle *
+bench_layout (GRand *rand, guint n)
+{
+    GdkRectangle *rects;
+    guint i;
+
+    rects = g_new (GdkRectangle, n);
+    for (i = 0; i < n; i++)
+    {
+        rects[i].width = g_rand_int_range (rand, 100, 900);
+        rects[i].height = g_rand_int_range (rand, 80, 700);
+        rects[i].x = g_rand_int_range (rand, -50, BENCH_SCREEN_WIDTH - 50);
+        rects[i].y = g_rand_int_range (rand, -50, BENCH_SCREEN_HEIGHT - 50);
+    }
+    return rects;
+}
+
+static gint64
+brute_overlap (GdkRectangle *rects, guint n, gint x0, gint y0, gint x1, gint y1)
+{
+    gint64 overlap;
+    guint i;
+
+    overlap = 0;
+    for (i = 0; i < n; i++)
+    {
+        overlap += (gint64) geometrySegmentOverlap (x0, x1, rects[i].x, rects[i].x + rects[i].width)
+                 * geometrySegmentOverlap (y0, y1, rects[i].y, rects[i].y + rects[i].height);
+    }
+    return overlap;
+}
+
+static void
+bench_index (GRand *rand, GdkRectangle *rects, guint n)
+{
+    GeometryIndex index;
+    gint64 start, elapsed, overlap;
+    gint x, y, w, h;
+    gint i;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+    {
+        geometryIndexInit (&index, rects, n);
+        geometryIndexFree (&index);
+    }
+    report ("geometryIndexInit", n, "windows", iterations, g_get_monotonic_time () - start);
+
+    geometryIndexInit (&index, rects, n);
+    elapsed = 0;
+    for (i = 0; i < BENCH_QUERIES; i++)
+    {
+        x = g_rand_int_range (rand, -100, BENCH_SCREEN_WIDTH);
+        y = g_rand_int_range (rand, -100, BENCH_SCREEN_HEIGHT);
+        w = g_rand_int_range (rand, 1, 1000);
+        h = g_rand_int_range (rand, 1, 800);
+
+        start = g_get_monotonic_time ();
+        overlap = geometryIndexOverlap (&index, x, y, x + w, y + h);
+        elapsed += g_get_monotonic_time () - start;
+
+        check (overlap == brute_overlap (rects, n, x, y, x + w, y + h),
+               "geometryIndexOverlap at %d,%d %dx%d", x, y, w, h);
+    }
+    report ("geometryIndexOverlap", n, "windows", BENCH_QUERIES, elapsed);
+    geometryIndexFree (&index);
+}
+
+static void
+bench_placement (GdkRectangle *rects, guint n)
+{
+    GdkRectangle monitor;
+    gint64 start, elapsed, overlap;
+    gint xmin, ymin, xmax, ymax, width, height;
+    gint x, y;
+    gint i;
+
+    elapsed = 0;
+    for (i = 0; i < iterations; i++)
+    {
+        bench_monitor (i, &monitor);
+        width = 200 + 10 * (i % 60);
+        height = 150 + 5 * (i % 80);
+        xmin = monitor.x + BENCH_FRAME_LEFT;
+        ymin = monitor.y + BENCH_FRAME_TOP;
+        xmax = monitor.x + monitor.width - width - BENCH_FRAME_RIGHT;
+        ymax = monitor.y + monitor.height - height - BENCH_FRAME_BOTTOM;
+
+        start = g_get_monotonic_time ();
+        overlap = geometrySmartPlacement (rects, n, xmin, ymin, xmax, ymax,
+                                          BENCH_FRAME_LEFT, BENCH_FRAME_TOP,
+                                          width + BENCH_FRAME_LEFT + BENCH_FRAME_RIGHT,
+                                          height + BENCH_FRAME_TOP + BENCH_FRAME_BOTTOM,
+                                          &x, &y);
+        elapsed += g_get_monotonic_time () - start;
+
+        check ((x >= xmin) && (x <= xmax) && (y >= ymin) && (y <= ymax),
+               "geometrySmartPlacement at %d,%d out of %d,%d %d,%d", x, y, xmin, ymin, xmax, ymax);
+        check (overlap == brute_overlap (rects, n, x - BENCH_FRAME_LEFT, y - BENCH_FRAME_TOP,
+                                         x + width + BENCH_FRAME_RIGHT, y + height + BENCH_FRAME_BOTTOM),
+               "geometrySmartPlacement overlap at %d,%d", x, y);
+    }
+    report ("geometrySmartPlacement", n, "windows", iterations, elapsed);
+}
+
+static void
+edges_init (GeometryEdges *edges, GdkRectangle *rects, guint n)
+{
+    guint i;
+
+    geometryEdgesInit (edges);
+    for (i = 0; i < n; i++)
+    {
+        geometryEdgeAdd (edges->right, rects[i].x + rects[i].width,
+                         rects[i].y, rects[i].y + rects[i].height, 2 * i + 1);
+        geometryEdgeAdd (edges->left, rects[i].x,
+                         rects[i].y, rects[i].y + rects[i].height, 2 * i + 2);
+        geometryEdgeAdd (edges->bottom, rects[i].y + rects[i].height,
+                         rects[i].x, rects[i].x + rects[i].width, 2 * i + 1);
+        geometryEdgeAdd (edges->top, rects[i].y,
+                         rects[i].x, rects[i].x + rects[i].width, 2 * i + 2);
+    }
+    geometryEdgesSort (edges);
+}
+
+static gint
+brute_closest (GArray *edges, gint pos, gint start, gint end)
+{
+    GeometryEdge *edge;
+    gint best_delta, best_pos, delta;
+    guint best_seq, i;
+
+    best_delta = BENCH_SNAP_WIDTH + 1;
+    best_seq = G_MAXUINT;
+    best_pos = pos;
+    for (i = 0; i < edges->len; i++)
+    {
+        edge = &g_array_index (edges, GeometryEdge, i);
+        if ((edge->start > end) || (edge->end < start))
+        {
+            continue;
+        }
+        delta = abs (edge->pos - pos);
+        if ((delta < best_delta) || ((delta == best_delta) && (edge->seq < best_seq)))
+        {
+            best_delta = delta;
+            best_seq = edge->seq;
+            best_pos = edge->pos;
+        }
+    }
+    return best_pos;
+}
+
+static void
+bench_edges (GRand *rand, GdkRectangle *rects, guint n)
+{
+    GeometryEdges edges;
+    GdkRectangle frame, moved, monitor;
+    gint64 start, elapsed;
+    gint pos, other, closest, delta;
+    guint seq, snapped;
+    gint i;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+    {
+        edges_init (&edges, rects, n);
+        geometryEdgesFree (&edges);
+    }
+    report ("geometryEdgesSort", n, "windows", iterations, g_get_monotonic_time () - start);
+
+    edges_init (&edges, rects, n);
+    elapsed = 0;
+    for (i = 0; i < BENCH_QUERIES; i++)
+    {
+        pos = g_rand_int_range (rand, 0, BENCH_SCREEN_WIDTH);
+        other = g_rand_int_range (rand, 0, BENCH_SCREEN_HEIGHT);
+        delta = BENCH_SNAP_WIDTH + 1;
+        seq = G_MAXUINT;
+        closest = pos;
+
+        start = g_get_monotonic_time ();
+        geometryEdgesClosest (edges.left, pos, G_MININT, G_MAXINT, other, other + 300,
+                              &delta, &seq, &closest);
+        elapsed += g_get_monotonic_time () - start;
+
+        check (closest == brute_closest (edges.left, pos, other, other + 300),
+               "geometryEdgesClosest from %d", pos);
+    }
+    report ("geometryEdgesClosest", n, "windows", BENCH_QUERIES, elapsed);
+
+    elapsed = 0;
+    for (i = 0; i < BENCH_QUERIES; i++)
+    {
+        bench_monitor (i, &monitor);
+        frame.width = g_rand_int_range (rand, 100, 900);
+        frame.height = g_rand_int_range (rand, 80, 700);
+        frame.x = g_rand_int_range (rand, monitor.x, monitor.x + monitor.width - frame.width);
+        frame.y = g_rand_int_range (rand, monitor.y, monitor.y + monitor.height - frame.height);
+        moved = frame;
+
+        start = g_get_monotonic_time ();
+        snapped = geometrySnapFrame (&edges, &moved, &monitor, BENCH_SNAP_WIDTH, TRUE, (i % 2),
+                                     g_rand_int_range (rand, -5, 6), g_rand_int_range (rand, -5, 6));
+        elapsed += g_get_monotonic_time () - start;
+
+        check ((snapped & GEOMETRY_SNAPPED_X) ? (abs (moved.x - frame.x) <= BENCH_SNAP_WIDTH)
+                                              : (moved.x == frame.x),
+               "geometrySnapFrame moved x from %d to %d", frame.x, moved.x);
+        check ((snapped & GEOMETRY_SNAPPED_Y) ? (abs (moved.y - frame.y) <= BENCH_SNAP_WIDTH)
+                                              : (moved.y == frame.y),
+               "geometrySnapFrame moved y from %d to %d", frame.y, moved.y);
+    }
+    report ("geometrySnapFrame", n, "windows", BENCH_QUERIES, elapsed);
+    geometryEdgesFree (&edges);
+}
+
+/* A panel along one side of a random monitor, for one window in ten */
+static void
+bench_random_struts (GRand *rand, gint *struts)
+{
+    GdkRectangle monitor;
+    gint side, size;
+
+    memset (struts, 0, 12 * sizeof (gint));
+    bench_monitor (g_rand_int_range (rand, 0, 2), &monitor);
+    side = g_rand_int_range (rand, STRUTS_LEFT, STRUTS_BOTTOM + 1);
+    size = g_rand_int_range (rand, 16, 64);
+    switch (side)
+    {
+        case STRUTS_LEFT:
+            struts[STRUTS_LEFT] = size;
+            struts[STRUTS_LEFT_START_Y] = monitor.y;
+            struts[STRUTS_LEFT_END_Y] = monitor.y + monitor.height;
+            break;
+        case STRUTS_RIGHT:
+            struts[STRUTS_RIGHT] = size;
+            struts[STRUTS_RIGHT_START_Y] = monitor.y;
+            struts[STRUTS_RIGHT_END_Y] = monitor.y + monitor.height;
+            break;
+        case STRUTS_TOP:
+            struts[STRUTS_TOP] = size;
+            struts[STRUTS_TOP_START_X] = monitor.x;
+            struts[STRUTS_TOP_END_X] = monitor.x + monitor.width;
+            break;
+        default:
+            struts[STRUTS_BOTTOM] = size;
+            struts[STRUTS_BOTTOM_START_X] = monitor.x;
+            struts[STRUTS_BOTTOM_END_X] = monitor.x + monitor.width;
+            break;
+    }
+}
+
+static void
+bench_struts (GRand *rand, GdkRectangle *rects, guint n)
+{
+    GeometryStruts *all_struts, *s;
+    GdkRectangle frame, monitor;
+    gint64 start, elapsed;
+    gint struts[12];
+    guint i, n_struts;
+
+    n_struts = MAX (n / 10, 1);
+    all_struts = g_new (GeometryStruts, n_struts);
+    elapsed = 0;
+    for (i = 0; i < n_struts; i++)
+    {
+        s = &all_struts[i];
+        s->data = GUINT_TO_POINTER (i + 1);
+        bench_random_struts (rand, struts);
+
+        start = g_get_monotonic_time ();
+        geometryStrutsToRectangles (struts, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT,
+                                    &s->left, &s->right, &s->top, &s->bottom);
+        elapsed += g_get_monotonic_time () - start;
+
+        check ((s->left.x == 0) && (s->left.width == struts[STRUTS_LEFT])
+               && (s->right.x + s->right.width == BENCH_SCREEN_WIDTH)
+               && (s->right.width == struts[STRUTS_RIGHT])
+               && (s->top.y == 0) && (s->top.height == struts[STRUTS_TOP])
+               && (s->bottom.y + s->bottom.height == BENCH_SCREEN_HEIGHT)
+               && (s->bottom.height == struts[STRUTS_BOTTOM]),
+               "geometryStrutsToRectangles");
+    }
+    report ("geometryStrutsToRectangles", n_struts, "struts", n_struts, elapsed);
+
+    elapsed = 0;
+    for (i = 0; i < n; i++)
+    {
+        bench_monitor (i, &monitor);
+        frame = rects[i];
+
+        start = g_get_monotonic_time ();
+        geometryConstrainFrame (&frame, &monitor, NULL, 0, NULL, BENCH_FRAME_TOP,
+                                BENCH_FRAME_TOP, BENCH_MIN_VISIBLE, TRUE);
+        elapsed += g_get_monotonic_time () - start;
+
+        check ((frame.x >= monitor.x) && (frame.y >= monitor.y)
+               && (frame.x + frame.width <= monitor.x + monitor.width)
+               && (frame.y + frame.height <= monitor.y + monitor.height),
+               "geometryConstrainFrame left %d,%d %dx%d off the monitor",
+               frame.x, frame.y, frame.width, frame.height);
+    }
+    report ("geometryConstrainFrame", 0, "struts", n, elapsed);
+
+    elapsed = 0;
+    for (i = 0; i < n; i++)
+    {
+        bench_monitor (i, &monitor);
+        frame = rects[i];
+
+        start = g_get_monotonic_time ();
+        geometryConstrainFrame (&frame, &monitor, all_struts, n_struts, NULL, BENCH_FRAME_TOP,
+                                BENCH_FRAME_TOP, BENCH_MIN_VISIBLE, FALSE);
+        elapsed += g_get_monotonic_time () - start;
+
+        check ((frame.x + frame.width >= monitor.x + BENCH_MIN_VISIBLE)
+               && (frame.x + BENCH_MIN_VISIBLE <= monitor.x + monitor.width)
+               && (frame.y + frame.height >= monitor.y + BENCH_MIN_VISIBLE)
+               && (frame.y + BENCH_MIN_VISIBLE <= monitor.y + monitor.height),
+               "geometryConstrainFrame left %d,%d %dx%d out of reach",
+               frame.x, frame.y, frame.width, frame.height);
+    }
+    report ("geometryConstrainFrame", n_struts, "struts", n, elapsed);
+
+    g_free (all_struts);
+}
+
+static void
+bench_gravity (void)
+{
+    static const struct
+    {
+        gint gravity;
+        gint dx, dy;
+    } expected[] =
+    {
+        { NorthWestGravity, 4, 24 },
+        { NorthGravity, 0, 24 },
+        { NorthEastGravity, -6, 24 },
+        { WestGravity, 4, 11 },
+        { CenterGravity, 0, 11 },
+        { EastGravity, -6, 11 },
+        { SouthWestGravity, 4, -2 },
+        { SouthGravity, 0, -2 },
+        { SouthEastGravity, -6, -2 },
+        { StaticGravity, 0, 0 },
+    };
+    gint64 start;
+    gint dx, dy;
+    guint i, calls;
+
+    calls = 0;
+    start = g_get_monotonic_time ();
+    for (i = 0; i < BENCH_QUERIES * G_N_ELEMENTS (expected); i++)
+    {
+        geometryGravityOffset (expected[i % G_N_ELEMENTS (expected)].gravity, 4, 6, 24, 2, &dx, &dy);
+        calls++;
+    }
+    report ("geometryGravityOffset", 0, "", calls, g_get_monotonic_time () - start);
+
+    for (i = 0; i < G_N_ELEMENTS (expected); i++)
+    {
+        geometryGravityOffset (expected[i].gravity, 4, 6, 24, 2, &dx, &dy);
+        check ((dx == expected[i].dx) && (dy == expected[i].dy),
+               "geometryGravityOffset for gravity %d gave %d,%d", expected[i].gravity, dx, dy);
+    }
+}
+
+static void
+bench_size_hints (GRand *rand)
+{
+    XSizeHints hints;
+    gint64 start, elapsed;
+    gint size, base, min, max, incr, result;
+    gint width, height;
+    gboolean constrained;
+    gint i;
+
+    elapsed = 0;
+    for (i = 0; i < BENCH_QUERIES; i++)
+    {
+        hints.flags = g_rand_int_range (rand, 0, 2) ? PMinSize : 0;
+        hints.flags |= g_rand_int_range (rand, 0, 2) ? PMaxSize : 0;
+        hints.flags |= g_rand_int_range (rand, 0, 2) ? PResizeInc : 0;
+        hints.flags |= g_rand_int_range (rand, 0, 2) ? PBaseSize : 0;
+        base = g_rand_int_range (rand, 0, 50);
+        min = g_rand_int_range (rand, 1, 200);
+        max = min + g_rand_int_range (rand, 0, 1000);
+        incr = g_rand_int_range (rand, 1, 20);
+        size = g_rand_int_range (rand, -10, 1500);
+        constrained = g_rand_int_range (rand, 0, 4) != 0;
+
+        start = g_get_monotonic_time ();
+        result = geometryCheckSize (&hints, size, base, min, max, incr, constrained, TRUE);
+        elapsed += g_get_monotonic_time () - start;
+
+        check (result >= 1, "geometryCheckSize gave %d", result);
+        check (!(hints.flags & PMinSize) || (result >= min),
+               "geometryCheckSize gave %d below %d", result, min);
+        check (!constrained || !(hints.flags & PMaxSize) || (result <= max),
+               "geometryCheckSize gave %d above %d", result, max);
+        if (constrained && ((hints.flags & (PMinSize | PMaxSize | PResizeInc)) == PResizeInc)
+            && (size >= base + incr))
+        {
+            check (((result - ((hints.flags & PBaseSize) ? base : 0)) % incr) == 0,
+                   "geometryCheckSize gave %d off the %d increments", result, incr);
+        }
+    }
+    report ("geometryCheckSize", 0, "", BENCH_QUERIES, elapsed);
+
+    elapsed = 0;
+    for (i = 0; i < BENCH_QUERIES; i++)
+    {
+        hints.flags = PAspect;
+        hints.width_inc = 1;
+        hints.height_inc = 1;
+        hints.min_aspect.x = hints.max_aspect.x = 16;
+        hints.min_aspect.y = hints.max_aspect.y = 9;
+        width = g_rand_int_range (rand, 100, 2000);
+        height = g_rand_int_range (rand, 100, 2000);
+
+        start = g_get_monotonic_time ();
+        geometryConstrainRatio (&hints, (i % 2), !(i % 2), &width, &height);
+        elapsed += g_get_monotonic_time () - start;
+
+        check (abs (width * 9 - height * 16) < 16,
+               "geometryConstrainRatio gave %dx%d", width, height);
+    }
+    report ("geometryConstrainRatio", 0, "", BENCH_QUERIES, elapsed);
+}
+
+/*
+ * Place a window on a monitor already holding n others, as crowded as
+ * the layouts above, with the index and with the scan. Both are timed on
+ * the same layouts and must find positions with the overlap they report,
+ * the index at least as good as the scan since it tries more candidates.
+ * The crossover is where GEOMETRY_INDEX_MIN comes from.
+ */
+static void
+bench_placement_scaling (GRand *rand)
+{
+    static const guint counts[] = { 8, 16, 32, 64, 96, 128, 160, 192, 224, 256, 320, 384, 512 };
+    GdkRectangle monitor, *rects;
+    gint64 start, index_time, scan_time, index_overlap, scan_overlap;
+    gint xmin, ymin, xmax, ymax, width, height;
+    gint x, y;
+    guint n, calls, k;
+    gint i;
+
+    bench_monitor (0, &monitor);
+    width = 600;
+    height = 400;
+    xmin = monitor.x + BENCH_FRAME_LEFT;
+    ymin = monitor.y + BENCH_FRAME_TOP;
+    xmax = monitor.x + monitor.width - width - BENCH_FRAME_RIGHT;
+    ymax = monitor.y + monitor.height - height - BENCH_FRAME_BOTTOM;
+    calls = MAX (iterations / 10, 1);
+
+    g_print ("%-28s %13s %12s %12s\n", "smart placement", "", "index", "scan");
+    for (k = 0; k < G_N_ELEMENTS (counts); k++)
+    {
+        n = counts[k];
+        rects = g_new (GdkRectangle, n);
+        for (i = 0; i < (gint) n; i++)
+        {
+            rects[i].width = g_rand_int_range (rand, 100, 900);
+            rects[i].height = g_rand_int_range (rand, 80, 700);
+            rects[i].x = g_rand_int_range (rand, monitor.x - 50, monitor.x + monitor.width - 50);
+            rects[i].y = g_rand_int_range (rand, monitor.y - 50, monitor.y + monitor.height - 50);
+        }
+
+        start = g_get_monotonic_time ();
+        for (i = 0; i < (gint) calls; i++)
+        {
+            index_overlap = geometrySmartPlacementIndexed (rects, n, xmin, ymin, xmax, ymax,
+                                                           BENCH_FRAME_LEFT, BENCH_FRAME_TOP,
+                                                           width + BENCH_FRAME_LEFT + BENCH_FRAME_RIGHT,
+                                                           height + BENCH_FRAME_TOP + BENCH_FRAME_BOTTOM,
+                                                           &x, &y);
+        }
+        index_time = g_get_monotonic_time () - start;
+        check (index_overlap == brute_overlap (rects, n, x - BENCH_FRAME_LEFT, y - BENCH_FRAME_TOP,
+                                               x + width + BENCH_FRAME_RIGHT, y + height + BENCH_FRAME_BOTTOM),
+               "geometrySmartPlacementIndexed overlap at %d,%d", x, y);
+
+        start = g_get_monotonic_time ();
+        for (i = 0; i < (gint) calls; i++)
+        {
+            scan_overlap = geometrySmartPlacementScan (rects, n, xmin, ymin, xmax, ymax,
+                                                       BENCH_FRAME_LEFT, BENCH_FRAME_TOP,
+                                                       width + BENCH_FRAME_LEFT + BENCH_FRAME_RIGHT,
+                                                       height + BENCH_FRAME_TOP + BENCH_FRAME_BOTTOM,
+                                                       &x, &y);
+        }
+        scan_time = g_get_monotonic_time () - start;
+        check (scan_overlap == brute_overlap (rects, n, x - BENCH_FRAME_LEFT, y - BENCH_FRAME_TOP,
+                                              x + width + BENCH_FRAME_RIGHT, y + height + BENCH_FRAME_BOTTOM),
+               "geometrySmartPlacementScan overlap at %d,%d", x, y);
+        check (index_overlap <= scan_overlap,
+               "geometrySmartPlacementIndexed overlap %" G_GINT64_FORMAT " above the scan %" G_GINT64_FORMAT,
+               index_overlap, scan_overlap);
+
+        g_print ("%-28s %5u %-7s %12.3f %12.3f usec/call\n", "", n, "windows",
+                 (gdouble) index_time / calls, (gdouble) scan_time / calls);
+        g_free (rects);
+    }
+}
+
+static void
+bench_windows (GRand *rand, guint n)
+{
+    GdkRectangle *rects;
+
+    rects = bench_layout (rand, n);
+    bench_index (rand, rects, n);
+    bench_placement (rects, n);
+    bench_edges (rand, rects, n);
+    bench_struts (rand, rects, n);
+    g_free (rects);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    GRand *rand;
+    GOptionEntry option_entries[] =
+    {
+        { "windows", 'w', 0, G_OPTION_ARG_INT, &n_windows, "Number of windows (default 100, 200 and 500)", "N" },
+        { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Iterations of the costly calls (default 100)", "N" },
+        { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "Seed of the random layouts (default 1)", "SEED" },
+        { NULL }
+    };
+
+    context = g_option_context_new (NULL);
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    if ((argc != 1) || (n_windows < 0) || (iterations <= 0))
+    {
+        g_printerr ("Usage: %s [--windows=N] [--iterations=N] [--seed=SEED]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    rand = g_rand_new_with_seed (seed);
+    if (n_windows)
+    {
+        bench_windows (rand, n_windows);
+    }
+    else
+    {
+        bench_windows (rand, 100);
+        bench_windows (rand, 200);
+        bench_windows (rand, 500);
+        bench_placement_scaling (rand);
+    }
+    bench_gravity ();
+    bench_size_hints (rand);
+    g_rand_free (rand);
+
+    if (failures)
+    {
+        g_printerr ("%u checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -44,6 +44,10 @@
 #include "display.h"
 #include "screen.h"
 #include "hints.h"
+#include "prefetch.h"
+
+/* How long to extrapolate from the last event before asking for a new one */
+#define XSERVER_TIME_REFRESH (G_USEC_PER_SEC)
 
 static gboolean
 check_type_and_format (int expected_format, Atom expected_type, int n_items, int format, Atom type)
@@ -55,6 +59,23 @@ check_type_and_format (int expected_format, Atom expected_type, int n_items, int
     return FALSE;
 }
 
+static int
+get_window_property (DisplayInfo *display_info, Window w, Atom property,
+                     long offset, long length, Bool delete, Atom req_type,
+                     Atom *actual_type, int *actual_format, unsigned long *nitems,
+                     unsigned long *bytes_after, unsigned char **data)
+{
+    /* Use the properties read ahead while framing when possible */
+    if ((!delete) && prefetchGetProperty (display_info, w, property, offset, length, req_type,
+                                          actual_type, actual_format, nitems, bytes_after, data))
+    {
+        return Success;
+    }
+
+    return XGetWindowProperty (display_info->dpy, w, property, offset, length, delete, req_type,
+                               actual_type, actual_format, nitems, bytes_after, data);
+}
+
 static gchar *
 internal_utf8_strndup (const gchar *src, gssize max_len)
 {
@@ -88,10 +109,10 @@ getWMState (DisplayInfo *display_info, Window w)
 
     data = NULL;
     state = WithdrawnState;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[WM_STATE],
-                             0, 3L, FALSE, display_info->atoms[WM_STATE],
-                             &real_type, &real_format, &items_read, &items_left,
-                             (unsigned char **) &data) == Success) && (items_read))
+    if ((get_window_property (display_info, w, display_info->atoms[WM_STATE],
+                              0, 3L, FALSE, display_info->atoms[WM_STATE],
+                              &real_type, &real_format, &items_read, &items_left,
+                              (unsigned char **) &data) == Success) && (items_read))
     {
         state = *data;
         if (data)
@@ -112,6 +133,7 @@ setWMState (DisplayInfo *display_info, Window w, unsigned long state)
     data[0] = state;
     data[1] = None;
 
+    prefetchForget (display_info, w, display_info->atoms[WM_STATE]);
     XChangeProperty (display_info->dpy, w, display_info->atoms[WM_STATE],
                      display_info->atoms[WM_STATE], 32, PropModeReplace,
                      (unsigned char *) data, 2);
@@ -130,7 +152,7 @@ getMotifHints (DisplayInfo *display_info, Window w)
 
     data = NULL;
     result = NULL;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[MOTIF_WM_HINTS], 0L, MWM_HINTS_ELEMENTS,
+    if ((get_window_property (display_info, w, display_info->atoms[MOTIF_WM_HINTS], 0L, MWM_HINTS_ELEMENTS,
                 FALSE, display_info->atoms[MOTIF_WM_HINTS], &real_type, &real_format, &items_read,
                 &items_left, (unsigned char **) &data) == Success))
     {
@@ -161,8 +183,13 @@ getWMProtocols (DisplayInfo *display_info, Window w)
     TRACE ("entering getWMProtocols");
 
     result = 0;
-    if (XGetWMProtocols (display_info->dpy, w, &protocols, &n))
+    protocols = NULL;
+    if ((get_window_property (display_info, w, display_info->atoms[WM_PROTOCOLS],
+                              0L, 1000000L, FALSE, XA_ATOM, &atype, &aformat, &nitems,
+                              &bytes_remain, (unsigned char **) &protocols) == Success)
+        && (atype == XA_ATOM) && (aformat == 32))
     {
+        n = (gint) nitems;
         for (i = 0, ap = protocols; i < n; i++, ap++)
         {
             if (*ap == display_info->atoms[WM_TAKE_FOCUS])
@@ -191,7 +218,11 @@ getWMProtocols (DisplayInfo *display_info, Window w)
     }
     else
     {
-        if ((XGetWindowProperty (display_info->dpy, w,
+        if (protocols)
+        {
+            XFree (protocols);
+        }
+        if ((get_window_property (display_info, w,
                     display_info->atoms[WM_PROTOCOLS], 0L, 10L, FALSE,
                     display_info->atoms[WM_PROTOCOLS], &atype,
                     &aformat, &nitems, &bytes_remain,
@@ -238,9 +269,9 @@ getHint (DisplayInfo *display_info, Window w, int atom_id, long *value)
     *value = 0;
     data = NULL;
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id], 0L, 1L,
-                             FALSE, XA_CARDINAL, &real_type, &real_format, &items_read, &items_left,
-                             (unsigned char **) &data) == Success) && (items_read))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id], 0L, 1L,
+                              FALSE, XA_CARDINAL, &real_type, &real_format, &items_read, &items_left,
+                              (unsigned char **) &data) == Success) && (items_read))
     {
         *value = *((long *) data) & ((1LL << real_format) - 1);
         if (data)
@@ -258,6 +289,7 @@ setHint (DisplayInfo *display_info, Window w, int atom_id, long value)
     g_return_if_fail ((atom_id >= 0) && (atom_id < ATOM_COUNT));
     TRACE ("entering setHint");
 
+    prefetchForget (display_info, w, display_info->atoms[atom_id]);
     XChangeProperty (display_info->dpy, w, display_info->atoms[atom_id], XA_CARDINAL,
                      32, PropModeReplace, (unsigned char *) &value, 1);
 }
@@ -279,7 +311,7 @@ getDesktopLayout (DisplayInfo *display_info, Window root, int ws_count, NetWmDes
     data = NULL;
     success = FALSE;
 
-    if ((XGetWindowProperty (display_info->dpy, root, display_info->atoms[NET_DESKTOP_LAYOUT],
+    if ((get_window_property (display_info, root, display_info->atoms[NET_DESKTOP_LAYOUT],
                 0L, 4L, FALSE, XA_CARDINAL,
                 &real_type, &real_format, &items_read, &items_left,
                 (unsigned char **) &data) == Success) && (items_read >= 3))
@@ -377,6 +409,8 @@ setNetSupportedHint (DisplayInfo *display_info, Window root, Window check_win)
     atoms[i++] = display_info->atoms[NET_WM_ALLOWED_ACTIONS];
     atoms[i++] = display_info->atoms[NET_WM_CONTEXT_HELP];
     atoms[i++] = display_info->atoms[NET_WM_DESKTOP];
+    atoms[i++] = display_info->atoms[NET_WM_FRAME_DRAWN];
+    atoms[i++] = display_info->atoms[NET_WM_FRAME_TIMINGS];
     atoms[i++] = display_info->atoms[NET_WM_FULLSCREEN_MONITORS];
     atoms[i++] = display_info->atoms[NET_WM_ICON];
     atoms[i++] = display_info->atoms[NET_WM_ICON_GEOMETRY];
@@ -453,9 +487,9 @@ getAtomList (DisplayInfo *display_info, Window w, int atom_id, Atom ** atoms_p,
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
     TRACE ("entering getAtomList()");
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, XA_ATOM, &type, &format, &n_atoms,
-                             &bytes_after, (unsigned char **) &data) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, FALSE, XA_ATOM, &type, &format, &n_atoms,
+                              &bytes_after, (unsigned char **) &data) != Success) || (type == None))
     {
         return FALSE;
     }
@@ -494,10 +528,10 @@ getCardinalList (DisplayInfo *display_info, Window w, int atom_id, unsigned long
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
     TRACE ("entering getCardinalList()");
 
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, XA_CARDINAL,
-                             &type, &format, &n_cardinals, &bytes_after,
-                             (unsigned char **) &data) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, FALSE, XA_CARDINAL,
+                              &type, &format, &n_cardinals, &bytes_after,
+                              (unsigned char **) &data) != Success) || (type == None))
     {
         return FALSE;
     }
@@ -550,6 +584,8 @@ setNetFrameExtents (DisplayInfo *display_info, Window w, int top, int left, int
     data[1] = (unsigned long) right;
     data[2] = (unsigned long) top;
     data[3] = (unsigned long) bottom;
+
+    prefetchForget (display_info, w, display_info->atoms[NET_FRAME_EXTENTS]);
     XChangeProperty (display_info->dpy, w, display_info->atoms[NET_FRAME_EXTENTS],
                      XA_CARDINAL, 32, PropModeReplace, (unsigned char *) data, 4);
 }
@@ -564,6 +600,8 @@ setNetFullscreenMonitors (DisplayInfo *display_info, Window w, gint top, gint bo
     data[1] = (unsigned long) bottom;
     data[2] = (unsigned long) left;
     data[3] = (unsigned long) right;
+
+    prefetchForget (display_info, w, display_info->atoms[NET_WM_FULLSCREEN_MONITORS]);
     XChangeProperty (display_info->dpy, w, display_info->atoms[NET_WM_FULLSCREEN_MONITORS],
                      XA_CARDINAL, 32, PropModeReplace, (unsigned char *) data, 4);
 }
@@ -611,6 +649,7 @@ setUTF8StringHint (DisplayInfo *display_info, Window w, int atom_id, const gchar
     g_return_if_fail ((atom_id >= 0) && (atom_id < ATOM_COUNT));
     TRACE ("entering setUTF8StringHint");
 
+    prefetchForget (display_info, w, display_info->atoms[atom_id]);
     XChangeProperty (display_info->dpy, w, display_info->atoms[atom_id],
                      display_info->atoms[UTF8_STRING], 8, PropModeReplace,
                      (unsigned char *) val, strlen (val));
@@ -619,10 +658,22 @@ setUTF8StringHint (DisplayInfo *display_info, Window w, int atom_id, const gchar
 void
 getTransientFor (DisplayInfo *display_info, Window root, Window w, Window * transient_for)
 {
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
     TRACE ("entering getTransientFor");
 
-    if (XGetTransientForHint (display_info->dpy, w, transient_for))
+    data = NULL;
+    if ((get_window_property (display_info, w, XA_WM_TRANSIENT_FOR,
+                              0L, 1L, FALSE, XA_WINDOW, &actual_type, &actual_format, &nitems,
+                              &bytes_after, (unsigned char **) &data) == Success)
+        && (actual_type == XA_WINDOW) && (actual_format == 32) && (nitems > 0))
     {
+        *transient_for = *((Window *) data);
+        XFree (data);
         if (*transient_for == None)
         {
             /* Treat transient for "none" same as transient for root */
@@ -636,12 +687,228 @@ getTransientFor (DisplayInfo *display_info, Window root, Window w, Window * tran
     }
     else
     {
+        if (data)
+        {
+            XFree (data);
+        }
         *transient_for = None;
     }
 
     TRACE ("Window (0x%lx) is transient for (0x%lx)", w, *transient_for);
 }
 
+XWMHints *
+getWMHints (DisplayInfo *display_info, Window w)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+    XWMHints *hints;
+    long *prop;
+
+    TRACE ("entering getWMHints");
+
+    data = NULL;
+    hints = NULL;
+    /* Like XGetWMHints (), accept old clients without the window group */
+    if ((get_window_property (display_info, w, XA_WM_HINTS,
+                              0L, 9L, FALSE, XA_WM_HINTS, &actual_type, &actual_format, &nitems,
+                              &bytes_after, (unsigned char **) &data) == Success)
+        && (actual_type == XA_WM_HINTS) && (actual_format == 32) && (nitems >= 8))
+    {
+        prop = (long *) data;
+        hints = XAllocWMHints ();
+        if (hints)
+        {
+            hints->flags = prop[0];
+            hints->input = (prop[1] ? True : False);
+            hints->initial_state = (int) prop[2];
+            hints->icon_pixmap = (Pixmap) prop[3];
+            hints->icon_window = (Window) prop[4];
+            hints->icon_x = (int) prop[5];
+            hints->icon_y = (int) prop[6];
+            hints->icon_mask = (Pixmap) prop[7];
+            hints->window_group = (nitems >= 9) ? (XID) prop[8] : None;
+        }
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return hints;
+}
+
+gboolean
+getWMNormalHints (DisplayInfo *display_info, Window w, XSizeHints *hints)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+    long supplied;
+    long *prop;
+    gboolean success;
+
+    TRACE ("entering getWMNormalHints");
+
+    g_return_val_if_fail (hints != NULL, FALSE);
+
+    data = NULL;
+    success = FALSE;
+    /* Pre-ICCCM clients set 15 elements, without base size and gravity */
+    if ((get_window_property (display_info, w, XA_WM_NORMAL_HINTS,
+                              0L, 18L, FALSE, XA_WM_SIZE_HINTS, &actual_type, &actual_format, &nitems,
+                              &bytes_after, (unsigned char **) &data) == Success)
+        && (actual_type == XA_WM_SIZE_HINTS) && (actual_format == 32) && (nitems >= 15))
+    {
+        prop = (long *) data;
+        hints->flags = prop[0];
+        hints->x = (int) prop[1];
+        hints->y = (int) prop[2];
+        hints->width = (int) prop[3];
+        hints->height = (int) prop[4];
+        hints->min_width = (int) prop[5];
+        hints->min_height = (int) prop[6];
+        hints->max_width = (int) prop[7];
+        hints->max_height = (int) prop[8];
+        hints->width_inc = (int) prop[9];
+        hints->height_inc = (int) prop[10];
+        hints->min_aspect.x = (int) prop[11];
+        hints->min_aspect.y = (int) prop[12];
+        hints->max_aspect.x = (int) prop[13];
+        hints->max_aspect.y = (int) prop[14];
+
+        supplied = (USPosition | USSize | PAllHints);
+        if (nitems >= 18)
+        {
+            hints->base_width = (int) prop[15];
+            hints->base_height = (int) prop[16];
+            hints->win_gravity = (int) prop[17];
+            supplied |= (PBaseSize | PWinGravity);
+        }
+        hints->flags &= supplied;
+        success = TRUE;
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return success;
+}
+
+gboolean
+getClassHint (DisplayInfo *display_info, Window w, XClassHint *class_hint)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+    size_t len;
+
+    TRACE ("entering getClassHint");
+
+    g_return_val_if_fail (class_hint != NULL, FALSE);
+
+    data = NULL;
+    if ((get_window_property (display_info, w, XA_WM_CLASS,
+                              0L, G_MAXLONG, FALSE, XA_STRING, &actual_type, &actual_format, &nitems,
+                              &bytes_after, (unsigned char **) &data) == Success)
+        && (actual_type == XA_STRING) && (actual_format == 8))
+    {
+        /* Two consecutive NUL terminated strings, the class may be missing */
+        len = strlen ((char *) data);
+        class_hint->res_name = malloc (len + 1);
+        strcpy (class_hint->res_name, (char *) data);
+        if (len + 1 < nitems)
+        {
+            class_hint->res_class = malloc (strlen ((char *) data + len + 1) + 1);
+            strcpy (class_hint->res_class, (char *) data + len + 1);
+        }
+        else
+        {
+            class_hint->res_class = malloc (1);
+            class_hint->res_class[0] = '\0';
+        }
+        XFree (data);
+        return TRUE;
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return FALSE;
+}
+
+gboolean
+getWMColormapWindows (DisplayInfo *display_info, Window w, Window **windows, int *count)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
+    TRACE ("entering getWMColormapWindows");
+
+    data = NULL;
+    if ((get_window_property (display_info, w, display_info->atoms[WM_COLORMAP_WINDOWS],
+                              0L, 1000000L, FALSE, XA_WINDOW, &actual_type, &actual_format, &nitems,
+                              &bytes_after, (unsigned char **) &data) == Success)
+        && (actual_type == XA_WINDOW) && (actual_format == 32))
+    {
+        *windows = (Window *) data;
+        *count = (int) nitems;
+        return TRUE;
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return FALSE;
+}
+
+/* Same as XGetTextProperty () but may use the prefetched value */
+static gboolean
+get_text_prop (DisplayInfo *display_info, Window w, XTextProperty *tp, Atom a)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems;
+    unsigned long bytes_after;
+    unsigned char *data;
+
+    data = NULL;
+    if ((get_window_property (display_info, w, a, 0L, 1000000L, FALSE, AnyPropertyType,
+                              &actual_type, &actual_format, &nitems, &bytes_after,
+                              &data) == Success) && (actual_type != None))
+    {
+        tp->value = data;
+        tp->encoding = actual_type;
+        tp->format = actual_format;
+        tp->nitems = nitems;
+        return TRUE;
+    }
+
+    if (data)
+    {
+        XFree (data);
+    }
+    tp->value = NULL;
+    tp->encoding = None;
+    tp->format = 0;
+    tp->nitems = 0;
+
+    return FALSE;
+}
+
 static char *
 text_property_to_utf8 (DisplayInfo *display_info, const XTextProperty * prop)
 {
@@ -674,7 +941,7 @@ get_text_property (DisplayInfo *display_info, Window w, Atom a)
 
     TRACE ("entering get_text_property");
     text.nitems = 0;
-    if (XGetTextProperty (display_info->dpy, w, &text, a))
+    if (get_text_prop (display_info, w, &text, a))
     {
         retval = text_property_to_utf8 (display_info, &text);
         if (retval)
@@ -689,7 +956,7 @@ get_text_property (DisplayInfo *display_info, Window w, Atom a)
     else
     {
         retval = NULL;
-        TRACE ("XGetTextProperty() failed");
+        TRACE ("get_text_prop() failed");
     }
 
     return retval;
@@ -709,9 +976,9 @@ getUTF8StringData (DisplayInfo *display_info, Window w, int atom_id, gchar **str
     TRACE ("entering getUTF8StringData");
 
     *str_p = NULL;
-    if ((XGetWindowProperty (display_info->dpy, w, display_info->atoms[atom_id],
-                             0, G_MAXLONG, FALSE, display_info->atoms[UTF8_STRING], &type,
-                             &format, &n_items, &bytes_after, (unsigned char **) &str) != Success) || (type == None))
+    if ((get_window_property (display_info, w, display_info->atoms[atom_id],
+                              0, G_MAXLONG, FALSE, display_info->atoms[UTF8_STRING], &type,
+                              &format, &n_items, &bytes_after, (unsigned char **) &str) != Success) || (type == None))
     {
         TRACE ("no UTF8_STRING property found");
         return FALSE;
@@ -843,9 +1110,9 @@ getWindowProp (DisplayInfo *display_info, Window window, int atom_id, Window *w)
     g_return_val_if_fail (((atom_id >= 0) && (atom_id < ATOM_COUNT)), FALSE);
 
     *w = None;
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[atom_id],
-                            0L, 1L, FALSE, XA_WINDOW, &type, &format, &nitems,
-                            &bytes_after, (unsigned char **) &prop) == Success)
+    if (get_window_property (display_info, window, display_info->atoms[atom_id],
+                             0L, 1L, FALSE, XA_WINDOW, &type, &format, &nitems,
+                             &bytes_after, (unsigned char **) &prop) == Success)
     {
         if (prop)
         {
@@ -930,7 +1197,7 @@ getWindowRole (DisplayInfo *display_info, Window window, gchar **role)
     *role = NULL;
     g_return_val_if_fail (window != None, FALSE);
 
-    if (XGetTextProperty (display_info->dpy, window, &tp, display_info->atoms[WM_WINDOW_ROLE]))
+    if (get_text_prop (display_info, window, &tp, display_info->atoms[WM_WINDOW_ROLE]))
     {
         if (tp.value)
         {
@@ -973,9 +1240,9 @@ getNetWMUserTime (DisplayInfo *display_info, Window window, guint32 *timestamp)
 
     g_return_val_if_fail (window != None, FALSE);
 
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[NET_WM_USER_TIME],
-                            0L, 1L, FALSE, XA_CARDINAL, &actual_type, &actual_format, &nitems,
-                            &bytes_after, (unsigned char **) &data) == Success)
+    if (get_window_property (display_info, window, display_info->atoms[NET_WM_USER_TIME],
+                             0L, 1L, FALSE, XA_CARDINAL, &actual_type, &actual_format, &nitems,
+                             &bytes_after, (unsigned char **) &data) == Success)
     {
         if ((data) && (actual_type == XA_CARDINAL)
             && (nitems == 1) && (bytes_after == 0))
@@ -1020,7 +1287,7 @@ getClientID (DisplayInfo *display_info, Window window, gchar **client_id)
 
     if (getWindowProp (display_info, window, WM_CLIENT_LEADER, &id) && (id != None))
     {
-        if (XGetTextProperty (display_info->dpy, id, &tp, display_info->atoms[SM_CLIENT_ID]))
+        if (get_text_prop (display_info, id, &tp, display_info->atoms[SM_CLIENT_ID]))
         {
             if (tp.encoding == XA_STRING && tp.format == 8 && tp.nitems != 0)
             {
@@ -1070,9 +1337,9 @@ getKDEIcon (DisplayInfo *display_info, Window window, Pixmap * pixmap, Pixmap *
     *mask = None;
 
     icons = NULL;
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[KWM_WIN_ICON],
-                            0L, G_MAXLONG, FALSE, display_info->atoms[KWM_WIN_ICON], &type,
-                            &format, &nitems, &bytes_after, (unsigned char **)&data) != Success)
+    if (get_window_property (display_info, window, display_info->atoms[KWM_WIN_ICON],
+                             0L, G_MAXLONG, FALSE, display_info->atoms[KWM_WIN_ICON], &type,
+                             &format, &nitems, &bytes_after, (unsigned char **)&data) != Success)
     {
         return FALSE;
     }
@@ -1101,9 +1368,9 @@ getRGBIconData (DisplayInfo *display_info, Window window, unsigned long **data,
     int format;
     unsigned long bytes_after;
 
-    if (XGetWindowProperty (display_info->dpy, window, display_info->atoms[NET_WM_ICON],
-                            0L, G_MAXLONG, FALSE, XA_CARDINAL, &type, &format, nitems,
-                            &bytes_after, (unsigned char **) data) != Success)
+    if (get_window_property (display_info, window, display_info->atoms[NET_WM_ICON],
+                             0L, G_MAXLONG, FALSE, XA_CARDINAL, &type, &format, nitems,
+                             &bytes_after, (unsigned char **) data) != Success)
     {
         *data = NULL;
         return FALSE;
@@ -1205,6 +1472,7 @@ updateXserverTime (DisplayInfo *display_info)
 
     g_return_if_fail (display_info);
 
+    display_info->timestamp_pending = TRUE;
     XChangeProperty (display_info->dpy, display_info->timestamp_win,
                      display_info->atoms[XFWM4_TIMESTAMP_PROP],
                      display_info->atoms[XFWM4_TIMESTAMP_PROP],
@@ -1217,6 +1485,7 @@ getXServerTime (DisplayInfo *display_info)
     ScreenInfo *screen_info;
     XEvent xevent;
     guint32 timestamp;
+    gint64 elapsed;
 
     g_return_val_if_fail (display_info, CurrentTime);
     timestamp = myDisplayGetCurrentTime (display_info);
@@ -1230,6 +1499,22 @@ getXServerTime (DisplayInfo *display_info)
         XWindowEvent (display_info->dpy, display_info->timestamp_win, PropertyChangeMask, &xevent);
         timestamp = myDisplayUpdateCurrentTime (display_info, &xevent);
     }
+    else
+    {
+        /*
+         * The server clock kept running since the last event we got, which
+         * it had stamped before we saw it, so adding the time elapsed since
+         * keeps the estimate just behind the server time, never ahead.
+         */
+        elapsed = g_get_monotonic_time () - display_info->current_time_clock;
+        timestamp += (guint32) (elapsed / 1000);
+
+        /* Anchor the estimate again when the PropertyNotify comes back */
+        if ((elapsed > XSERVER_TIME_REFRESH) && !(display_info->timestamp_pending))
+        {
+            updateXserverTime (display_info);
+        }
+    }
 
     TRACE ("getXServerTime gives timestamp=%u", (guint32) timestamp);
     return timestamp;
@@ -1249,7 +1534,7 @@ checkKdeSystrayWindow (DisplayInfo *display_info, Window window)
     TRACE ("entering checkKdeSystrayWindow");
     g_return_val_if_fail (window != None, FALSE);
 
-    XGetWindowProperty(display_info->dpy, window, display_info->atoms[KDE_NET_WM_SYSTEM_TRAY_WINDOW_FOR],
+    get_window_property (display_info, window, display_info->atoms[KDE_NET_WM_SYSTEM_TRAY_WINDOW_FOR],
                        0L, sizeof(Window), FALSE, XA_WINDOW, &actual_type, &actual_format,
                        &nitems, &bytes_after, (unsigned char **) &data);
 
@@ -38,6 +38,7 @@
 #include <gdk/gdk.h>
 
 #include "display.h"
+#include "geometry.h"
 
 #define MWM_HINTS_ELEMENTS                      3L
 #define MAX_STR_LENGTH                          255
@@ -82,6 +83,7 @@
 #define WIN_LAYER_DOCK                          8
 #define WIN_LAYER_ABOVE_DOCK                    10
 #define WIN_LAYER_FULLSCREEN                    12
+#define WIN_LAYER_COUNT                         (WIN_LAYER_FULLSCREEN + 1)
 
 #define NET_WM_MOVERESIZE_SIZE_TOPLEFT          0
 #define NET_WM_MOVERESIZE_SIZE_TOP              1
@@ -107,19 +109,6 @@
 
 #define NET_WM_OPAQUE                           G_MAXUINT32
 
-#define STRUTS_LEFT                             0
-#define STRUTS_RIGHT                            1
-#define STRUTS_TOP                              2
-#define STRUTS_BOTTOM                           3
-#define STRUTS_LEFT_START_Y                     4
-#define STRUTS_LEFT_END_Y                       5
-#define STRUTS_RIGHT_START_Y                    6
-#define STRUTS_RIGHT_END_Y                      7
-#define STRUTS_TOP_START_X                      8
-#define STRUTS_TOP_END_X                        9
-#define STRUTS_BOTTOM_START_X                   10
-#define STRUTS_BOTTOM_END_X                     11
-
 /* Convenient macro */
 #define HINTS_ACCEPT_INPUT(wmhints)     (!(wmhints) ||                                                              \
                                          ((wmhints) && !(wmhints->flags & InputHint)) ||                            \
@@ -218,6 +207,18 @@ void                     getTransientFor                        (DisplayInfo *,
                                                                  Window,
                                                                  Window,
                                                                  Window *);
+XWMHints                *getWMHints                             (DisplayInfo *,
+                                                                 Window);
+gboolean                 getWMNormalHints                       (DisplayInfo *,
+                                                                 Window,
+                                                                 XSizeHints *);
+gboolean                 getClassHint                           (DisplayInfo *,
+                                                                 Window,
+                                                                 XClassHint *);
+gboolean                 getWMColormapWindows                   (DisplayInfo *,
+                                                                 Window,
+                                                                 Window **,
+                                                                 int *);
 gboolean                 getWindowName                          (DisplayInfo *,
                                                                  Window,
                                                                  gchar **);
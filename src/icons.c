@@ -448,7 +448,7 @@ try_pixmap_and_mask (ScreenInfo *screen_info, Pixmap src_pixmap, Pixmap src_mask
         return NULL;
     }
 
-    gdk_error_trap_push ();
+    myDisplayErrorTrapPush (screen_info->display_info);
     get_pixmap_geometry (myScreenGetXDisplay(screen_info), src_pixmap, &w, &h);
     unscaled = get_pixbuf_from_pixmap (screen_info->gscr, src_pixmap, 0, 0, 0, 0, w, h);
     icon = NULL;
@@ -459,7 +459,7 @@ try_pixmap_and_mask (ScreenInfo *screen_info, Pixmap src_pixmap, Pixmap src_mask
         get_pixmap_geometry (myScreenGetXDisplay(screen_info), src_mask, &w, &h);
         mask = get_pixbuf_from_pixmap (screen_info->gscr, src_mask, 0, 0, 0, 0, w, h);
     }
-    gdk_error_trap_pop ();
+    myDisplayErrorTrapPopIgnored (screen_info->display_info);
 
     if (mask)
     {
@@ -535,9 +535,9 @@ getAppIcon (ScreenInfo *screen_info, Window window, guint width, guint height)
         return scaled_from_pixdata (pixdata, w, h, width, height);
     }
 
-    gdk_error_trap_push ();
-    hints = XGetWMHints (myScreenGetXDisplay(screen_info), window);
-    gdk_error_trap_pop ();
+    myDisplayErrorTrapPush (screen_info->display_info);
+    hints = getWMHints (screen_info->display_info, window);
+    myDisplayErrorTrapPopIgnored (screen_info->display_info);
 
     if (hints)
     {
@@ -95,6 +95,8 @@ static char revision[]="@(#)$ " PACKAGE " version " VERSION " revision " REVISIO
 
 static DisplayInfo *main_display_info = NULL;
 static gint compositor = COMPOSITOR_MODE_MANUAL;
+static gchar *record_events = NULL;
+static int signal_pipe[2] = { -1, -1 };
 
 #ifdef DEBUG
 static gboolean
@@ -155,21 +157,78 @@ handleSignal (int sig)
             case SIGUSR1:
                 main_display_info->reload = TRUE;
                 break;
+            case SIGUSR2:
+                main_display_info->dump = TRUE;
+                /* Wake up the main loop, an idle window manager would never see the flag */
+                if (write (signal_pipe[1], "", 1) < 0)
+                {
+                    /* Pipe full, a wake up is already pending */
+                }
+                break;
             default:
                 break;
         }
     }
 }
 
+static gboolean
+signal_pipe_cb (GIOChannel *source, GIOCondition condition, gpointer data)
+{
+    gchar buf[16];
+
+    while (read (signal_pipe[0], buf, sizeof (buf)) > 0)
+    {
+        /* Drain */
+    }
+
+    if ((main_display_info) && (main_display_info->dump))
+    {
+        main_display_info->dump = FALSE;
+        dumpState (main_display_info);
+    }
+
+    return TRUE;
+}
+
+static void
+setupSignalPipe (void)
+{
+    GIOChannel *channel;
+
+    if (signal_pipe[0] != -1)
+    {
+        return;
+    }
+    if (pipe (signal_pipe) < 0)
+    {
+        g_warning ("Cannot create the signal pipe: %s", g_strerror (errno));
+        signal_pipe[0] = signal_pipe[1] = -1;
+        return;
+    }
+    fcntl (signal_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl (signal_pipe[1], F_SETFL, O_NONBLOCK);
+    fcntl (signal_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl (signal_pipe[1], F_SETFD, FD_CLOEXEC);
+
+    channel = g_io_channel_unix_new (signal_pipe[0]);
+    g_io_add_watch (channel, G_IO_IN, signal_pipe_cb, NULL);
+    g_io_channel_unref (channel);
+}
+
 static void
 setupHandler (gboolean install)
 {
     struct sigaction act;
 
     if (install)
+    {
+        setupSignalPipe ();
         act.sa_handler = handleSignal;
+    }
     else
+    {
         act.sa_handler = SIG_DFL;
+    }
 
     sigemptyset (&act.sa_mask);
     act.sa_flags = 0;
@@ -177,6 +236,7 @@ setupHandler (gboolean install)
     sigaction (SIGTERM, &act, NULL);
     sigaction (SIGHUP,  &act, NULL);
     sigaction (SIGUSR1, &act, NULL);
+    sigaction (SIGUSR2, &act, NULL);
 }
 
 static void
@@ -559,6 +619,10 @@ initialize (gint compositor_mode, gboolean replace_wm)
     }
     main_display_info->xfilter = eventFilterInit ((gpointer) main_display_info);
     eventFilterPush (main_display_info->xfilter, xfwm4_event_filter, (gpointer) main_display_info);
+    if (record_events)
+    {
+        eventFilterRecord (main_display_info->xfilter, main_display_info->dpy, record_events);
+    }
     initPerDisplayCallbacks (main_display_info);
 
     return sessionStart (main_display_info);
@@ -609,6 +673,7 @@ main (int argc, char **argv)
         { "compositor", '\0', 0, G_OPTION_ARG_STRING, &compositor_foo, N_("Set the compositor mode (not supported)"), "on|off|auto" },
 #endif
         { "replace", '\0', 0, G_OPTION_ARG_NONE, &replace_wm, N_("Replace the existing window manager"), NULL },
+        { "record-events", '\0', 0, G_OPTION_ARG_FILENAME, &record_events, N_("Record the X events to FILE for xfwm4-replay"), "FILE" },
         { "version", 'V', 0, G_OPTION_ARG_NONE, &version, N_("Print version information and exit"), NULL },
         { NULL }
     };
@@ -53,6 +53,13 @@ getMouseXY (ScreenInfo *screen_info, Window w, int *x2, int *y2)
 
     TRACE ("entering getMouseXY");
 
+    if (w == screen_info->xroot)
+    {
+        mask = 0;
+        myDisplayGetPointer (screen_info->display_info, w, x2, y2, &mask);
+        return mask;
+    }
+
     XQueryPointer (myScreenGetXDisplay (screen_info), w, &w1, &w2, &x1, &y1, x2, y2, &mask);
     return mask;
 }
@@ -164,13 +171,13 @@ checkWindowOnRoot(ScreenInfo *screen_info, Window w)
     display_info = screen_info->display_info;
     wins = NULL;
 
-    gdk_error_trap_push ();
+    myDisplayErrorTrapPush (display_info);
     test = XQueryTree(display_info->dpy, w, &dummy_root, &parent, &wins, &count);
     if (wins)
     {
         XFree (wins);
     }
-    return (!gdk_error_trap_pop () && (test != 0) && (dummy_root == parent));
+    return (!myDisplayErrorTrapPop (display_info) && (test != 0) && (dummy_root == parent));
 }
 
 void
@@ -40,6 +40,7 @@
 #include "compositor.h"
 #include "focus.h"
 #include "frame.h"
+#include "geometry.h"
 #include "moveresize.h"
 #include "netwm.h"
 #include "placement.h"
@@ -59,10 +60,24 @@
     LeaveWindowMask
 
 #define TILE_DISTANCE 10
+#define MOTION_REFRESH_RATE 60 /* when the screen's own is unknown */
 #define BORDER_TILE_LENGTH_RELATIVE 5
 #define use_xor_move(screen_info) (screen_info->params->box_move && !compositorIsActive (screen_info))
 #define use_xor_resize(screen_info) (screen_info->params->box_resize && !compositorIsActive (screen_info))
 
+/*
+ * Edges that a moved or resized window can snap to. They are collected
+ * when the operation starts and sorted on their position, so that each
+ * motion only looks at the few edges within the snapping distance.
+ */
+typedef struct _SnapEdges SnapEdges;
+struct _SnapEdges
+{
+    GeometryEdges edges;
+    gboolean resize;
+    guint workspace;
+};
+
 typedef struct _MoveResizeData MoveResizeData;
 struct _MoveResizeData
 {
@@ -86,58 +101,31 @@ struct _MoveResizeData
     gint oldw, oldh;
     gint handle;
     Poswin *poswin;
+    SnapEdges snap;
+
+    /* Latest pointer motion, applied at most once per frame */
+    void (*motion_func) (MoveResizeData *, XEvent *);
+    XEvent motion;
+    gboolean motion_pending;
+    guint motion_timeout_id;
+    gint64 motion_time;
+    gint64 frame_interval;
 };
 
 static int
 clientCheckSize (Client * c, int size, int base, int min, int max, int incr, gboolean source_is_application)
 {
-    int size_return;
+    gboolean constrained;
 
     g_return_val_if_fail (c != NULL, size);
     TRACE ("entering clientCheckSize");
 
-    size_return = size;
-
     /* Bypass resize increment and max sizes for fullscreen */
-    if (!FLAG_TEST (c->flags, CLIENT_FLAG_FULLSCREEN)
+    constrained = !FLAG_TEST (c->flags, CLIENT_FLAG_FULLSCREEN)
         && !(FLAG_TEST_ALL (c->flags, CLIENT_FLAG_MAXIMIZED)
-             && (c->screen_info->params->borderless_maximize)))
-    {
-
-        if (!source_is_application && (c->size->flags & PResizeInc) && (incr))
-        {
-            int a;
-            int b = 0;
-
-            if (c->size->flags & PBaseSize)
-            {
-                b = base;
-            }
-
-            a = (size_return - b) / incr;
-            size_return = b + (a * incr);
-        }
-        if (c->size->flags & PMaxSize)
-        {
-            if (size_return > max)
-            {
-                size_return = max;
-            }
-        }
-    }
+             && (c->screen_info->params->borderless_maximize));
 
-    if (c->size->flags & PMinSize)
-    {
-        if (size_return < min)
-        {
-            size_return = min;
-        }
-    }
-    if (size_return < 1)
-    {
-        size_return = 1;
-    }
-    return size_return;
+    return geometryCheckSize (c->size, size, base, min, max, incr, constrained, !source_is_application);
 }
 
 int
@@ -178,6 +166,7 @@ clientMovePointer (DisplayInfo *display_info, gint dx, gint dy, guint repeat)
     {
         XWarpPointer (display_info->dpy, None, None, 0, 0, 0, 0, dx, dy);
     }
+    myDisplayInvalidatePointer (display_info);
 }
 
 static gboolean
@@ -240,6 +229,7 @@ clientSetHandle(MoveResizeData *passdata, int handle)
     }
 
     XWarpPointer (display_info->dpy, None, screen_info->xroot, 0, 0, 0, 0, px, py);
+    myDisplayInvalidatePointer (display_info);
     /* Update internal data */
     passdata->handle = handle;
     passdata->mx = px;
@@ -254,11 +244,7 @@ clientSetHandle(MoveResizeData *passdata, int handle)
 
 /* clientConstrainRatio - adjust the given width and height to account for
    the constraints imposed by size hints
-
-   The aspect ratio stuff, is borrowed from uwm's CheckConsistency routine.
  */
-
-#define MAKE_MULT(a,b) ((b==1) ? (a) : (((int)((a)/(b))) * (b)) )
 static void
 clientConstrainRatio (Client * c, int handle)
 {
@@ -267,74 +253,10 @@ clientConstrainRatio (Client * c, int handle)
     TRACE ("entering clientConstrainRatio");
     TRACE ("client \"%s\" (0x%lx)", c->name, c->window);
 
-    if (c->size->flags & PAspect)
-    {
-        int xinc, yinc, minx, miny, maxx, maxy, delta;
-
-        xinc = c->size->width_inc;
-        yinc = c->size->height_inc;
-        minx = c->size->min_aspect.x;
-        miny = c->size->min_aspect.y;
-        maxx = c->size->max_aspect.x;
-        maxy = c->size->max_aspect.y;
-
-        if ((minx * c->height > miny * c->width) && (miny) &&
-            ((handle == CORNER_COUNT + SIDE_TOP) || (handle == CORNER_COUNT + SIDE_BOTTOM)))
-        {
-            /* Change width to match */
-            delta = MAKE_MULT (minx * c->height /  miny - c->width, xinc);
-            if (!(c->size->flags & PMaxSize) ||
-                (c->width + delta <= c->size->max_width))
-            {
-                c->width += delta;
-            }
-        }
-        if ((minx * c->height > miny * c->width) && (minx))
-        {
-            delta = MAKE_MULT (c->height - c->width * miny / minx, yinc);
-            if (!(c->size->flags & PMinSize) ||
-                (c->height - delta >= c->size->min_height))
-            {
-                c->height -= delta;
-            }
-            else
-            {
-                delta = MAKE_MULT (minx * c->height / miny - c->width, xinc);
-                if (!(c->size->flags & PMaxSize) ||
-                    (c->width + delta <= c->size->max_width))
-                  c->width += delta;
-            }
-        }
-
-        if ((maxx * c->height < maxy * c->width) && (maxx) &&
-            ((handle == CORNER_COUNT + SIDE_LEFT) || (handle == CORNER_COUNT + SIDE_RIGHT)))
-        {
-            delta = MAKE_MULT (c->width * maxy / maxx - c->height, yinc);
-            if (!(c->size->flags & PMaxSize) ||
-                (c->height + delta <= c->size->max_height))
-            {
-                c->height += delta;
-            }
-        }
-        if ((maxx * c->height < maxy * c->width) && (maxy))
-        {
-            delta = MAKE_MULT (c->width - maxx * c->height / maxy, xinc);
-            if (!(c->size->flags & PMinSize) ||
-                (c->width - delta >= c->size->min_width))
-            {
-                c->width -= delta;
-            }
-            else
-            {
-                delta = MAKE_MULT (c->width * maxy / maxx - c->height, yinc);
-                if (!(c->size->flags & PMaxSize) ||
-                    (c->height + delta <= c->size->max_height))
-                {
-                    c->height += delta;
-                }
-            }
-        }
-    }
+    geometryConstrainRatio (c->size,
+                            (handle == CORNER_COUNT + SIDE_TOP) || (handle == CORNER_COUNT + SIDE_BOTTOM),
+                            (handle == CORNER_COUNT + SIDE_LEFT) || (handle == CORNER_COUNT + SIDE_RIGHT),
+                            &c->width, &c->height);
 }
 
 static void
@@ -352,35 +274,25 @@ clientDrawOutline (Client * c)
     }
 }
 
-static gboolean
-clientCheckOverlap (int s1, int e1, int s2, int e2)
-{
-    /* Simple overlap test for an arbitary axis. -Cliff */
-    if ((s1 >= s2 && s1 <= e2) ||
-        (e1 >= s2 && e1 <= e2) ||
-        (s2 >= s1 && s2 <= e1) ||
-        (e2 >= s1 && e2 <= e1))
-    {
-        return TRUE;
-    }
-    return FALSE;
-}
-
-static int
-clientFindClosestEdgeX (Client *c, int edge_pos)
+/*
+ * When resizing, the extent of the other windows is taken with the
+ * decorations of the resized one, as clientFindClosestEdgeX/Y always did.
+ * The sequence numbers keep the first match of the former scan on ties.
+ */
+static void
+snap_edges_init (SnapEdges *snap, Client *c, gboolean resize)
 {
-    /* Find the closest edge of anything that we can snap to, taking
-       frames into account, or just return the original value if nothing
-       is within the snapping range. -Cliff */
-
-    Client *c2;
     ScreenInfo *screen_info;
-    guint i;
-    int snap_width, closest;
+    Client *c2;
+    guint i, seq;
+    int x1, x2, y1, y2;
+
+    TRACE ("entering snap_edges_init");
 
     screen_info = c->screen_info;
-    snap_width = screen_info->params->snap_width;
-    closest = edge_pos + snap_width + 2; /* This only needs to be out of the snap range to work. -Cliff */
+    geometryEdgesInit (&snap->edges);
+    snap->resize = resize;
+    snap->workspace = screen_info->current_ws;
 
     for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
     {
@@ -390,22 +302,80 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
                   && FLAG_TEST (c2->flags, CLIENT_FLAG_HAS_STRUT)
                   && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))))
         {
-
-            if (clientCheckOverlap (c->y - frameExtentTop (c) - 1, c->y + c->height + frameExtentBottom (c) + 1, c2->y - frameExtentTop (c) - 1, c2->y + c2->height + frameExtentBottom (c) + 1))
+            seq = 2 * i + 1;
+            if (resize)
             {
-                if (abs (c2->x - frameExtentLeft (c2) - edge_pos) < abs (closest - edge_pos))
-                {
-                    closest = c2->x - frameExtentLeft (c2);
-                }
-                if (abs ((c2->x + c2->width) + frameExtentRight (c2) - edge_pos) < abs (closest - edge_pos))
-                {
-                    closest = (c2->x + c2->width) + frameExtentRight (c2);
-                }
+                x1 = c2->x - frameExtentLeft (c2);
+                x2 = c2->x + c2->width + frameExtentRight (c2);
+                y1 = c2->y - frameExtentTop (c2);
+                y2 = c2->y + c2->height + frameExtentBottom (c2);
+                geometryEdgeAdd (snap->edges.left, x1, c2->y - frameExtentTop (c) - 1,
+                                c2->y + c2->height + frameExtentBottom (c) + 1, seq);
+                geometryEdgeAdd (snap->edges.right, x2, c2->y - frameExtentTop (c) - 1,
+                                c2->y + c2->height + frameExtentBottom (c) + 1, seq + 1);
+                geometryEdgeAdd (snap->edges.top, y1, c2->x - frameExtentLeft (c) - 1,
+                                c2->x + c2->width + frameExtentRight (c) + 1, seq);
+                geometryEdgeAdd (snap->edges.bottom, y2, c2->x - frameExtentLeft (c) - 1,
+                                c2->x + c2->width + frameExtentRight (c) + 1, seq + 1);
+            }
+            else
+            {
+                x1 = frameExtentX (c2);
+                x2 = x1 + frameExtentWidth (c2);
+                y1 = frameExtentY (c2);
+                y2 = y1 + frameExtentHeight (c2);
+                geometryEdgeAdd (snap->edges.right, x2, y1, y2, seq);
+                geometryEdgeAdd (snap->edges.left, x1, y1, y2, seq + 1);
+                geometryEdgeAdd (snap->edges.bottom, y2, x1, x2, seq);
+                geometryEdgeAdd (snap->edges.top, y1, x1, x2, seq + 1);
             }
         }
     }
 
-    if (abs (closest - edge_pos) > snap_width)
+    geometryEdgesSort (&snap->edges);
+}
+
+static void
+snap_edges_free (SnapEdges *snap)
+{
+    geometryEdgesFree (&snap->edges);
+}
+
+/* The visible windows change along with the workspace while moving */
+static void
+snap_edges_update (SnapEdges *snap, Client *c)
+{
+    if (snap->workspace != c->screen_info->current_ws)
+    {
+        snap_edges_free (snap);
+        snap_edges_init (snap, c, snap->resize);
+    }
+}
+
+static int
+clientFindClosestEdgeX (Client *c, SnapEdges *snap, int edge_pos)
+{
+    /* Find the closest edge of anything that we can snap to, taking
+       frames into account, or just return the original value if nothing
+       is within the snapping range. -Cliff */
+
+    ScreenInfo *screen_info;
+    int snap_width, closest, delta;
+    int start, end;
+    guint seq;
+
+    screen_info = c->screen_info;
+    snap_width = screen_info->params->snap_width;
+    delta = snap_width + 1; /* This only needs to be out of the snap range to work. -Cliff */
+    seq = G_MAXUINT;
+    closest = edge_pos;
+
+    start = c->y - frameExtentTop (c) - 1;
+    end = c->y + c->height + frameExtentBottom (c) + 1;
+    geometryEdgesClosest (snap->edges.left, edge_pos, G_MININT, G_MAXINT, start, end, &delta, &seq, &closest);
+    geometryEdgesClosest (snap->edges.right, edge_pos, G_MININT, G_MAXINT, start, end, &delta, &seq, &closest);
+
+    if (delta > snap_width)
     {
         closest = edge_pos;
     }
@@ -414,45 +384,29 @@ clientFindClosestEdgeX (Client *c, int edge_pos)
 }
 
 static int
-clientFindClosestEdgeY (Client *c, int edge_pos)
+clientFindClosestEdgeY (Client *c, SnapEdges *snap, int edge_pos)
 {
     /* This function is mostly identical to the one above, but swaps the
        axes. If there's a better way to do it than this, I'd like to
        know. -Cliff */
 
-    Client *c2;
     ScreenInfo *screen_info;
-    guint i;
-    int snap_width, closest;
+    int snap_width, closest, delta;
+    int start, end;
+    guint seq;
 
     screen_info = c->screen_info;
     snap_width = screen_info->params->snap_width;
-    closest = edge_pos + snap_width + 1; /* This only needs to be out of the snap range to work. -Cliff */
+    delta = snap_width + 1; /* This only needs to be out of the snap range to work. -Cliff */
+    seq = G_MAXUINT;
+    closest = edge_pos;
 
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-    {
-        if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
-            (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
-             || ((screen_info->params->snap_to_border)
-                  && FLAG_TEST (c2->flags, CLIENT_FLAG_HAS_STRUT)
-                  && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))))
-        {
+    start = c->x - frameExtentLeft (c) - 1;
+    end = c->x + c->width + frameExtentRight (c) + 1;
+    geometryEdgesClosest (snap->edges.top, edge_pos, G_MININT, G_MAXINT, start, end, &delta, &seq, &closest);
+    geometryEdgesClosest (snap->edges.bottom, edge_pos, G_MININT, G_MAXINT, start, end, &delta, &seq, &closest);
 
-            if (clientCheckOverlap (c->x - frameExtentLeft (c) - 1, c->x + c->width + frameExtentRight (c) + 1, c2->x - frameExtentLeft (c) - 1, c2->x + c2->width + frameExtentRight (c) + 1))
-            {
-                if (abs (c2->y - frameExtentTop(c2) - edge_pos) < abs (closest - edge_pos))
-                {
-                    closest = c2->y - frameExtentTop (c2);
-                }
-                if (abs ((c2->y + c2->height) + frameExtentBottom (c2) - edge_pos) < abs (closest - edge_pos))
-                {
-                    closest = (c2->y + c2->height) + frameExtentBottom (c2);
-                }
-            }
-        }
-    }
-
-    if (abs (closest - edge_pos) > snap_width)
+    if (delta > snap_width)
     {
         closest = edge_pos;
     }
@@ -461,156 +415,41 @@ clientFindClosestEdgeY (Client *c, int edge_pos)
 }
 
 static void
-clientSnapPosition (Client * c, int prev_x, int prev_y)
+clientSnapPosition (Client * c, SnapEdges *snap, int prev_x, int prev_y)
 {
     ScreenInfo *screen_info;
-    Client *c2;
-    guint i;
-    int cx, cy, delta;
-    int disp_x, disp_y, disp_max_x, disp_max_y;
-    int frame_x, frame_y, frame_height, frame_width;
-    int frame_top, frame_left;
-    int frame_x2, frame_y2;
-    int best_frame_x, best_frame_y;
-    int best_delta_x, best_delta_y;
-    int c_frame_x1, c_frame_x2, c_frame_y1, c_frame_y2;
-    GdkRectangle rect;
+    GdkRectangle frame, rect;
+    guint snapped;
 
     g_return_if_fail (c != NULL);
     TRACE ("entering clientSnapPosition");
     TRACE ("Snapping client \"%s\" (0x%lx)", c->name, c->window);
 
     screen_info = c->screen_info;
-    best_delta_x = screen_info->params->snap_width + 1;
-    best_delta_y = screen_info->params->snap_width + 1;
-
-    frame_x = frameExtentX (c);
-    frame_y = frameExtentY (c);
-    frame_height = frameExtentHeight (c);
-    frame_width = frameExtentWidth (c);
-    frame_top = frameExtentTop (c);
-    frame_left = frameExtentLeft (c);
 
-    cx = frame_x + (frame_width / 2);
-    cy = frame_y + (frame_height / 2);
+    frame.x = frameExtentX (c);
+    frame.y = frameExtentY (c);
+    frame.width = frameExtentWidth (c);
+    frame.height = frameExtentHeight (c);
 
-    frame_x2 = frame_x + frame_width;
-    frame_y2 = frame_y + frame_height;
-    best_frame_x = frame_x;
-    best_frame_y = frame_y;
-
-    myScreenFindMonitorAtPoint (screen_info, cx, cy, &rect);
+    myScreenFindMonitorAtPoint (screen_info,
+                                frame.x + (frame.width / 2),
+                                frame.y + (frame.height / 2), &rect);
 
-    disp_x = rect.x;
-    disp_y = rect.y;
-    disp_max_x = rect.x + rect.width;
-    disp_max_y = rect.y + rect.height;
+    snap_edges_update (snap, c);
 
-    if (screen_info->params->snap_to_border)
+    snapped = geometrySnapFrame (&snap->edges, &frame, &rect,
+                                 screen_info->params->snap_width,
+                                 screen_info->params->snap_to_border,
+                                 screen_info->params->snap_resist,
+                                 c->x - prev_x, c->y - prev_y);
+    if (snapped & GEOMETRY_SNAPPED_X)
     {
-        if (abs (disp_x - frame_x) < abs (disp_max_x - frame_x2))
-        {
-            if (!screen_info->params->snap_resist || ((frame_x <= disp_x) && (c->x < prev_x)))
-            {
-                best_delta_x = abs (disp_x - frame_x);
-                best_frame_x = disp_x;
-            }
-        }
-        else
-        {
-            if (!screen_info->params->snap_resist || ((frame_x2 >= disp_max_x) && (c->x > prev_x)))
-            {
-                best_delta_x = abs (disp_max_x - frame_x2);
-                best_frame_x = disp_max_x - frame_width;
-            }
-        }
-
-        if (abs (disp_y - frame_y) < abs (disp_max_y - frame_y2))
-        {
-            if (!screen_info->params->snap_resist || ((frame_y <= disp_y) && (c->y < prev_y)))
-            {
-                best_delta_y = abs (disp_y - frame_y);
-                best_frame_y = disp_y;
-            }
-        }
-        else
-        {
-            if (!screen_info->params->snap_resist || ((frame_y2 >= disp_max_y) && (c->y > prev_y)))
-            {
-                best_delta_y = abs (disp_max_y - frame_y2);
-                best_frame_y = disp_max_y - frame_height;
-            }
-        }
+        c->x = frame.x + frameExtentLeft (c);
     }
-
-    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
+    if (snapped & GEOMETRY_SNAPPED_Y)
     {
-        if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE)  && (c2 != c) &&
-            (((screen_info->params->snap_to_windows) && (c2->win_layer == c->win_layer))
-             || ((screen_info->params->snap_to_border)
-                  && FLAG_TEST (c2->flags, CLIENT_FLAG_HAS_STRUT)
-                  && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))))
-        {
-            c_frame_x1 = frameExtentX (c2);
-            c_frame_x2 = c_frame_x1 + frameExtentWidth (c2);
-            c_frame_y1 = frameExtentY (c2);
-            c_frame_y2 = c_frame_y1 + frameExtentHeight (c2);
-
-            if ((c_frame_y1 <= frame_y2) && (c_frame_y2 >= frame_y))
-            {
-                delta = abs (c_frame_x2 - frame_x);
-                if (delta < best_delta_x)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_x <= c_frame_x2) && (c->x < prev_x)))
-                    {
-                        best_delta_x = delta;
-                        best_frame_x = c_frame_x2;
-                    }
-                }
-
-                delta = abs (c_frame_x1 - frame_x2);
-                if (delta < best_delta_x)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_x2 >= c_frame_x1) && (c->x > prev_x)))
-                    {
-                        best_delta_x = delta;
-                        best_frame_x = c_frame_x1 - frame_width;
-                    }
-                }
-            }
-
-            if ((c_frame_x1 <= frame_x2) && (c_frame_x2 >= frame_x))
-            {
-                delta = abs (c_frame_y2 - frame_y);
-                if (delta < best_delta_y)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_y <= c_frame_y2) && (c->y < prev_y)))
-                    {
-                        best_delta_y = delta;
-                        best_frame_y = c_frame_y2;
-                    }
-                }
-
-                delta = abs (c_frame_y1 - frame_y2);
-                if (delta < best_delta_y)
-                {
-                    if (!screen_info->params->snap_resist || ((frame_y2 >= c_frame_y1) && (c->y > prev_y)))
-                    {
-                        best_delta_y = delta;
-                        best_frame_y = c_frame_y1 - frame_height;
-                    }
-                }
-            }
-        }
-    }
-
-    if (best_delta_x <= screen_info->params->snap_width)
-    {
-        c->x = best_frame_x + frame_left;
-    }
-    if (best_delta_y <= screen_info->params->snap_width)
-    {
-        c->y = best_frame_y + frame_top;
+        c->y = frame.y + frameExtentTop (c);
     }
 }
 
@@ -767,6 +606,7 @@ clientMoveWarp (Client * c, ScreenInfo * screen_info, int * x_root, int * y_root
     if (warp_pointer)
     {
         XWarpPointer (myScreenGetXDisplay(screen_info), None, None, 0, 0, 0, 0, rx, ry);
+        myDisplayInvalidatePointer (screen_info->display_info);
         *x_root += rx;
         *y_root += ry;
     }
@@ -856,6 +696,235 @@ clientMoveTile (Client *c, XMotionEvent *xevent)
     return FALSE;
 }
 
+/*
+ * Motion events are only recorded as they come in, the latest one is
+ * applied at most once per frame. When compositing, the compositor
+ * applies it right before it paints, so a resize or the outline of a box
+ * move shows in that very frame. An opaque move shows in the next one,
+ * the compositor only learns about it from the ConfigureNotify. Otherwise
+ * a timer applies it one refresh interval after the previous motion. Whatever is left pending when the operation
+ * ends normally is applied then, so the window lands exactly where the
+ * pointer was; it is dropped on cancel or when the window goes away.
+ */
+static void
+clientFlushMotion (MoveResizeData *passdata)
+{
+    if (passdata->motion_timeout_id != 0)
+    {
+        g_source_remove (passdata->motion_timeout_id);
+        passdata->motion_timeout_id = 0;
+    }
+    if (passdata->motion_pending)
+    {
+        passdata->motion_pending = FALSE;
+        passdata->motion_time = g_get_monotonic_time ();
+        passdata->motion_func (passdata, &passdata->motion);
+    }
+}
+
+static gboolean
+motion_timeout_cb (gpointer data)
+{
+    MoveResizeData *passdata;
+
+    passdata = (MoveResizeData *) data;
+    passdata->motion_timeout_id = 0;
+    clientFlushMotion (passdata);
+
+    return FALSE;
+}
+
+static void
+motion_pre_paint_cb (gpointer data)
+{
+    clientFlushMotion ((MoveResizeData *) data);
+}
+
+static void
+clientQueueMotion (MoveResizeData *passdata, XEvent *xevent)
+{
+    gint64 now, next;
+
+    passdata->motion = *xevent;
+    passdata->motion_pending = TRUE;
+    if (compositorSetPrePaintFunc (passdata->c->screen_info, motion_pre_paint_cb, passdata))
+    {
+        return;
+    }
+    if (passdata->motion_timeout_id != 0)
+    {
+        /* Already due for the next frame */
+        return;
+    }
+
+    now = g_get_monotonic_time ();
+    next = passdata->motion_time + passdata->frame_interval;
+    if (next <= now)
+    {
+        clientFlushMotion (passdata);
+        return;
+    }
+    passdata->motion_timeout_id = g_timeout_add ((next - now + 999) / 1000, motion_timeout_cb, passdata);
+}
+
+/* At the end of the operation, nothing may refer to passdata afterwards */
+static void
+clientStopMotion (MoveResizeData *passdata)
+{
+    compositorSetPrePaintFunc (passdata->c->screen_info, NULL, NULL);
+    clientFlushMotion (passdata);
+}
+
+static void
+clientInitMotion (MoveResizeData *passdata, void (*motion_func) (MoveResizeData *, XEvent *))
+{
+    gint refresh_rate;
+
+    refresh_rate = compositorGetRefreshRate (passdata->c->screen_info);
+    if (refresh_rate <= 0)
+    {
+        refresh_rate = MOTION_REFRESH_RATE;
+    }
+
+    passdata->motion_func = motion_func;
+    passdata->motion_pending = FALSE;
+    passdata->motion_timeout_id = 0;
+    passdata->motion_time = 0;
+    passdata->frame_interval = 1000000 / refresh_rate;
+}
+
+static void
+clientMoveMotion (MoveResizeData *passdata, XEvent *xevent)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    Client *c;
+    XWindowChanges wc;
+    int prev_x, prev_y;
+
+    TRACE ("entering clientMoveMotion");
+
+    c = passdata->c;
+    prev_x = c->x;
+    prev_y = c->y;
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    if (!passdata->grab && use_xor_move(screen_info))
+    {
+        myDisplayGrabServer (display_info);
+        passdata->grab = TRUE;
+        clientDrawOutline (c);
+    }
+    if (use_xor_move(screen_info))
+    {
+        clientDrawOutline (c);
+    }
+    if ((screen_info->workspace_count > 1) && !(passdata->is_transient))
+    {
+        clientMoveWarp (c, screen_info,
+                        &xevent->xmotion.x_root,
+                        &xevent->xmotion.y_root,
+                        xevent->xmotion.time);
+    }
+
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_RESTORE_SIZE_POS))
+    {
+
+        if ((ABS (xevent->xmotion.x_root - passdata->mx) > 15) ||
+            (ABS (xevent->xmotion.y_root - passdata->my) > 15))
+        {
+            gboolean size_changed;
+            /* to keep the distance from the edges of the window proportional. */
+            double xratio, yratio;
+
+            xratio = (xevent->xmotion.x_root - frameExtentX (c)) / (double) frameExtentWidth (c);
+            yratio = (xevent->xmotion.y_root - frameExtentY (c)) / (double) frameExtentHeight (c);
+
+            size_changed = clientToggleMaximized (c, c->flags & CLIENT_FLAG_MAXIMIZED, FALSE);
+            if (clientRestoreSizePos (c))
+            {
+                size_changed = TRUE;
+            }
+            if (size_changed)
+            {
+                passdata->move_resized = TRUE;
+
+                passdata->ox = c->x;
+                passdata->mx =  frameExtentX (c) + passdata->px;
+                if ((passdata->mx <  frameExtentX (c)) || (passdata->mx >  frameExtentX (c) + frameExtentWidth (c)))
+                {
+                    passdata->mx = CLAMP(frameExtentX (c) + frameExtentWidth (c) * xratio, frameExtentX (c), frameExtentX (c) + frameExtentWidth (c));
+                }
+
+                passdata->oy = c->y;
+                passdata->my = frameExtentY (c) + passdata->py;
+                if ((passdata->my < frameExtentY (c)) || (passdata->my > frameExtentY (c) + frameExtentHeight (c)))
+                {
+                    passdata->my = CLAMP(frameExtentY (c) + frameExtentHeight (c) * yratio, frameExtentY (c), frameExtentY (c) + frameExtentHeight (c));
+                }
+
+                passdata->configure_flags = CFG_FORCE_REDRAW;
+            }
+        }
+        else
+        {
+            xevent->xmotion.x_root = c->x - passdata->ox + passdata->mx;
+            xevent->xmotion.y_root = c->y - passdata->oy + passdata->my;
+        }
+    }
+
+    c->x = passdata->ox + (xevent->xmotion.x_root - passdata->mx);
+    c->y = passdata->oy + (xevent->xmotion.y_root - passdata->my);
+
+    clientSnapPosition (c, &passdata->snap, prev_x, prev_y);
+    if (clientMoveTile (c, (XMotionEvent *) xevent))
+    {
+        passdata->configure_flags = CFG_FORCE_REDRAW;
+        passdata->move_resized = TRUE;
+    }
+    else
+    {
+        clientConstrainPos(c, FALSE);
+    }
+
+#ifdef SHOW_POSITION
+    if (passdata->poswin)
+    {
+        poswinSetPosition (passdata->poswin, c);
+    }
+#endif /* SHOW_POSITION */
+    if (screen_info->params->box_move)
+    {
+        if (passdata->wireframe)
+        {
+            wireframeUpdate  (c, passdata->wireframe);
+        }
+        else
+        {
+            clientDrawOutline (c);
+        }
+    }
+    else
+    {
+        int changes = CWX | CWY;
+
+        if (passdata->move_resized)
+        {
+            wc.width = c->width;
+            wc.height = c->height;
+            changes |= CWWidth | CWHeight;
+            passdata->move_resized = FALSE;
+        }
+
+        wc.x = c->x;
+        wc.y = c->y;
+        clientConfigure (c, &wc, changes, passdata->configure_flags);
+        /* Configure applied, clear the flags */
+        passdata->configure_flags = NO_CFG_FLAG;
+    }
+}
+
 static eventFilterStatus
 clientMoveEventFilter (XEvent * xevent, gpointer data)
 {
@@ -865,16 +934,12 @@ clientMoveEventFilter (XEvent * xevent, gpointer data)
     MoveResizeData *passdata = (MoveResizeData *) data;
     Client *c = NULL;
     gboolean moving;
-    XWindowChanges wc;
-    int prev_x, prev_y;
     unsigned long cancel_maximize_flags;
     unsigned long cancel_restore_size_flags;
 
     TRACE ("entering clientMoveEventFilter");
 
     c = passdata->c;
-    prev_x=c->x;
-    prev_y=c->y;
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
 
@@ -893,6 +958,7 @@ clientMoveEventFilter (XEvent * xevent, gpointer data)
 
         while (XCheckMaskEvent (display_info->dpy, KeyPressMask, xevent))
         {
+            eventFilterRecordEvent (display_info->xfilter, xevent);
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, xevent);
         }
@@ -922,6 +988,7 @@ clientMoveEventFilter (XEvent * xevent, gpointer data)
         {
             moving = FALSE;
             passdata->released = passdata->use_keys;
+            passdata->motion_pending = FALSE;
 
             if (screen_info->params->box_move)
             {
@@ -992,126 +1059,17 @@ clientMoveEventFilter (XEvent * xevent, gpointer data)
     {
         while (XCheckMaskEvent (display_info->dpy, PointerMotionMask | ButtonMotionMask, xevent))
         {
+            eventFilterRecordEvent (display_info->xfilter, xevent);
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, xevent);
         }
-        if (!passdata->grab && use_xor_move(screen_info))
-        {
-            myDisplayGrabServer (display_info);
-            passdata->grab = TRUE;
-            clientDrawOutline (c);
-        }
-        if (use_xor_move(screen_info))
-        {
-            clientDrawOutline (c);
-        }
-        if ((screen_info->workspace_count > 1) && !(passdata->is_transient))
-        {
-            clientMoveWarp (c, screen_info,
-                            &xevent->xmotion.x_root,
-                            &xevent->xmotion.y_root,
-                            xevent->xmotion.time);
-        }
-
-        if (FLAG_TEST (c->flags, CLIENT_FLAG_RESTORE_SIZE_POS))
-        {
-
-            if ((ABS (xevent->xmotion.x_root - passdata->mx) > 15) ||
-                (ABS (xevent->xmotion.y_root - passdata->my) > 15))
-            {
-                gboolean size_changed;
-                /* to keep the distance from the edges of the window proportional. */
-                double xratio, yratio;
-
-                xratio = (xevent->xmotion.x_root - frameExtentX (c)) / (double) frameExtentWidth (c);
-                yratio = (xevent->xmotion.y_root - frameExtentY (c)) / (double) frameExtentHeight (c);
-
-                size_changed = clientToggleMaximized (c, c->flags & CLIENT_FLAG_MAXIMIZED, FALSE);
-                if (clientRestoreSizePos (c))
-                {
-                    size_changed = TRUE;
-                }
-                if (size_changed)
-                {
-                    passdata->move_resized = TRUE;
-
-                    passdata->ox = c->x;
-                    passdata->mx =  frameExtentX (c) + passdata->px;
-                    if ((passdata->mx <  frameExtentX (c)) || (passdata->mx >  frameExtentX (c) + frameExtentWidth (c)))
-                    {
-                        passdata->mx = CLAMP(frameExtentX (c) + frameExtentWidth (c) * xratio, frameExtentX (c), frameExtentX (c) + frameExtentWidth (c));
-                    }
-
-                    passdata->oy = c->y;
-                    passdata->my = frameExtentY (c) + passdata->py;
-                    if ((passdata->my < frameExtentY (c)) || (passdata->my > frameExtentY (c) + frameExtentHeight (c)))
-                    {
-                        passdata->my = CLAMP(frameExtentY (c) + frameExtentHeight (c) * yratio, frameExtentY (c), frameExtentY (c) + frameExtentHeight (c));
-                    }
-
-                    passdata->configure_flags = CFG_FORCE_REDRAW;
-                }
-            }
-            else
-            {
-                xevent->xmotion.x_root = c->x - passdata->ox + passdata->mx;
-                xevent->xmotion.y_root = c->y - passdata->oy + passdata->my;
-            }
-        }
-
-        c->x = passdata->ox + (xevent->xmotion.x_root - passdata->mx);
-        c->y = passdata->oy + (xevent->xmotion.y_root - passdata->my);
-
-        clientSnapPosition (c, prev_x, prev_y);
-        if (clientMoveTile (c, (XMotionEvent *) xevent))
-        {
-            passdata->configure_flags = CFG_FORCE_REDRAW;
-            passdata->move_resized = TRUE;
-        }
-        else
-        {
-            clientConstrainPos(c, FALSE);
-        }
-
-#ifdef SHOW_POSITION
-        if (passdata->poswin)
-        {
-            poswinSetPosition (passdata->poswin, c);
-        }
-#endif /* SHOW_POSITION */
-        if (screen_info->params->box_move)
-        {
-            if (passdata->wireframe)
-            {
-                wireframeUpdate  (c, passdata->wireframe);
-            }
-            else
-            {
-                clientDrawOutline (c);
-            }
-        }
-        else
-        {
-            int changes = CWX | CWY;
-
-            if (passdata->move_resized)
-            {
-                wc.width = c->width;
-                wc.height = c->height;
-                changes |= CWWidth | CWHeight;
-                passdata->move_resized = FALSE;
-            }
-
-            wc.x = c->x;
-            wc.y = c->y;
-            clientConfigure (c, &wc, changes, passdata->configure_flags);
-            /* Configure applied, clear the flags */
-            passdata->configure_flags = NO_CFG_FLAG;
-        }
+        clientQueueMotion (passdata, xevent);
     }
     else if ((xevent->type == UnmapNotify) && (xevent->xunmap.window == c->window))
     {
         moving = FALSE;
+        /* Nothing to apply a motion to anymore */
+        passdata->motion_pending = FALSE;
     }
     else if (xevent->type == EnterNotify)
     {
@@ -1127,6 +1085,7 @@ clientMoveEventFilter (XEvent * xevent, gpointer data)
     if (!moving)
     {
         TRACE ("event loop now finished");
+        clientStopMotion (passdata);
         clientSaveSizePos (c);
         gtk_main_quit ();
     }
@@ -1179,6 +1138,7 @@ clientMove (Client * c, XEvent * ev)
     passdata.is_transient = clientIsValidTransientOrModal (c);
     passdata.move_resized = FALSE;
     passdata.wireframe = NULL;
+    clientInitMotion (&passdata, clientMoveMotion);
 
     clientSaveSizePos (c);
 
@@ -1242,6 +1202,8 @@ clientMove (Client * c, XEvent * ev)
     /* Clear any previously saved pos flag from screen resize */
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_SAVED_POS);
 
+    snap_edges_init (&passdata.snap, c, FALSE);
+
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering move loop");
     eventFilterPush (display_info->xfilter, clientMoveEventFilter, &passdata);
@@ -1250,6 +1212,8 @@ clientMove (Client * c, XEvent * ev)
     TRACE ("leaving move loop");
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
 
+    snap_edges_free (&passdata.snap);
+
     /* Put back the sidewalks as they ought to be */
     placeSidewalks (screen_info, screen_info->params->wrap_workspaces);
 
@@ -1364,35 +1328,24 @@ clientResizeConfigure (Client *c, int pw, int ph)
 #endif /* HAVE_XSYNC */
 }
 
-static eventFilterStatus
-clientResizeEventFilter (XEvent * xevent, gpointer data)
+static void
+clientResizeMotion (MoveResizeData *passdata, XEvent *xevent)
 {
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
     Client *c;
     GdkRectangle rect;
-    MoveResizeData *passdata;
-    eventFilterStatus status;
     int prev_width, prev_height;
     int cx, cy;
     int move_top, move_bottom, move_left, move_right;
-    gboolean resizing;
     int right_edge; /* -Cliff */
     int bottom_edge; /* -Cliff */
 
-    TRACE ("entering clientResizeEventFilter");
+    TRACE ("entering clientResizeMotion");
 
-    passdata = (MoveResizeData *) data;
     c = passdata->c;
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
-    status = EVENT_FILTER_STOP;
-
-    /*
-     * Clients may choose to end the resize operation,
-     * we use XFWM_FLAG_MOVING_RESIZING for that.
-     */
-    resizing = FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
 
     cx = frameExtentX (c) + (frameExtentWidth (c) / 2);
     cy = frameExtentY (c) + (frameExtentHeight (c) / 2);
@@ -1420,6 +1373,130 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
     prev_width = c->width;
     prev_height = c->height;
 
+    if (!passdata->grab && use_xor_resize(screen_info))
+    {
+        myDisplayGrabServer (display_info);
+        passdata->grab = TRUE;
+        clientDrawOutline (c);
+    }
+    if (use_xor_resize(screen_info))
+    {
+        clientDrawOutline (c);
+    }
+    passdata->oldw = c->width;
+    passdata->oldh = c->height;
+    right_edge = c->x + c->width;
+    bottom_edge = c->y + c->height;
+
+    if (move_left)
+    {
+        c->width = passdata->ow - (xevent->xmotion.x_root - passdata->mx);
+        c->x = c->x - (c->width - passdata->oldw);
+
+        /* Snap the left edge to something. -Cliff */
+        c->x = clientFindClosestEdgeX (c, &passdata->snap, c->x - frameExtentLeft (c)) + frameExtentLeft (c);
+        c->width = right_edge - c->x;
+    }
+    else if (move_right)
+    {
+        c->width = passdata->ow + (xevent->xmotion.x_root - passdata->mx);
+
+        /* Attempt to snap the right edge to something. -Cliff */
+        c->width = clientFindClosestEdgeX (c, &passdata->snap, c->x + c->width + frameExtentRight (c)) - c->x - frameExtentRight (c);
+
+    }
+    if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+    {
+        if (move_top)
+        {
+            c->height = passdata->oh - (xevent->xmotion.y_root - passdata->my);
+            c->y = c->y - (c->height - passdata->oldh);
+
+            /* Snap the top edge to something. -Cliff */
+            c->y = clientFindClosestEdgeY (c, &passdata->snap, c->y - frameExtentTop (c)) + frameExtentTop (c);
+            c->height = bottom_edge - c->y;
+        }
+        else if (move_bottom)
+        {
+            c->height = passdata->oh + (xevent->xmotion.y_root - passdata->my);
+
+            /* Attempt to snap the bottom edge to something. -Cliff */
+            c->height = clientFindClosestEdgeY (c, &passdata->snap, c->y + c->height + frameExtentBottom (c)) - c->y - frameExtentBottom (c);
+        }
+    }
+
+    /* Make sure the title remains visible on screen, adjust size if moved */
+    cx = c->x;
+    cy = c->y;
+    clientConstrainPos (c, FALSE);
+    c->height -= c->y - cy;
+    c->width -= c->x - cx;
+
+    /* Apply contrain ratio if any, only once the expected size is set */
+    clientConstrainRatio (c, passdata->handle);
+
+    c->width = clientCheckWidth (c, c->width, FALSE);
+    if (move_left)
+    {
+        c->x = right_edge - c->width;
+    }
+
+    c->height = clientCheckHeight (c, c->height, FALSE);
+    if (move_top && !FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
+    {
+        c->y =  bottom_edge - c->height;
+    }
+
+    if (passdata->poswin)
+    {
+        poswinSetPosition (passdata->poswin, c);
+    }
+    if (screen_info->params->box_resize)
+    {
+        if (passdata->wireframe)
+        {
+            wireframeUpdate  (c, passdata->wireframe);
+        }
+        else
+        {
+            clientDrawOutline (c);
+        }
+    }
+    else
+    {
+        clientResizeConfigure (c, prev_width, prev_height);
+    }
+}
+
+static eventFilterStatus
+clientResizeEventFilter (XEvent * xevent, gpointer data)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    Client *c;
+    MoveResizeData *passdata;
+    eventFilterStatus status;
+    int prev_width, prev_height;
+    gboolean resizing;
+
+    TRACE ("entering clientResizeEventFilter");
+
+    passdata = (MoveResizeData *) data;
+    c = passdata->c;
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+    status = EVENT_FILTER_STOP;
+
+    /*
+     * Clients may choose to end the resize operation,
+     * we use XFWM_FLAG_MOVING_RESIZING for that.
+     */
+    resizing = FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
+
+    /* Store previous values in case the resize puts the window title off bounds */
+    prev_width = c->width;
+    prev_height = c->height;
+
     /* Update the display time */
     myDisplayUpdateCurrentTime (display_info, xevent);
 
@@ -1429,6 +1506,7 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
 
         while (XCheckMaskEvent (display_info->dpy, KeyPressMask, xevent))
         {
+            eventFilterRecordEvent (display_info->xfilter, xevent);
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, xevent);
         }
@@ -1497,6 +1575,7 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
         {
             resizing = FALSE;
             passdata->released = passdata->use_keys;
+            passdata->motion_pending = FALSE;
 
             if (use_xor_resize(screen_info))
             {
@@ -1533,107 +1612,12 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
     {
         while (XCheckMaskEvent (display_info->dpy, ButtonMotionMask | PointerMotionMask, xevent))
         {
+            eventFilterRecordEvent (display_info->xfilter, xevent);
             /* Update the display time */
             myDisplayUpdateCurrentTime (display_info, xevent);
         }
 
-        if (xevent->type == ButtonRelease)
-        {
-            resizing = FALSE;
-        }
-        if (!passdata->grab && use_xor_resize(screen_info))
-        {
-            myDisplayGrabServer (display_info);
-            passdata->grab = TRUE;
-            clientDrawOutline (c);
-        }
-        if (use_xor_resize(screen_info))
-        {
-            clientDrawOutline (c);
-        }
-        passdata->oldw = c->width;
-        passdata->oldh = c->height;
-        right_edge = c->x + c->width;
-        bottom_edge = c->y + c->height;
-
-        if (move_left)
-        {
-            c->width = passdata->ow - (xevent->xmotion.x_root - passdata->mx);
-            c->x = c->x - (c->width - passdata->oldw);
-
-            /* Snap the left edge to something. -Cliff */
-            c->x = clientFindClosestEdgeX (c, c->x - frameExtentLeft (c)) + frameExtentLeft (c);
-            c->width = right_edge - c->x;
-        }
-        else if (move_right)
-        {
-            c->width = passdata->ow + (xevent->xmotion.x_root - passdata->mx);
-
-            /* Attempt to snap the right edge to something. -Cliff */
-            c->width = clientFindClosestEdgeX (c, c->x + c->width + frameExtentRight (c)) - c->x - frameExtentRight (c);
-
-        }
-        if (!FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
-        {
-            if (move_top)
-            {
-                c->height = passdata->oh - (xevent->xmotion.y_root - passdata->my);
-                c->y = c->y - (c->height - passdata->oldh);
-
-                /* Snap the top edge to something. -Cliff */
-                c->y = clientFindClosestEdgeY (c, c->y - frameExtentTop (c)) + frameExtentTop (c);
-                c->height = bottom_edge - c->y;
-            }
-            else if (move_bottom)
-            {
-                c->height = passdata->oh + (xevent->xmotion.y_root - passdata->my);
-
-                /* Attempt to snap the bottom edge to something. -Cliff */
-                c->height = clientFindClosestEdgeY (c, c->y + c->height + frameExtentBottom (c)) - c->y - frameExtentBottom (c);
-            }
-        }
-
-        /* Make sure the title remains visible on screen, adjust size if moved */
-        cx = c->x;
-        cy = c->y;
-        clientConstrainPos (c, FALSE);
-        c->height -= c->y - cy;
-        c->width -= c->x - cx;
-
-        /* Apply contrain ratio if any, only once the expected size is set */
-        clientConstrainRatio (c, passdata->handle);
-
-        c->width = clientCheckWidth (c, c->width, FALSE);
-        if (move_left)
-        {
-            c->x = right_edge - c->width;
-        }
-
-        c->height = clientCheckHeight (c, c->height, FALSE);
-        if (move_top && !FLAG_TEST (c->flags, CLIENT_FLAG_SHADED))
-        {
-            c->y =  bottom_edge - c->height;
-        }
-
-        if (passdata->poswin)
-        {
-            poswinSetPosition (passdata->poswin, c);
-        }
-        if (screen_info->params->box_resize)
-        {
-            if (passdata->wireframe)
-            {
-                wireframeUpdate  (c, passdata->wireframe);
-            }
-            else
-            {
-                clientDrawOutline (c);
-            }
-        }
-        else
-        {
-            clientResizeConfigure (c, prev_width, prev_height);
-        }
+        clientQueueMotion (passdata, xevent);
     }
     else if (xevent->type == ButtonRelease)
     {
@@ -1643,6 +1627,8 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
     else if ((xevent->type == UnmapNotify) && (xevent->xunmap.window == c->window))
     {
         resizing = FALSE;
+        /* Nothing to apply a motion to anymore */
+        passdata->motion_pending = FALSE;
     }
     else if (xevent->type == EnterNotify)
     {
@@ -1658,6 +1644,7 @@ clientResizeEventFilter (XEvent * xevent, gpointer data)
     if (!resizing)
     {
         TRACE ("event loop now finished");
+        clientStopMotion (passdata);
         gtk_main_quit ();
     }
 
@@ -1718,6 +1705,7 @@ clientResize (Client * c, int handle, XEvent * ev)
     passdata.button = 0;
     passdata.handle = handle;
     passdata.wireframe = NULL;
+    clientInitMotion (&passdata, clientResizeMotion);
     w_orig = c->width;
     h_orig = c->height;
 
@@ -1782,6 +1770,8 @@ clientResize (Client * c, int handle, XEvent * ev)
     /* Clear any previously saved pos flag from screen resize */
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_SAVED_POS);
 
+    snap_edges_init (&passdata.snap, c, TRUE);
+
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
     TRACE ("entering resize loop");
     eventFilterPush (display_info->xfilter, clientResizeEventFilter, &passdata);
@@ -1790,6 +1780,8 @@ clientResize (Client * c, int handle, XEvent * ev)
     TRACE ("leaving resize loop");
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MOVING_RESIZING);
 
+    snap_edges_free (&passdata.snap);
+
     if (passdata.poswin)
     {
         poswinDestroy (passdata.poswin);
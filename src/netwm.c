@@ -42,6 +42,8 @@
 #include "hints.h"
 #include "misc.h"
 #include "netwm.h"
+#include "placement.h"
+#include "prefetch.h"
 #include "screen.h"
 #include "stacking.h"
 #include "terminate.h"
@@ -135,6 +137,7 @@ clientSetNetState (Client * c)
         TRACE ("clientSetNetState : focused");
         data[i++] = display_info->atoms[NET_WM_STATE_FOCUSED];
     }
+    prefetchForget (display_info, c->window, display_info->atoms[NET_WM_STATE]);
     XChangeProperty (display_info->dpy, c->window,
                      display_info->atoms[NET_WM_STATE], XA_ATOM, 32,
                      PropModeReplace, (unsigned char *) data, i);
@@ -941,36 +944,133 @@ clientGetInitialNetWmDesktop (Client * c)
     }
 }
 
-void
-clientSetNetClientList (ScreenInfo * screen_info, Atom a, GList * list)
+/*
+ * Pagers and taskbars read the whole client lists back on each change,
+ * and mapping or raising a window changes them several times in a row.
+ * So the lists are only queued here, and published once the pending
+ * events are processed, appended to when windows were only added, and
+ * not written at all when they ended up unchanged.
+ */
+static void
+publish_client_list (ScreenInfo *screen_info, Atom a, GList *list, GArray *published)
 {
+    Display *dpy;
     Window *listw;
-    Window *index_dest;
     GList *index_src;
-    gint size, i;
-
-    TRACE ("entering clientSetNetClientList");
+    guint size, common, i;
 
+    dpy = myScreenGetXDisplay (screen_info);
     size = g_list_length (list);
-    if (size < 1)
+    listw = g_new (Window, size + 1);
+    for (i = 0, index_src = list; i < size; i++, index_src = g_list_next (index_src))
     {
-        XDeleteProperty (myScreenGetXDisplay (screen_info), screen_info->xroot, a);
-        return;
+        Client *c = (Client *) index_src->data;
+        listw[i] = c->window;
     }
 
-    listw = g_new (Window, size + 1);
-    if (listw)
+    for (common = 0; (common < size) && (common < published->len); common++)
     {
-        TRACE ("%i windows in list for %i clients", size, screen_info->client_count);
-        for (i = 0, index_dest = listw, index_src = list; i < size;
-            i++, index_dest++, index_src = g_list_next (index_src))
+        if (listw[common] != g_array_index (published, Window, common))
         {
-            Client *c = (Client *) index_src->data;
-            *index_dest = c->window;
+            break;
         }
-        XChangeProperty (myScreenGetXDisplay (screen_info), screen_info->xroot, a, XA_WINDOW, 32, PropModeReplace,
-            (unsigned char *) listw, size);
-        g_free (listw);
+    }
+
+    TRACE ("%u windows in list for %u clients, %u unchanged", size, screen_info->client_count, common);
+    if ((common == size) && (common == published->len))
+    {
+        screen_info->client_list_skips++;
+    }
+    else if (size == 0)
+    {
+        XDeleteProperty (dpy, screen_info->xroot, a);
+        screen_info->client_list_writes++;
+    }
+    else if ((common == published->len) && (common > 0))
+    {
+        XChangeProperty (dpy, screen_info->xroot, a, XA_WINDOW, 32, PropModeAppend,
+                         (unsigned char *) &listw[common], size - common);
+        screen_info->client_list_appends++;
+    }
+    else
+    {
+        XChangeProperty (dpy, screen_info->xroot, a, XA_WINDOW, 32, PropModeReplace,
+                         (unsigned char *) listw, size);
+        screen_info->client_list_writes++;
+    }
+
+    g_array_set_size (published, 0);
+    g_array_append_vals (published, listw, size);
+    g_free (listw);
+}
+
+static gboolean
+client_list_idle_cb (gpointer data)
+{
+    ScreenInfo *screen_info;
+
+    TRACE ("entering client_list_idle_cb");
+
+    screen_info = (ScreenInfo *) data;
+    g_return_val_if_fail (screen_info, FALSE);
+
+    screen_info->client_list_idle_id = 0;
+    clientFlushNetClientList (screen_info);
+
+    return (FALSE);
+}
+
+void
+clientQueueNetClientList (ScreenInfo *screen_info, Atom a)
+{
+    DisplayInfo *display_info;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering clientQueueNetClientList");
+
+    display_info = screen_info->display_info;
+    if (a == display_info->atoms[NET_CLIENT_LIST])
+    {
+        screen_info->client_list_pending = TRUE;
+    }
+    else if (a == display_info->atoms[NET_CLIENT_LIST_STACKING])
+    {
+        screen_info->client_list_stacking_pending = TRUE;
+    }
+
+    if (screen_info->client_list_idle_id == 0)
+    {
+        screen_info->client_list_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                                            client_list_idle_cb, screen_info, NULL);
+    }
+}
+
+void
+clientFlushNetClientList (ScreenInfo *screen_info)
+{
+    DisplayInfo *display_info;
+
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering clientFlushNetClientList");
+
+    display_info = screen_info->display_info;
+    if (screen_info->client_list_idle_id)
+    {
+        g_source_remove (screen_info->client_list_idle_id);
+        screen_info->client_list_idle_id = 0;
+    }
+
+    if (screen_info->client_list_pending)
+    {
+        publish_client_list (screen_info, display_info->atoms[NET_CLIENT_LIST],
+                             screen_info->windows, screen_info->client_list);
+        screen_info->client_list_pending = FALSE;
+    }
+    if (screen_info->client_list_stacking_pending)
+    {
+        publish_client_list (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING],
+                             screen_info->windows_stack, screen_info->client_list_stacking);
+        screen_info->client_list_stacking_pending = FALSE;
     }
 }
 
@@ -1012,6 +1112,11 @@ clientValidateNetStrut (Client * c)
        valid = FALSE;
     }
 
+    if (!valid)
+    {
+        clientInvalidateWorkArea (screen_info);
+    }
+
     return valid;
 }
 
@@ -1042,6 +1147,7 @@ clientGetNetStruts (Client * c)
     }
     FLAG_UNSET (c->flags, CLIENT_FLAG_HAS_STRUT);
     FLAG_UNSET (c->flags, CLIENT_FLAG_HAS_STRUT_PARTIAL);
+    clientInvalidateWorkArea (screen_info);
 
     if (getCardinalList (display_info, c->window, NET_WM_STRUT_PARTIAL, &struts, &nitems))
     {
@@ -1317,6 +1423,7 @@ clientWindowType (Client * c)
         c->type = UNSET;
         c->initial_layer = c->win_layer;
     }
+    clientUpdateTransientRelations (c);
 
     if (clientIsValidTransientOrModal (c))
     {
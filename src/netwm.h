@@ -46,9 +46,9 @@ void                     clientNetMoveResizeWindow              (Client *,
 void                     clientUpdateFullscreenState            (Client *);
 void                     clientGetNetWmType                     (Client *);
 void                     clientGetInitialNetWmDesktop           (Client *);
-void                     clientSetNetClientList                 (ScreenInfo *,
-                                                                 Atom,
-                                                                 GList *);
+void                     clientQueueNetClientList               (ScreenInfo *,
+                                                                 Atom);
+void                     clientFlushNetClientList               (ScreenInfo *);
 gboolean                 clientValidateNetStrut                 (Client *);
 gboolean                 clientGetNetStruts                     (Client *);
 void                     clientSetNetActions                    (Client *);
@@ -36,40 +36,12 @@
 #include "transients.h"
 #include "workspaces.h"
 #include "frame.h"
+#include "geometry.h"
 #include "netwm.h"
 
-#define MAX_VALID_STRUT(n) (n / 4) /* 25% of available space */
 #define USE_CLIENT_STRUTS(c) (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_VISIBLE) && \
                               FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
 
-/* Compute rectangle overlap area */
-
-static inline unsigned long
-segment_overlap (int x0, int x1, int tx0, int tx1)
-{
-    if (tx0 > x0)
-    {
-        x0 = tx0;
-    }
-    if (tx1 < x1)
-    {
-        x1 = tx1;
-    }
-    if (x1 <= x0)
-    {
-        return 0;
-    }
-    return (x1 - x0);
-}
-
-static inline unsigned long
-overlap (int x0, int y0, int x1, int y1, int tx0, int ty0, int tx1, int ty1)
-{
-    /* Compute overlapping box */
-    return (segment_overlap (x0, x1, tx0, tx1)
-            * segment_overlap (y0, y1, ty0, ty1));
-}
-
 static void
 set_rectangle (GdkRectangle * rect, gint x, gint y, gint width, gint height)
 {
@@ -100,78 +72,83 @@ strutsToRectangles (Client *c,
         return FALSE;
     }
 
-    if (left)
-    {
-        set_rectangle (left,
-                       0,
-                       c->struts[STRUTS_LEFT_START_Y],
-                       c->struts[STRUTS_LEFT],
-                       c->struts[STRUTS_LEFT_END_Y] - c->struts[STRUTS_LEFT_START_Y]);
-    }
+    geometryStrutsToRectangles (c->struts, screen_info->logical_width, screen_info->logical_height,
+                                left, right, top, bottom);
 
-    if (right)
-    {
-        set_rectangle (right,
-                       screen_info->logical_width - c->struts[STRUTS_RIGHT],
-                       c->struts[STRUTS_RIGHT_START_Y],
-                       c->struts[STRUTS_RIGHT],
-                       c->struts[STRUTS_RIGHT_END_Y] - c->struts[STRUTS_RIGHT_START_Y]);
-    }
+    return TRUE;
+}
 
-    if (top)
-    {
-        set_rectangle (top,
-                       c->struts[STRUTS_TOP_START_X],
-                       0,
-                       c->struts[STRUTS_TOP_END_X] - c->struts[STRUTS_TOP_START_X],
-                       c->struts[STRUTS_TOP]);
-    }
+/*
+ * Struts only change when a client sets them, shows or hides, or when the
+ * screen size changes, while the usable space is queried all the time. So
+ * the struts of the visible clients are kept in client list order, along
+ * with the work areas computed from them, until any of those change.
+ */
+
+#define WORK_AREA_CACHE_MAX 32
 
-    if (bottom)
+typedef struct _WorkArea WorkArea;
+struct _WorkArea
+{
+    GdkRectangle initial;
+    GdkRectangle area;
+};
+
+void
+clientInvalidateWorkArea (ScreenInfo *screen_info)
+{
+    g_return_if_fail (screen_info != NULL);
+    TRACE ("entering clientInvalidateWorkArea");
+
+    screen_info->struts_valid = FALSE;
+    if (screen_info->work_areas)
     {
-        set_rectangle (bottom,
-                       c->struts[STRUTS_BOTTOM_START_X],
-                       screen_info->logical_height - c->struts[STRUTS_BOTTOM],
-                       c->struts[STRUTS_BOTTOM_END_X] - c->struts[STRUTS_BOTTOM_START_X],
-                       c->struts[STRUTS_BOTTOM]);
+        g_array_set_size (screen_info->work_areas, 0);
     }
-
-    return TRUE;
 }
 
-gboolean
-checkValidStruts (GdkRectangle *struts,
-                  GdkRectangle *monitor,
-                  int side)
+GArray *
+clientGetVisibleStruts (ScreenInfo *screen_info)
 {
-    GdkRectangle intersect;
+    GeometryStruts struts;
+    Client *c;
+    guint i;
+
+    g_return_val_if_fail (screen_info != NULL, NULL);
+
+    if (screen_info->struts_valid)
+    {
+        return screen_info->struts;
+    }
 
-    if (gdk_rectangle_intersect (struts, monitor, &intersect))
+    TRACE ("collecting struts");
+    if (screen_info->struts == NULL)
+    {
+        screen_info->struts = g_array_new (FALSE, FALSE, sizeof (GeometryStruts));
+    }
+    g_array_set_size (screen_info->struts, 0);
+    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
     {
-        switch (side)
+        if (strutsToRectangles (c, &struts.left, &struts.right, &struts.top, &struts.bottom))
         {
-            case STRUTS_LEFT:
-            case STRUTS_RIGHT:
-                return (intersect.width < MAX_VALID_STRUT(monitor->width));
-                break;
-            case STRUTS_TOP:
-            case STRUTS_BOTTOM:
-                return (intersect.height < MAX_VALID_STRUT(monitor->height));
-                break;
-            default:
-                TRACE ("Unhandled strut side");
-                break;
+            struts.data = c;
+            g_array_append_val (screen_info->struts, struts);
         }
     }
-    return TRUE;
+    screen_info->struts_valid = TRUE;
+
+    return screen_info->struts;
 }
 
 void
 clientMaxSpace (ScreenInfo *screen_info, int *x, int *y, int *w, int *h)
 {
-    Client *c;
+    GArray *all_struts;
+    GeometryStruts *struts;
+    WorkArea *cached;
+    WorkArea work_area;
+    GdkRectangle area, initial, intersect;
     guint i;
-    GdkRectangle top, left, right, bottom, area, initial, intersect;
 
     g_return_if_fail (x != NULL);
     g_return_if_fail (y != NULL);
@@ -181,50 +158,71 @@ clientMaxSpace (ScreenInfo *screen_info, int *x, int *y, int *w, int *h)
     set_rectangle (&area, *x, *y, *w, *h);
     set_rectangle (&initial, *x, *y, *w, *h);
 
-    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
+    all_struts = clientGetVisibleStruts (screen_info);
+    if (screen_info->work_areas == NULL)
     {
-        if (!USE_CLIENT_STRUTS(c))
+        screen_info->work_areas = g_array_new (FALSE, FALSE, sizeof (WorkArea));
+    }
+    for (i = 0; i < screen_info->work_areas->len; i++)
+    {
+        cached = &g_array_index (screen_info->work_areas, WorkArea, i);
+        if ((cached->initial.x == initial.x) && (cached->initial.y == initial.y) &&
+            (cached->initial.width == initial.width) && (cached->initial.height == initial.height))
         {
-            continue;
+            *x = cached->area.x;
+            *y = cached->area.y;
+            *w = cached->area.width;
+            *h = cached->area.height;
+            return;
         }
+    }
 
-        if (strutsToRectangles (c, &left, &right, &top, &bottom))
+    for (i = 0; i < all_struts->len; i++)
+    {
+        struts = &g_array_index (all_struts, GeometryStruts, i);
+
+        /* Left */
+        if (geometryStrutsValid (&struts->left, &initial, STRUTS_LEFT) &&
+            gdk_rectangle_intersect (&struts->left, &area, &intersect))
         {
-            /* Left */
-            if (checkValidStruts (&left, &initial, STRUTS_LEFT) &&
-                gdk_rectangle_intersect (&left, &area, &intersect))
-            {
-                *x = *x + intersect.width;
-                *w = *w - intersect.width;
-                 set_rectangle (&area, *x, *y, *w, *h);
-            }
+            *x = *x + intersect.width;
+            *w = *w - intersect.width;
+             set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Right */
-            if (checkValidStruts (&right, &initial, STRUTS_RIGHT) &&
-                gdk_rectangle_intersect (&right, &area, &intersect))
-            {
-                *w = *w - intersect.width;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Right */
+        if (geometryStrutsValid (&struts->right, &initial, STRUTS_RIGHT) &&
+            gdk_rectangle_intersect (&struts->right, &area, &intersect))
+        {
+            *w = *w - intersect.width;
+            set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Top */
-            if (checkValidStruts (&top, &initial, STRUTS_TOP) &&
-                gdk_rectangle_intersect (&top, &area, &intersect))
-            {
-                *y = *y + intersect.height;
-                *h = *h - intersect.height;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Top */
+        if (geometryStrutsValid (&struts->top, &initial, STRUTS_TOP) &&
+            gdk_rectangle_intersect (&struts->top, &area, &intersect))
+        {
+            *y = *y + intersect.height;
+            *h = *h - intersect.height;
+            set_rectangle (&area, *x, *y, *w, *h);
+        }
 
-            /* Bottom */
-            if (checkValidStruts (&bottom, &initial, STRUTS_BOTTOM) &&
-                gdk_rectangle_intersect (&bottom, &area, &intersect))
-            {
-                *h = *h - intersect.height;
-                set_rectangle (&area, *x, *y, *w, *h);
-            }
+        /* Bottom */
+        if (geometryStrutsValid (&struts->bottom, &initial, STRUTS_BOTTOM) &&
+            gdk_rectangle_intersect (&struts->bottom, &area, &intersect))
+        {
+            *h = *h - intersect.height;
+            set_rectangle (&area, *x, *y, *w, *h);
         }
     }
+
+    if (screen_info->work_areas->len >= WORK_AREA_CACHE_MAX)
+    {
+        g_array_set_size (screen_info->work_areas, 0);
+    }
+    work_area.initial = initial;
+    work_area.area = area;
+    g_array_append_val (screen_info->work_areas, work_area);
 }
 
 /* clientConstrainPos() is used when moving windows
@@ -240,15 +238,13 @@ clientMaxSpace (ScreenInfo *screen_info, int *x, int *y, int *w, int *h)
 unsigned int
 clientConstrainPos (Client * c, gboolean show_full)
 {
-    Client *c2;
     ScreenInfo *screen_info;
-    guint i;
+    GArray *all_struts;
     gint cx, cy;
     gint frame_top, frame_left;
     gint title_visible;
-    gint screen_width, screen_height;
     guint ret;
-    GdkRectangle top, left, right, bottom, win, monitor;
+    GdkRectangle win, monitor;
     gint min_visible;
 
     g_return_val_if_fail (c != NULL, 0);
@@ -270,196 +266,23 @@ clientConstrainPos (Client * c, gboolean show_full)
         title_visible = frameDecorationTop (screen_info);
     }
     min_visible = MAX (title_visible, CLIENT_MIN_VISIBLE);
-    ret = 0;
 
     cx = win.x + (win.width / 2);
     cy = win.y + (win.height / 2);
     myScreenFindMonitorAtPoint (screen_info, cx, cy, &monitor);
 
-    screen_width = screen_info->logical_width;
-    screen_height = screen_info->logical_height;
-
     if (FLAG_TEST (c->flags, CLIENT_FLAG_FULLSCREEN))
     {
         TRACE ("ignoring constrained for client \"%s\" (0x%lx)", c->name,
             c->window);
         return 0;
     }
-    if (show_full)
-    {
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-        {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
-            {
-                continue;
-            }
-
-            /* right */
-            if (checkValidStruts (&right, &monitor, STRUTS_RIGHT) &&
-                gdk_rectangle_intersect (&right, &win, NULL))
-            {
-                c->x = screen_width - c2->struts[STRUTS_RIGHT] - win.width + frame_left;
-                win.x = frameExtentX (c);
-                ret |= CLIENT_CONSTRAINED_RIGHT;
-            }
-
-            /* Bottom */
-            if (checkValidStruts (&bottom, &monitor, STRUTS_BOTTOM) &&
-                gdk_rectangle_intersect (&bottom, &win, NULL))
-            {
-                c->y = screen_height - c2->struts[STRUTS_BOTTOM] - win.height + frame_top;
-                win.y = frameExtentY (c);
-                ret |= CLIENT_CONSTRAINED_BOTTOM;
-            }
-        }
-
-        if (win.x + win.width >= monitor.x + monitor.width)
-        {
-            c->x = monitor.x + monitor.width - win.width + frame_left;
-            win.x = frameExtentX (c);
-            ret |= CLIENT_CONSTRAINED_RIGHT;
-        }
-        if (win.x <= monitor.x)
-        {
-            c->x = monitor.x + frame_left;
-            win.x = frameExtentX (c);
-            ret |= CLIENT_CONSTRAINED_LEFT;
-        }
-        if (win.y + win.height >= monitor.y + monitor.height)
-        {
-            c->y = monitor.y + monitor.height - win.height + frame_top;
-            win.y = frameExtentY (c);
-            ret |= CLIENT_CONSTRAINED_BOTTOM;
-        }
-        if (win.y <= monitor.y)
-        {
-            c->y = monitor.y + frame_top;
-            win.y = frameExtentY (c);
-            ret |= CLIENT_CONSTRAINED_TOP;
-        }
-
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-        {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
-            {
-                continue;
-            }
-
-            /* Left */
-            if (checkValidStruts (&left, &monitor, STRUTS_LEFT) &&
-                gdk_rectangle_intersect (&left, &win, NULL))
-            {
-                c->x = c2->struts[STRUTS_LEFT] + frame_left;
-                win.x = frameExtentX (c);
-                ret |= CLIENT_CONSTRAINED_LEFT;
-            }
-
-            /* Top */
-            if (checkValidStruts (&top, &monitor, STRUTS_TOP) &&
-                gdk_rectangle_intersect (&top, &win, NULL))
-            {
-                c->y = c2->struts[STRUTS_TOP] + frame_top;
-                win.y = frameExtentY (c);
-                ret |= CLIENT_CONSTRAINED_TOP;
-            }
-        }
-    }
-    else
-    {
-        if (win.x + win.width <= monitor.x + min_visible)
-        {
-            c->x = monitor.x + min_visible - win.width + frame_left;
-            win.x = frameExtentX (c);
-            ret |= CLIENT_CONSTRAINED_LEFT;
-        }
-        if (win.x + min_visible >= monitor.x + monitor.width)
-        {
-            c->x = monitor.x + monitor.width - min_visible + frame_left;
-            win.x = frameExtentX (c);
-            ret |= CLIENT_CONSTRAINED_RIGHT;
-        }
-        if (win.y + win.height <= monitor.y + min_visible)
-        {
-            c->y = monitor.y + min_visible - win.height + frame_top;
-            win.y = frameExtentY (c);
-            ret |= CLIENT_CONSTRAINED_TOP;
-        }
-        if (win.y + min_visible >= monitor.y + monitor.height)
-        {
-            c->y = monitor.y + monitor.height - min_visible + frame_top;
-            win.y = frameExtentY (c);
-            ret |= CLIENT_CONSTRAINED_BOTTOM;
-        }
-        if ((win.y <= monitor.y) && (win.y >= monitor.y - frame_top))
-        {
-            c->y = monitor.y + frame_top;
-            win.y = frameExtentY (c);
-            ret |= CLIENT_CONSTRAINED_TOP;
-        }
-
-        /* Struts and other partial struts */
-        for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-        {
-            if ((c2 == c) || !strutsToRectangles (c2, &left, &right, &top, &bottom))
-            {
-                continue;
-            }
-
-            /* Right */
-            if (checkValidStruts (&right, &monitor, STRUTS_RIGHT) &&
-                gdk_rectangle_intersect (&right, &win, NULL))
-            {
-                if (win.x >= screen_width - c2->struts[STRUTS_RIGHT] - min_visible)
-                {
-                    c->x = screen_width - c2->struts[STRUTS_RIGHT] - min_visible + frame_left;
-                    win.x = frameExtentX (c);
-                    ret |= CLIENT_CONSTRAINED_RIGHT;
-                }
-            }
-
-            /* Left */
-            if (checkValidStruts (&left, &monitor, STRUTS_LEFT) &&
-                gdk_rectangle_intersect (&left, &win, NULL))
-            {
-                if (win.x + win.width <= c2->struts[STRUTS_LEFT] + min_visible)
-                {
-                    c->x = c2->struts[STRUTS_LEFT] + min_visible - win.width + frame_left;
-                    win.x = frameExtentX (c);
-                    ret |= CLIENT_CONSTRAINED_LEFT;
-                }
-            }
-
-            /* Bottom */
-            if (checkValidStruts (&bottom, &monitor, STRUTS_BOTTOM) &&
-                gdk_rectangle_intersect (&bottom, &win, NULL))
-            {
-                if (win.y >= screen_height - c2->struts[STRUTS_BOTTOM] - min_visible)
-                {
-                    c->y = screen_height - c2->struts[STRUTS_BOTTOM] - min_visible + frame_top;
-                    win.y = frameExtentY (c);
-                    ret |= CLIENT_CONSTRAINED_BOTTOM;
-                }
-            }
+    all_struts = clientGetVisibleStruts (screen_info);
+    ret = geometryConstrainFrame (&win, &monitor, (GeometryStruts *) all_struts->data, all_struts->len,
+                                  c, frame_top, title_visible, min_visible, show_full);
+    c->x = win.x + frame_left;
+    c->y = win.y + frame_top;
 
-            /* Top */
-            if (checkValidStruts (&top, &monitor, STRUTS_TOP) &&
-                gdk_rectangle_intersect (&top, &win, NULL))
-            {
-                if (segment_overlap (win.y, win.y + title_visible, 0, c2->struts[STRUTS_TOP]))
-                {
-                    c->y = c2->struts[STRUTS_TOP] + frame_top;
-                    win.y = frameExtentY (c);
-                    ret |= CLIENT_CONSTRAINED_TOP;
-                }
-                if (win.y + win.height <= c2->struts[STRUTS_TOP] + min_visible)
-                {
-                    c->y = c2->struts[STRUTS_TOP] + min_visible - win.height + frame_top;
-                    win.y = frameExtentY (c);
-                    ret |= CLIENT_CONSTRAINED_TOP;
-                }
-            }
-        }
-    }
     return ret;
 }
 
@@ -500,7 +323,7 @@ clientKeepVisible (Client * c, gint n_monitors, GdkRectangle *monitor_rect)
 
         while ((!centered) && (monitor_nbr < n_monitors))
         {
-            gdk_screen_get_monitor_geometry (screen_info->gscr, monitor_nbr, &rect);
+            myScreenGetMonitorGeometry (screen_info, monitor_nbr, &rect);
             diff_x = abs (c->size->x - ((rect.width - c->size->width) / 2));
             diff_y = abs (c->size->y - ((rect.height - c->size->height) / 2));
             centered = ((diff_x < 25) && (diff_y < 25));
@@ -556,9 +379,10 @@ smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
 {
     Client *c2;
     ScreenInfo *screen_info;
-    gfloat best_overlaps;
+    GArray *rects;
+    GdkRectangle rect;
     guint i;
-    gint test_x, test_y, xmax, ymax, best_x, best_y;
+    gint xmax, ymax, best_x, best_y;
     gint frame_height, frame_width, frame_left, frame_top;
     gint c2_x, c2_y;
     gint xmin, ymin;
@@ -580,154 +404,45 @@ smartPlacement (Client * c, int full_x, int full_y, int full_w, int full_h)
     xmin = full_x + frameExtentLeft (c);
     ymin = full_y + frameExtentTop (c);
 
-    /* start with worst-case position at top-left */
-    best_overlaps = G_MAXFLOAT;
-    best_x = xmin;
-    best_y = ymin;
-
     TRACE ("analyzing %i clients", screen_info->client_count);
 
-    test_y = ymin;
-    do
+    rects = g_array_sized_new (FALSE, FALSE, sizeof (GdkRectangle), screen_info->client_count);
+    for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
     {
-        gint next_test_y = G_MAXINT;
-        gboolean first_test_x = TRUE;
-
-        TRACE ("testing y position %d", test_y);
-
-        test_x = xmin;
-        do
+        if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
+            && (c->win_workspace == c2->win_workspace)
+            && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
         {
-            gfloat count_overlaps = 0.0;
-            gint next_test_x = G_MAXINT;
-            gint c2_next_test_x;
-            gint c2_next_test_y;
-            gint c2_frame_height;
-            gint c2_frame_width;
-
-            TRACE ("testing x position %d", test_x);
-
-            for (c2 = screen_info->clients, i = 0; i < screen_info->client_count; c2 = c2->next, i++)
-            {
-                if ((c2 != c) && (c2->type != WINDOW_DESKTOP)
-                    && (c->win_workspace == c2->win_workspace)
-                    && FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE))
-                {
-                    c2_x = frameExtentX (c2);
-                    c2_frame_width = frameExtentWidth (c2);
-                    if (c2_x >= full_x + full_w
-                        || c2_x + c2_frame_width < full_x)
-                    {
-                        /* skip clients on right-of or left-of monitor */
-                        continue;
-                    }
-
-                    c2_y = frameExtentY (c2);
-                    c2_frame_height = frameExtentHeight (c2);
-                    if (c2_y >= full_y + full_h
-                        || c2_y + c2_frame_height < full_y)
-                    {
-                        /* skip clients on above-of or below-of monitor */
-                        continue;
-                    }
-
-                    count_overlaps += overlap (test_x - frame_left,
-                                               test_y - frame_top,
-                                               test_x - frame_left + frame_width,
-                                               test_y - frame_top + frame_height,
-                                               c2_x,
-                                               c2_y,
-                                               c2_x + c2_frame_width,
-                                               c2_y + c2_frame_height);
-
-                    /* find the next x boundy for the step */
-                    if (test_x > c2_x)
-                    {
-                        /* test location is beyond the x of the window,
-                         * take the window right corner as next target */
-                        c2_x += c2_frame_width;
-                    }
-                    c2_next_test_x = MIN (c2_x, xmax);
-                    if (c2_next_test_x < next_test_x
-                        && c2_next_test_x > test_x)
-                    {
-                        /* set new optimal next x step position */
-                        next_test_x = c2_next_test_x;
-                    }
-
-                    if (first_test_x)
-                    {
-                        /* find the next y boundry step */
-                        if (test_y > c2_y)
-                        {
-                            /* test location is beyond the y of the window,
-                             * take the window bottom corner as next target */
-                            c2_y += c2_frame_height;
-                        }
-                        c2_next_test_y = MIN (c2_y, ymax);
-                        if (c2_next_test_y < next_test_y
-                            && c2_next_test_y > test_y)
-                        {
-                            /* set new optimal next y step position */
-                            next_test_y = c2_next_test_y;
-                        }
-                    }
-                }
-            }
-
-            /* don't look for the next y boundry this x row */
-            first_test_x = FALSE;
-
-            if (count_overlaps < best_overlaps)
+            c2_x = frameExtentX (c2);
+            rect.width = frameExtentWidth (c2);
+            if (c2_x >= full_x + full_w
+                || c2_x + rect.width < full_x)
             {
-                /* found position with less overlap */
-                best_x = test_x;
-                best_y = test_y;
-                best_overlaps = count_overlaps;
-
-                if (count_overlaps == 0.0f)
-                {
-                    /* overlap is ideal, stop searching */
-                    TRACE ("found position without overlap");
-                    goto found_best;
-                }
+                /* skip clients on right-of or left-of monitor */
+                continue;
             }
 
-            if (G_LIKELY (next_test_x != G_MAXINT))
-            {
-                test_x = MAX (next_test_x, next_test_x + frameExtentLeft (c));
-                if (test_x > xmax)
-                {
-                   /* always clamp on the monitor */
-                   test_x = xmax;
-                }
-            }
-            else
+            c2_y = frameExtentY (c2);
+            rect.height = frameExtentHeight (c2);
+            if (c2_y >= full_y + full_h
+                || c2_y + rect.height < full_y)
             {
-                test_x++;
+                /* skip clients on above-of or below-of monitor */
+                continue;
             }
-        }
-        while (test_x <= xmax);
 
-        if (G_LIKELY (next_test_y != G_MAXINT))
-        {
-            test_y = MAX (next_test_y, next_test_y + frameExtentTop (c));
-            if (test_y > ymax)
-            {
-                /* always clamp on the monitor */
-                test_y = ymax;
-            }
-        }
-        else
-        {
-            test_y++;
+            rect.x = c2_x;
+            rect.y = c2_y;
+            g_array_append_val (rects, rect);
         }
     }
-    while (test_y <= ymax);
-
-    found_best:
+    TRACE ("%u clients on the monitor", rects->len);
+    geometrySmartPlacement ((GdkRectangle *) rects->data, rects->len,
+                            xmin, ymin, xmax, ymax, frame_left, frame_top,
+                            frame_width, frame_height, &best_x, &best_y);
+    g_array_free (rects, TRUE);
 
-    TRACE ("overlaps %f at %d,%d (x,y)", best_overlaps, best_x, best_y);
+    TRACE ("placed at %d,%d (x,y)", best_x, best_y);
 
     c->x = best_x;
     c->y = best_y;
@@ -786,7 +501,7 @@ clientInitPosition (Client * c)
     }
     else
     {
-        gdk_screen_get_monitor_geometry (screen_info->gscr, 0, &rect);
+        myScreenGetMonitorGeometry (screen_info, 0, &rect);
     }
     if (position || (c->type & (WINDOW_TYPE_DONT_PLACE | WINDOW_TYPE_DIALOG)) || clientIsTransient (c))
     {
@@ -906,7 +621,7 @@ clientFill (Client * c, int fill_type)
                  * check if the neigbour client (c2) is located
                  * east or west of our client.
                  */
-                if (segment_overlap (frameExtentY(c), frameExtentY(c) + frameExtentHeight(c), frameExtentY(c2), frameExtentY(c2) + frameExtentHeight(c2)))
+                if (geometrySegmentOverlap (frameExtentY(c), frameExtentY(c) + frameExtentHeight(c), frameExtentY(c2), frameExtentY(c2) + frameExtentHeight(c2)))
                 {
                     if ((frameExtentX(c2) + frameExtentWidth(c2)) <= frameExtentX(c))
                     {
@@ -951,7 +666,7 @@ clientFill (Client * c, int fill_type)
                 /* check if the neigbour client (c2) is located
                  * north or south of our client.
                  */
-                if (segment_overlap (frameExtentX(c), frameExtentX(c) + frameExtentWidth(c), frameExtentX(c2), frameExtentX(c2) + frameExtentWidth(c2)))
+                if (geometrySegmentOverlap (frameExtentX(c), frameExtentX(c) + frameExtentWidth(c), frameExtentX(c2), frameExtentX(c2) + frameExtentWidth(c2)))
                 {
                     if ((frameExtentY(c2) + frameExtentHeight(c2)) <= frameExtentY(c))
                     {
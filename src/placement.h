@@ -29,20 +29,20 @@
 
 #include <glib.h>
 #include "client.h"
+#include "geometry.h"
 
-#define CLIENT_CONSTRAINED_TOP     1<<0
-#define CLIENT_CONSTRAINED_BOTTOM  1<<1
-#define CLIENT_CONSTRAINED_LEFT    1<<2
-#define CLIENT_CONSTRAINED_RIGHT   1<<3
+#define CLIENT_CONSTRAINED_TOP     GEOMETRY_CONSTRAINED_TOP
+#define CLIENT_CONSTRAINED_BOTTOM  GEOMETRY_CONSTRAINED_BOTTOM
+#define CLIENT_CONSTRAINED_LEFT    GEOMETRY_CONSTRAINED_LEFT
+#define CLIENT_CONSTRAINED_RIGHT   GEOMETRY_CONSTRAINED_RIGHT
 
 gboolean                 strutsToRectangles                     (Client *,
                                                                  GdkRectangle * /* left */,
                                                                  GdkRectangle * /* right */,
                                                                  GdkRectangle * /* top */,
                                                                  GdkRectangle * /* bottom */);
-gboolean                 checkValidStruts                       (GdkRectangle * /* struts */,
-                                                                 GdkRectangle * /* monitor */,
-                                                                 int);
+void                     clientInvalidateWorkArea               (ScreenInfo *);
+GArray                  *clientGetVisibleStruts                 (ScreenInfo *);
 void                     clientMaxSpace                         (ScreenInfo *,
                                                                  int *,
                                                                  int *,
@@ -0,0 +1,756 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+#ifdef HAVE_LIBXCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif /* HAVE_LIBXCB */
+
+#include "display.h"
+#include "prefetch.h"
+
+/*
+ * Framing a window reads a few dozen properties, one round trip each when
+ * done through Xlib. With XCB, all the requests for a set of windows are
+ * sent at once and the replies collected in a single wait, the getters in
+ * hints.c are then served from the values stored here.
+ *
+ * Once the window is managed, the stored values are kept as a cache which
+ * fills on demand and is invalidated by PropertyNotify, see
+ * prefetchCacheWindow () and prefetchForget ().
+ */
+
+/* In 32 bit units, large enough for most icons */
+#ifndef PREFETCH_MAX_LENGTH
+#define PREFETCH_MAX_LENGTH 0x40000
+#endif
+
+/* In bytes, icons are not worth keeping once used */
+#ifndef PREFETCH_CACHE_MAX_SIZE
+#define PREFETCH_CACHE_MAX_SIZE 4096
+#endif
+
+typedef struct _PrefetchProperty PrefetchProperty;
+struct _PrefetchProperty
+{
+    Atom atom;
+    Atom type;
+    int format;
+    unsigned long length;       /* in bytes */
+    unsigned long bytes_after;  /* not fetched */
+    guchar *value;              /* as sent by the server */
+};
+
+typedef struct _PrefetchWindow PrefetchWindow;
+struct _PrefetchWindow
+{
+    Window window;
+    guint count;
+    guint size;
+    PrefetchProperty *props;
+    gboolean fetched;
+    gboolean have_attr;
+    XWindowAttributes attr;
+    /* Set for managed windows, see prefetchCacheWindow () */
+    gboolean cached;
+    guint hits;
+    guint misses;
+};
+
+#ifdef HAVE_LIBXCB
+static const Atom prefetch_xatoms[] =
+{
+    XA_WM_CLASS,
+    XA_WM_CLIENT_MACHINE,
+    XA_WM_HINTS,
+    XA_WM_NAME,
+    XA_WM_NORMAL_HINTS,
+    XA_WM_TRANSIENT_FOR
+};
+
+static const int prefetch_atom_ids[] =
+{
+    GTK_FRAME_EXTENTS,
+    GTK_HIDE_TITLEBAR_WHEN_MAXIMIZED,
+    KWM_WIN_ICON,
+    MOTIF_WM_HINTS,
+    NET_STARTUP_ID,
+    NET_WM_DESKTOP,
+    NET_WM_ICON,
+    NET_WM_NAME,
+    NET_WM_PID,
+    NET_WM_STATE,
+    NET_WM_STRUT,
+    NET_WM_STRUT_PARTIAL,
+    NET_WM_SYNC_REQUEST_COUNTER,
+    NET_WM_USER_TIME,
+    NET_WM_USER_TIME_WINDOW,
+    NET_WM_WINDOW_OPACITY,
+    NET_WM_WINDOW_OPACITY_LOCKED,
+    NET_WM_WINDOW_TYPE,
+    SM_CLIENT_ID,
+    WM_CLIENT_LEADER,
+    WM_COLORMAP_WINDOWS,
+    WM_PROTOCOLS,
+    WM_WINDOW_ROLE
+};
+
+#define PREFETCH_COUNT (G_N_ELEMENTS (prefetch_xatoms) + G_N_ELEMENTS (prefetch_atom_ids))
+#endif /* HAVE_LIBXCB */
+
+static void
+prefetch_window_free (gpointer data)
+{
+    PrefetchWindow *pw;
+    guint i;
+
+    pw = (PrefetchWindow *) data;
+    for (i = 0; i < pw->count; i++)
+    {
+        g_free (pw->props[i].value);
+    }
+    g_free (pw->props);
+    g_free (pw);
+}
+
+static PrefetchWindow *
+prefetch_window_get (DisplayInfo *display_info, Window w)
+{
+    PrefetchWindow *pw;
+
+    if (display_info->prefetch == NULL)
+    {
+        display_info->prefetch = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                        NULL, prefetch_window_free);
+    }
+
+    pw = g_hash_table_lookup (display_info->prefetch, GUINT_TO_POINTER (w));
+    if (pw == NULL)
+    {
+        pw = g_new0 (PrefetchWindow, 1);
+        pw->window = w;
+        g_hash_table_insert (display_info->prefetch, GUINT_TO_POINTER (w), pw);
+    }
+
+    return pw;
+}
+
+static PrefetchProperty *
+prefetch_add_property (PrefetchWindow *pw, Atom atom)
+{
+    PrefetchProperty *prop;
+
+    if (pw->count == pw->size)
+    {
+        pw->size = MAX (8, 2 * pw->size);
+        pw->props = g_renew (PrefetchProperty, pw->props, pw->size);
+    }
+    prop = &pw->props[pw->count++];
+    memset (prop, 0, sizeof (PrefetchProperty));
+    prop->atom = atom;
+
+    return prop;
+}
+
+static void
+prefetch_remove_property (PrefetchWindow *pw, PrefetchProperty *prop)
+{
+    g_free (prop->value);
+    *prop = pw->props[--pw->count];
+}
+
+#ifdef HAVE_LIBXCB
+
+static Visual *
+prefetch_find_visual (Screen *screen, VisualID id)
+{
+    int i, j;
+
+    for (i = 0; i < screen->ndepths; i++)
+    {
+        for (j = 0; j < screen->depths[i].nvisuals; j++)
+        {
+            if (screen->depths[i].visuals[j].visualid == id)
+            {
+                return &screen->depths[i].visuals[j];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static Screen *
+prefetch_find_screen (Display *dpy, Window root)
+{
+    int i;
+
+    for (i = 0; i < ScreenCount (dpy); i++)
+    {
+        if (RootWindow (dpy, i) == root)
+        {
+            return ScreenOfDisplay (dpy, i);
+        }
+    }
+
+    return NULL;
+}
+#endif /* HAVE_LIBXCB */
+
+void
+prefetchWindowProperties (DisplayInfo *display_info, Window *windows, guint n_windows)
+{
+#ifdef HAVE_LIBXCB
+    xcb_connection_t *conn;
+    xcb_get_property_cookie_t *cookies;
+    xcb_get_property_reply_t *reply;
+    xcb_generic_error_t *error;
+    PrefetchWindow **pending;
+    PrefetchWindow *pw;
+    PrefetchProperty *prop;
+    Atom atoms[PREFETCH_COUNT];
+    guint i, j, k, n_pending;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering prefetchWindowProperties for %u window(s)", n_windows);
+
+    if (n_windows == 0)
+    {
+        return;
+    }
+
+    k = 0;
+    for (i = 0; i < G_N_ELEMENTS (prefetch_xatoms); i++)
+    {
+        atoms[k++] = prefetch_xatoms[i];
+    }
+    for (i = 0; i < G_N_ELEMENTS (prefetch_atom_ids); i++)
+    {
+        atoms[k++] = display_info->atoms[prefetch_atom_ids[i]];
+    }
+
+    /* Flush Xlib so that our requests are ordered after whatever it has queued */
+    XFlush (display_info->dpy);
+    conn = XGetXCBConnection (display_info->dpy);
+
+    /* Skip the windows already read, e.g. by clientFrameAll () */
+    pending = g_new (PrefetchWindow *, n_windows);
+    n_pending = 0;
+    for (i = 0; i < n_windows; i++)
+    {
+        pw = prefetch_window_get (display_info, windows[i]);
+        if (!pw->fetched)
+        {
+            pending[n_pending++] = pw;
+        }
+    }
+
+    cookies = g_new (xcb_get_property_cookie_t, n_pending * PREFETCH_COUNT);
+    for (i = 0; i < n_pending; i++)
+    {
+        for (j = 0; j < PREFETCH_COUNT; j++)
+        {
+            cookies[i * PREFETCH_COUNT + j] =
+                xcb_get_property (conn, FALSE, pending[i]->window, atoms[j],
+                                  XCB_GET_PROPERTY_TYPE_ANY, 0, PREFETCH_MAX_LENGTH);
+        }
+    }
+
+    for (i = 0; i < n_pending; i++)
+    {
+        pw = pending[i];
+        pw->fetched = TRUE;
+
+        for (j = 0; j < PREFETCH_COUNT; j++)
+        {
+            error = NULL;
+            reply = xcb_get_property_reply (conn, cookies[i * PREFETCH_COUNT + j], &error);
+            if (error)
+            {
+                /* Most likely the window is gone already, let the getters find out */
+                free (error);
+            }
+            if (!reply)
+            {
+                continue;
+            }
+
+            prop = prefetch_add_property (pw, atoms[j]);
+            prop->type = reply->type;
+            prop->format = reply->format;
+            prop->length = xcb_get_property_value_length (reply);
+            prop->bytes_after = reply->bytes_after;
+            prop->value = g_memdup (xcb_get_property_value (reply), prop->length);
+            free (reply);
+        }
+    }
+    g_free (cookies);
+    g_free (pending);
+#endif /* HAVE_LIBXCB */
+}
+
+/*
+ * Reads the attributes and geometry of many windows at once, typically
+ * all the children of the root window when adopting existing windows.
+ */
+void
+prefetchWindowAttributes (DisplayInfo *display_info, Window *windows, guint n_windows)
+{
+#ifdef HAVE_LIBXCB
+    xcb_connection_t *conn;
+    xcb_get_window_attributes_cookie_t *attr_cookies;
+    xcb_get_geometry_cookie_t *geom_cookies;
+    xcb_get_window_attributes_reply_t *attr_reply;
+    xcb_get_geometry_reply_t *geom_reply;
+    PrefetchWindow *pw;
+    XWindowAttributes *attr;
+    guint i;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering prefetchWindowAttributes for %u window(s)", n_windows);
+
+    if (n_windows == 0)
+    {
+        return;
+    }
+
+    XFlush (display_info->dpy);
+    conn = XGetXCBConnection (display_info->dpy);
+
+    attr_cookies = g_new (xcb_get_window_attributes_cookie_t, n_windows);
+    geom_cookies = g_new (xcb_get_geometry_cookie_t, n_windows);
+    for (i = 0; i < n_windows; i++)
+    {
+        attr_cookies[i] = xcb_get_window_attributes (conn, windows[i]);
+        geom_cookies[i] = xcb_get_geometry (conn, windows[i]);
+    }
+
+    for (i = 0; i < n_windows; i++)
+    {
+        /* Errors mean the window is gone, XGetWindowAttributes () will tell */
+        attr_reply = xcb_get_window_attributes_reply (conn, attr_cookies[i], NULL);
+        geom_reply = xcb_get_geometry_reply (conn, geom_cookies[i], NULL);
+
+        if ((attr_reply) && (geom_reply))
+        {
+            pw = prefetch_window_get (display_info, windows[i]);
+            attr = &pw->attr;
+
+            attr->x = geom_reply->x;
+            attr->y = geom_reply->y;
+            attr->width = geom_reply->width;
+            attr->height = geom_reply->height;
+            attr->border_width = geom_reply->border_width;
+            attr->depth = geom_reply->depth;
+            attr->root = geom_reply->root;
+            attr->screen = prefetch_find_screen (display_info->dpy, geom_reply->root);
+            attr->visual = (attr->screen) ?
+                prefetch_find_visual (attr->screen, attr_reply->visual) : NULL;
+            attr->class = attr_reply->_class;
+            attr->bit_gravity = attr_reply->bit_gravity;
+            attr->win_gravity = attr_reply->win_gravity;
+            attr->backing_store = attr_reply->backing_store;
+            attr->backing_planes = attr_reply->backing_planes;
+            attr->backing_pixel = attr_reply->backing_pixel;
+            attr->save_under = attr_reply->save_under;
+            attr->colormap = attr_reply->colormap;
+            attr->map_installed = attr_reply->map_is_installed;
+            attr->map_state = attr_reply->map_state;
+            attr->all_event_masks = attr_reply->all_event_masks;
+            attr->your_event_mask = attr_reply->your_event_mask;
+            attr->do_not_propagate_mask = attr_reply->do_not_propagate_mask;
+            attr->override_redirect = attr_reply->override_redirect;
+
+            /* Xlib would fail as well if it cannot resolve these */
+            pw->have_attr = ((attr->screen != NULL) && (attr->visual != NULL));
+        }
+
+        if (attr_reply)
+        {
+            free (attr_reply);
+        }
+        if (geom_reply)
+        {
+            free (geom_reply);
+        }
+    }
+    g_free (attr_cookies);
+    g_free (geom_cookies);
+#endif /* HAVE_LIBXCB */
+}
+
+gboolean
+prefetchGetWindowAttributes (DisplayInfo *display_info, Window w, XWindowAttributes *attr)
+{
+    PrefetchWindow *pw;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+    g_return_val_if_fail (attr != NULL, FALSE);
+
+    if (display_info->prefetch == NULL)
+    {
+        return FALSE;
+    }
+
+    pw = g_hash_table_lookup (display_info->prefetch, GUINT_TO_POINTER (w));
+    if ((pw == NULL) || !(pw->have_attr))
+    {
+        return FALSE;
+    }
+
+    *attr = pw->attr;
+    return TRUE;
+}
+
+void
+prefetchDiscard (DisplayInfo *display_info, Window w)
+{
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering prefetchDiscard");
+
+    if (display_info->prefetch)
+    {
+        g_hash_table_remove (display_info->prefetch, GUINT_TO_POINTER (w));
+    }
+}
+
+/* The property is about to change, make sure it gets read again */
+void
+prefetchForget (DisplayInfo *display_info, Window w, Atom atom)
+{
+    PrefetchWindow *pw;
+    guint i;
+
+    g_return_if_fail (display_info != NULL);
+
+    if (display_info->prefetch == NULL)
+    {
+        return;
+    }
+
+    pw = g_hash_table_lookup (display_info->prefetch, GUINT_TO_POINTER (w));
+    if (pw == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < pw->count; i++)
+    {
+        if (pw->props[i].atom == atom)
+        {
+            prefetch_remove_property (pw, &pw->props[i]);
+            return;
+        }
+    }
+}
+
+static PrefetchProperty *
+prefetch_lookup (PrefetchWindow *pw, Atom atom)
+{
+    guint i;
+
+    for (i = 0; i < pw->count; i++)
+    {
+        if (pw->props[i].atom == atom)
+        {
+            return &pw->props[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Cache miss on a managed window, read the whole property the Xlib way */
+static PrefetchProperty *
+prefetch_fill (DisplayInfo *display_info, PrefetchWindow *pw, Atom atom)
+{
+    PrefetchProperty *prop;
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after, i;
+    unsigned char *data;
+
+    data = NULL;
+    if (XGetWindowProperty (display_info->dpy, pw->window, atom, 0L, PREFETCH_MAX_LENGTH,
+                            FALSE, AnyPropertyType, &type, &format, &nitems,
+                            &bytes_after, &data) != Success)
+    {
+        return NULL;
+    }
+    if ((bytes_after) || ((type != None) && (format != 8) && (format != 16) && (format != 32)))
+    {
+        /* Not worth keeping */
+        if (data)
+        {
+            XFree (data);
+        }
+        return NULL;
+    }
+
+    prop = prefetch_add_property (pw, atom);
+    prop->type = type;
+    prop->format = format;
+    if (type != None)
+    {
+        /* Store it as sent by the server, not the way Xlib hands it */
+        prop->length = nitems * (format / 8);
+        prop->value = g_malloc (prop->length + 1);
+        for (i = 0; i < nitems; i++)
+        {
+            switch (format)
+            {
+                case 8:
+                    prop->value[i] = data[i];
+                    break;
+                case 16:
+                    ((gint16 *) prop->value)[i] = ((short *) data)[i];
+                    break;
+                default:
+                    ((gint32 *) prop->value)[i] = ((long *) data)[i];
+                    break;
+            }
+        }
+    }
+    if (data)
+    {
+        XFree (data);
+    }
+
+    return prop;
+}
+
+/*
+ * Same semantics as XGetWindowProperty () without the delete flag, the
+ * returned data must be freed with XFree (). Returns FALSE if the property
+ * was not prefetched, the caller must then ask the server.
+ */
+gboolean
+prefetchGetProperty (DisplayInfo *display_info, Window w, Atom atom,
+                     long offset, long length, Atom req_type,
+                     Atom *actual_type, int *actual_format,
+                     unsigned long *nitems, unsigned long *bytes_after,
+                     unsigned char **data)
+{
+    PrefetchWindow *pw;
+    PrefetchProperty *prop;
+    unsigned long start, avail, size, unit, i;
+    guchar *value;
+
+    g_return_val_if_fail (display_info != NULL, FALSE);
+
+    if (display_info->prefetch == NULL)
+    {
+        return FALSE;
+    }
+
+    pw = g_hash_table_lookup (display_info->prefetch, GUINT_TO_POINTER (w));
+    if (pw == NULL)
+    {
+        return FALSE;
+    }
+
+    prop = prefetch_lookup (pw, atom);
+    if (pw->cached)
+    {
+        if (prop)
+        {
+            pw->hits++;
+            display_info->prefetch_hits++;
+        }
+        else
+        {
+            pw->misses++;
+            display_info->prefetch_misses++;
+            prop = prefetch_fill (display_info, pw, atom);
+        }
+    }
+    if (prop == NULL)
+    {
+        return FALSE;
+    }
+
+    *data = NULL;
+    *nitems = 0;
+    *bytes_after = 0;
+    *actual_type = prop->type;
+    *actual_format = prop->format;
+
+    if (prop->type == None)
+    {
+        *actual_format = 0;
+        return TRUE;
+    }
+
+    if ((prop->format != 8) && (prop->format != 16) && (prop->format != 32))
+    {
+        return FALSE;
+    }
+    unit = prop->format / 8;
+
+    if ((req_type != AnyPropertyType) && (req_type != prop->type))
+    {
+        if (prop->bytes_after)
+        {
+            return FALSE;
+        }
+        *bytes_after = prop->length;
+        *data = malloc (1);
+        (*data)[0] = '\0';
+        return TRUE;
+    }
+
+    /* Offset and length are in 32 bit units, like in the protocol */
+    start = 4 * (unsigned long) offset;
+    if (start > prop->length)
+    {
+        return FALSE;
+    }
+    avail = prop->length - start;
+    if ((unsigned long) length > avail / 4)
+    {
+        if (prop->bytes_after)
+        {
+            /* Partially prefetched and the caller wants more */
+            return FALSE;
+        }
+        size = avail;
+    }
+    else
+    {
+        size = 4 * (unsigned long) length;
+    }
+
+    *nitems = size / unit;
+    *bytes_after = prop->length + prop->bytes_after - start - size;
+
+    /* Xlib hands format 16 and 32 data as arrays of short and long */
+    value = prop->value + start;
+    switch (prop->format)
+    {
+        case 8:
+            *data = malloc (*nitems + 1);
+            memcpy (*data, value, *nitems);
+            (*data)[*nitems] = '\0';
+            break;
+        case 16:
+            *data = malloc (*nitems * sizeof (short) + 1);
+            for (i = 0; i < *nitems; i++)
+            {
+                ((short *) *data)[i] = ((gint16 *) value)[i];
+            }
+            (*data)[*nitems * sizeof (short)] = '\0';
+            break;
+        default:
+            *data = malloc (*nitems * sizeof (long) + 1);
+            for (i = 0; i < *nitems; i++)
+            {
+                ((long *) *data)[i] = ((gint32 *) value)[i];
+            }
+            (*data)[*nitems * sizeof (long)] = '\0';
+            break;
+    }
+
+    if ((pw->cached) && (prop->length > PREFETCH_CACHE_MAX_SIZE))
+    {
+        prefetch_remove_property (pw, prop);
+    }
+
+    return TRUE;
+}
+
+/*
+ * The window is now managed, keep what we have and fill the rest on
+ * demand. Values stay valid until the PropertyNotify for them comes in.
+ */
+void
+prefetchCacheWindow (DisplayInfo *display_info, Window w)
+{
+    PrefetchWindow *pw;
+    guint i;
+
+    g_return_if_fail (display_info != NULL);
+    TRACE ("entering prefetchCacheWindow");
+
+    pw = prefetch_window_get (display_info, w);
+    pw->cached = TRUE;
+    pw->have_attr = FALSE;
+
+    i = 0;
+    while (i < pw->count)
+    {
+        if (pw->props[i].length > PREFETCH_CACHE_MAX_SIZE)
+        {
+            prefetch_remove_property (pw, &pw->props[i]);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void
+prefetchDump (DisplayInfo *display_info, FILE *f)
+{
+    GHashTableIter iter;
+    PrefetchWindow *pw;
+    gsize bytes;
+    guint i;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (f != NULL);
+
+    fprintf (f, "[PROPERTY_CACHE] hits=%" G_GUINT64_FORMAT " misses=%" G_GUINT64_FORMAT "\n",
+             display_info->prefetch_hits, display_info->prefetch_misses);
+    if (display_info->prefetch == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_iter_init (&iter, display_info->prefetch);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &pw))
+    {
+        bytes = 0;
+        for (i = 0; i < pw->count; i++)
+        {
+            bytes += pw->props[i].length;
+        }
+        fprintf (f, "  [WINDOW] 0x%lx%s\n", pw->window, pw->cached ? "" : " (prefetched)");
+        fprintf (f, "    [PROPERTIES] %u, %" G_GSIZE_FORMAT " bytes\n", pw->count, bytes);
+        fprintf (f, "    [LOOKUPS] hits=%u misses=%u\n", pw->hits, pw->misses);
+    }
+}
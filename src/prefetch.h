@@ -0,0 +1,68 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+
+#ifndef INC_PREFETCH_H
+#define INC_PREFETCH_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <X11/Xlib.h>
+#include <glib.h>
+
+#include "display.h"
+
+void                     prefetchWindowProperties               (DisplayInfo *,
+                                                                 Window *,
+                                                                 guint);
+void                     prefetchWindowAttributes               (DisplayInfo *,
+                                                                 Window *,
+                                                                 guint);
+gboolean                 prefetchGetWindowAttributes            (DisplayInfo *,
+                                                                 Window,
+                                                                 XWindowAttributes *);
+void                     prefetchDiscard                        (DisplayInfo *,
+                                                                 Window);
+void                     prefetchForget                         (DisplayInfo *,
+                                                                 Window,
+                                                                 Atom);
+void                     prefetchCacheWindow                    (DisplayInfo *,
+                                                                 Window);
+gboolean                 prefetchGetProperty                    (DisplayInfo *,
+                                                                 Window,
+                                                                 Atom,
+                                                                 long,
+                                                                 long,
+                                                                 Atom,
+                                                                 Atom *,
+                                                                 int *,
+                                                                 unsigned long *,
+                                                                 unsigned long *,
+                                                                 unsigned char **);
+
+void                     prefetchDump                           (DisplayInfo *,
+                                                                 FILE *);
+
+#endif /* INC_PREFETCH_H */
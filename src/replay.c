@@ -0,0 +1,667 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * xfwm4-replay plays back a recording made with "xfwm4 --record-events"
+ * against whatever window manager runs on $DISPLAY, typically a fresh
+ * xfwm4 on Xvfb:
+ *
+ *   Xvfb :9 & DISPLAY=:9 xfwm4 & DISPLAY=:9 xfwm4-replay session.rec
+ *
+ * Client windows are recreated from the requests the window manager got
+ * (map, configure, withdraw, destroy, client messages and property
+ * changes, without the actual property contents) and the input is
+ * replayed through XTest. It then reports how long the window manager
+ * took to honour the map and configure requests, and how often it wrote
+ * _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING, which pagers and
+ * taskbars re-read every time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#include <glib.h>
+
+#include "event_record.h"
+
+/* How long to wait for the window manager once the recording is over */
+#define REPLAY_DRAIN_TIMEOUT (5 * G_USEC_PER_SEC)
+
+typedef struct _ReplayLatency ReplayLatency;
+struct _ReplayLatency
+{
+    guint count;
+    gint64 total;
+    gint64 max;
+};
+
+typedef struct _ReplayRate ReplayRate;
+struct _ReplayRate
+{
+    guint count;
+    guint peak;
+    /* Counted over one second from the first write after the previous one */
+    guint second_count;
+    gint64 second_start;
+};
+
+typedef struct _Replay Replay;
+struct _Replay
+{
+    Display *dpy;
+    int screen;
+    Window root;
+    guint32 recorded_root;
+    gboolean have_xtest;
+
+    GHashTable *created;        /* recorded window -> XCreateWindowEvent */
+    GHashTable *windows;        /* recorded window -> our window */
+    GHashTable *atom_names;     /* recorded atom -> name */
+    GHashTable *map_pending;    /* our window -> request time */
+    GHashTable *configure_pending;
+
+    guint events;
+    guint requests;
+    guint inputs;
+    ReplayLatency map;
+    ReplayLatency configure;
+
+    Atom net_client_list;
+    Atom net_client_list_stacking;
+    ReplayRate client_list;
+    ReplayRate client_list_stacking;
+};
+
+static gdouble speed = 1.0;
+static gboolean fast = FALSE;
+
+static int
+ignore_errors (Display *dpy, XErrorEvent *err)
+{
+    /* Windows come and go as in the recording, some requests will fail */
+    return 0;
+}
+
+static gint64 *
+timestamp_new (void)
+{
+    gint64 *stamp;
+
+    stamp = g_new (gint64, 1);
+    *stamp = g_get_monotonic_time ();
+
+    return stamp;
+}
+
+static Window
+get_window (Replay *replay, guint32 recorded)
+{
+    if (recorded == replay->recorded_root)
+    {
+        return replay->root;
+    }
+    return (Window) GPOINTER_TO_UINT (g_hash_table_lookup (replay->windows,
+                                                           GUINT_TO_POINTER (recorded)));
+}
+
+static Window
+ensure_window (Replay *replay, guint32 recorded)
+{
+    XCreateWindowEvent *create;
+    XSetWindowAttributes attrs;
+    Window w;
+    gchar *name;
+    int x, y, width, height;
+
+    w = get_window (replay, recorded);
+    if (w != None)
+    {
+        return w;
+    }
+
+    /* Windows which existed before the recording started get a default size */
+    x = y = 100;
+    width = 400;
+    height = 300;
+    create = g_hash_table_lookup (replay->created, GUINT_TO_POINTER (recorded));
+    if (create)
+    {
+        x = create->x;
+        y = create->y;
+        width = MAX (1, create->width);
+        height = MAX (1, create->height);
+    }
+
+    attrs.event_mask = StructureNotifyMask;
+    attrs.background_pixel = WhitePixel (replay->dpy, replay->screen);
+    w = XCreateWindow (replay->dpy, replay->root, x, y, width, height, 0,
+                       CopyFromParent, InputOutput, CopyFromParent,
+                       CWEventMask | CWBackPixel, &attrs);
+
+    name = g_strdup_printf ("xfwm4-replay 0x%x", recorded);
+    XStoreName (replay->dpy, w, name);
+    g_free (name);
+
+    g_hash_table_insert (replay->windows, GUINT_TO_POINTER (recorded), GUINT_TO_POINTER (w));
+
+    return w;
+}
+
+static Atom
+get_atom (Replay *replay, long recorded)
+{
+    const gchar *name;
+
+    name = g_hash_table_lookup (replay->atom_names, GUINT_TO_POINTER ((guint32) recorded));
+    if (name == NULL)
+    {
+        /* Predefined atoms are the same everywhere */
+        return (recorded <= XA_LAST_PREDEFINED) ? (Atom) recorded : None;
+    }
+    return XInternAtom (replay->dpy, name, FALSE);
+}
+
+static void
+fake_modifiers (Replay *replay, unsigned int state, Bool press)
+{
+    static const struct
+    {
+        unsigned int mask;
+        KeySym keysym;
+    } modifiers[] =
+    {
+        { ShiftMask,   XK_Shift_L   },
+        { ControlMask, XK_Control_L },
+        { Mod1Mask,    XK_Alt_L     },
+        { Mod4Mask,    XK_Super_L   }
+    };
+    KeyCode keycode;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (modifiers); i++)
+    {
+        if (state & modifiers[i].mask)
+        {
+            keycode = XKeysymToKeycode (replay->dpy, modifiers[i].keysym);
+            if (keycode)
+            {
+                XTestFakeKeyEvent (replay->dpy, keycode, press, CurrentTime);
+            }
+        }
+    }
+}
+
+static void
+replay_input (Replay *replay, XEvent *ev)
+{
+    if (!replay->have_xtest)
+    {
+        return;
+    }
+
+    /*
+     * The window manager only sees the keys and buttons it grabs, the
+     * modifiers held at the time are only known from the state.
+     */
+    switch (ev->type)
+    {
+        case KeyPress:
+            fake_modifiers (replay, ev->xkey.state, True);
+            XTestFakeKeyEvent (replay->dpy, ev->xkey.keycode, True, CurrentTime);
+            break;
+        case KeyRelease:
+            XTestFakeKeyEvent (replay->dpy, ev->xkey.keycode, False, CurrentTime);
+            fake_modifiers (replay, ev->xkey.state, False);
+            break;
+        case ButtonPress:
+            XTestFakeMotionEvent (replay->dpy, replay->screen,
+                                  ev->xbutton.x_root, ev->xbutton.y_root, CurrentTime);
+            fake_modifiers (replay, ev->xbutton.state, True);
+            XTestFakeButtonEvent (replay->dpy, ev->xbutton.button, True, CurrentTime);
+            break;
+        case ButtonRelease:
+            XTestFakeButtonEvent (replay->dpy, ev->xbutton.button, False, CurrentTime);
+            fake_modifiers (replay, ev->xbutton.state, False);
+            break;
+        case MotionNotify:
+            XTestFakeMotionEvent (replay->dpy, replay->screen,
+                                  ev->xmotion.x_root, ev->xmotion.y_root, CurrentTime);
+            break;
+        default:
+            return;
+    }
+    replay->inputs++;
+}
+
+static void
+replay_configure (Replay *replay, XConfigureRequestEvent *ev)
+{
+    XWindowChanges wc;
+    unsigned int mask;
+    Window w;
+
+    w = get_window (replay, (guint32) ev->window);
+    if ((w == None) || (w == replay->root))
+    {
+        return;
+    }
+
+    mask = ev->value_mask;
+    wc.x = ev->x;
+    wc.y = ev->y;
+    wc.width = MAX (1, ev->width);
+    wc.height = MAX (1, ev->height);
+    wc.border_width = ev->border_width;
+    wc.stack_mode = ev->detail;
+    wc.sibling = None;
+    if (mask & CWSibling)
+    {
+        wc.sibling = get_window (replay, (guint32) ev->above);
+        if (wc.sibling == None)
+        {
+            mask &= ~(CWSibling | CWStackMode);
+        }
+    }
+
+    XConfigureWindow (replay->dpy, w, mask, &wc);
+    g_hash_table_insert (replay->configure_pending, GUINT_TO_POINTER (w),
+                         timestamp_new ());
+    replay->requests++;
+}
+
+static void
+replay_client_message (Replay *replay, XClientMessageEvent *ev)
+{
+    XEvent msg;
+    Window w;
+
+    /* Only what clients sent, not what we sent ourselves */
+    if (!ev->send_event)
+    {
+        return;
+    }
+
+    w = get_window (replay, (guint32) ev->window);
+    if (w == None)
+    {
+        return;
+    }
+
+    memcpy (&msg, ev, sizeof (XClientMessageEvent));
+    msg.xclient.display = replay->dpy;
+    msg.xclient.window = w;
+    msg.xclient.message_type = get_atom (replay, (long) ev->message_type);
+    if (msg.xclient.message_type == None)
+    {
+        return;
+    }
+    if ((msg.xclient.message_type == XInternAtom (replay->dpy, "_NET_WM_STATE", FALSE)) &&
+        (msg.xclient.format == 32))
+    {
+        msg.xclient.data.l[1] = get_atom (replay, ev->data.l[1]);
+        msg.xclient.data.l[2] = get_atom (replay, ev->data.l[2]);
+    }
+
+    XSendEvent (replay->dpy, replay->root, False,
+                SubstructureRedirectMask | SubstructureNotifyMask, &msg);
+    replay->requests++;
+}
+
+static void
+replay_event (Replay *replay, XEvent *ev)
+{
+    Window w;
+    Atom atom;
+
+    replay->events++;
+    switch (ev->type)
+    {
+        case KeyPress:
+        case KeyRelease:
+        case ButtonPress:
+        case ButtonRelease:
+        case MotionNotify:
+            replay_input (replay, ev);
+            break;
+        case CreateNotify:
+            if (((guint32) ev->xcreatewindow.parent == replay->recorded_root) &&
+                !(ev->xcreatewindow.override_redirect))
+            {
+                g_hash_table_insert (replay->created,
+                                     GUINT_TO_POINTER ((guint32) ev->xcreatewindow.window),
+                                     g_memdup (ev, sizeof (XCreateWindowEvent)));
+            }
+            break;
+        case MapRequest:
+            /* Frames are created by the window manager but never map requested */
+            w = ensure_window (replay, (guint32) ev->xmaprequest.window);
+            XMapWindow (replay->dpy, w);
+            g_hash_table_insert (replay->map_pending, GUINT_TO_POINTER (w),
+                                 timestamp_new ());
+            replay->requests++;
+            break;
+        case ConfigureRequest:
+            replay_configure (replay, &ev->xconfigurerequest);
+            break;
+        case UnmapNotify:
+            /* ICCCM withdraw, the real unmap may as well come from the window manager */
+            w = get_window (replay, (guint32) ev->xunmap.window);
+            if ((ev->xunmap.send_event) && (w != None) && (w != replay->root))
+            {
+                XWithdrawWindow (replay->dpy, w, replay->screen);
+                replay->requests++;
+            }
+            break;
+        case DestroyNotify:
+            w = get_window (replay, (guint32) ev->xdestroywindow.window);
+            if ((w != None) && (w != replay->root))
+            {
+                XDestroyWindow (replay->dpy, w);
+                g_hash_table_remove (replay->windows,
+                                     GUINT_TO_POINTER ((guint32) ev->xdestroywindow.window));
+                g_hash_table_remove (replay->map_pending, GUINT_TO_POINTER (w));
+                g_hash_table_remove (replay->configure_pending, GUINT_TO_POINTER (w));
+                replay->requests++;
+            }
+            break;
+        case PropertyNotify:
+            /* Contents are not recorded, touching the property triggers the same work */
+            w = get_window (replay, (guint32) ev->xproperty.window);
+            atom = get_atom (replay, (long) ev->xproperty.atom);
+            if ((w != None) && (w != replay->root) && (atom != None) &&
+                (ev->xproperty.state == PropertyNewValue))
+            {
+                XChangeProperty (replay->dpy, w, atom, XA_CARDINAL, 32, PropModeAppend, NULL, 0);
+                replay->requests++;
+            }
+            break;
+        case ClientMessage:
+            replay_client_message (replay, &ev->xclient);
+            break;
+        default:
+            break;
+    }
+}
+
+static void
+add_latency (ReplayLatency *latency, GHashTable *pending, Window w)
+{
+    gint64 *start;
+    gint64 elapsed;
+
+    start = g_hash_table_lookup (pending, GUINT_TO_POINTER (w));
+    if (start == NULL)
+    {
+        return;
+    }
+
+    elapsed = g_get_monotonic_time () - *start;
+    latency->count++;
+    latency->total += elapsed;
+    latency->max = MAX (latency->max, elapsed);
+    g_hash_table_remove (pending, GUINT_TO_POINTER (w));
+}
+
+static void
+add_rate (ReplayRate *rate)
+{
+    gint64 now;
+
+    now = g_get_monotonic_time ();
+    if (now - rate->second_start >= G_USEC_PER_SEC)
+    {
+        rate->second_start = now;
+        rate->second_count = 0;
+    }
+    rate->second_count++;
+    rate->count++;
+    rate->peak = MAX (rate->peak, rate->second_count);
+}
+
+/* The window manager acting on our requests */
+static void
+process_replies (Replay *replay)
+{
+    XEvent ev;
+
+    while (XPending (replay->dpy))
+    {
+        XNextEvent (replay->dpy, &ev);
+        switch (ev.type)
+        {
+            case MapNotify:
+                add_latency (&replay->map, replay->map_pending, ev.xmap.window);
+                break;
+            case ConfigureNotify:
+                add_latency (&replay->configure, replay->configure_pending,
+                             ev.xconfigure.window);
+                break;
+            case PropertyNotify:
+                if (ev.xproperty.window != replay->root)
+                {
+                    break;
+                }
+                if (ev.xproperty.atom == replay->net_client_list)
+                {
+                    add_rate (&replay->client_list);
+                }
+                else if (ev.xproperty.atom == replay->net_client_list_stacking)
+                {
+                    add_rate (&replay->client_list_stacking);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+static gboolean
+read_atom (Replay *replay, guchar *payload, guint16 size)
+{
+    guint32 atom;
+
+    if (size < sizeof (atom))
+    {
+        return FALSE;
+    }
+    memcpy (&atom, payload, sizeof (atom));
+    g_hash_table_insert (replay->atom_names, GUINT_TO_POINTER (atom),
+                         g_strndup ((gchar *) payload + sizeof (atom), size - sizeof (atom)));
+
+    return TRUE;
+}
+
+static void
+print_latency (const gchar *what, ReplayLatency *latency, guint pending)
+{
+    g_print ("  %-10s %6u  avg %8.2f ms  max %8.2f ms  (%u never honoured)\n", what,
+             latency->count,
+             latency->count ? (gdouble) latency->total / latency->count / 1000.0 : 0.0,
+             (gdouble) latency->max / 1000.0, pending);
+}
+
+static void
+print_rate (const gchar *what, ReplayRate *rate, gint64 elapsed)
+{
+    g_print ("  %-28s %6u  avg %8.2f/s  peak %6u/s\n", what, rate->count,
+             elapsed ? (gdouble) rate->count * G_USEC_PER_SEC / elapsed : 0.0, rate->peak);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    EventRecordHeader header;
+    EventRecordEntry entry;
+    Replay replay;
+    XEvent ev;
+    FILE *f;
+    guchar payload[G_MAXUINT16];
+    gint64 start, recorded, elapsed, deadline;
+    int event_base, error_base, major, minor;
+    GOptionEntry option_entries[] =
+    {
+        { "speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed, "Replay speed factor (default 1.0)", "FACTOR" },
+        { "fast", 'f', 0, G_OPTION_ARG_NONE, &fast, "Do not wait between events", NULL },
+        { NULL }
+    };
+
+    context = g_option_context_new ("RECORDING");
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    if ((argc != 2) || (speed <= 0.0))
+    {
+        g_printerr ("Usage: %s [--speed=FACTOR] [--fast] RECORDING\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!(f = fopen (argv[1], "rb")))
+    {
+        g_printerr ("Cannot open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if ((fread (&header, sizeof (header), 1, f) != 1) ||
+        (header.magic != EVENT_RECORD_MAGIC) || (header.version != EVENT_RECORD_VERSION))
+    {
+        g_printerr ("%s is not an xfwm4 event recording\n", argv[1]);
+        fclose (f);
+        return EXIT_FAILURE;
+    }
+    if (header.long_size != sizeof (long))
+    {
+        g_printerr ("%s was recorded on a different architecture\n", argv[1]);
+        fclose (f);
+        return EXIT_FAILURE;
+    }
+
+    memset (&replay, 0, sizeof (replay));
+    replay.dpy = XOpenDisplay (NULL);
+    if (replay.dpy == NULL)
+    {
+        g_printerr ("Cannot open display\n");
+        fclose (f);
+        return EXIT_FAILURE;
+    }
+    XSetErrorHandler (ignore_errors);
+    replay.screen = DefaultScreen (replay.dpy);
+    replay.root = RootWindow (replay.dpy, replay.screen);
+    replay.recorded_root = header.root;
+    replay.have_xtest = XTestQueryExtension (replay.dpy, &event_base, &error_base, &major, &minor);
+    replay.net_client_list = XInternAtom (replay.dpy, "_NET_CLIENT_LIST", FALSE);
+    replay.net_client_list_stacking = XInternAtom (replay.dpy, "_NET_CLIENT_LIST_STACKING", FALSE);
+    XSelectInput (replay.dpy, replay.root, PropertyChangeMask);
+    if (!replay.have_xtest)
+    {
+        g_printerr ("No XTest extension, input will not be replayed\n");
+    }
+
+    replay.created = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    replay.windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+    replay.atom_names = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    replay.map_pending = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    replay.configure_pending = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+    start = g_get_monotonic_time ();
+    recorded = 0;
+    while (fread (&entry, sizeof (entry), 1, f) == 1)
+    {
+        if ((entry.size) && (fread (payload, entry.size, 1, f) != 1))
+        {
+            g_printerr ("Truncated recording\n");
+            break;
+        }
+
+        /* Keep the original pace, relative to the start */
+        recorded += entry.delta;
+        if (!fast)
+        {
+            XFlush (replay.dpy);
+            elapsed = g_get_monotonic_time () - start;
+            if ((gint64) (recorded / speed) > elapsed)
+            {
+                g_usleep ((gulong) ((gint64) (recorded / speed) - elapsed));
+            }
+        }
+
+        if (entry.kind == EVENT_RECORD_ATOM)
+        {
+            read_atom (&replay, payload, entry.size);
+        }
+        else if (entry.kind == EVENT_RECORD_EVENT)
+        {
+            memset (&ev, 0, sizeof (ev));
+            memcpy (&ev, payload, MIN (entry.size, sizeof (ev)));
+            replay_event (&replay, &ev);
+        }
+        process_replies (&replay);
+    }
+    fclose (f);
+
+    /* Give the window manager some time to catch up */
+    XSync (replay.dpy, False);
+    deadline = g_get_monotonic_time () + REPLAY_DRAIN_TIMEOUT;
+    while (((g_hash_table_size (replay.map_pending)) || (g_hash_table_size (replay.configure_pending)))
+           && (g_get_monotonic_time () < deadline))
+    {
+        process_replies (&replay);
+        g_usleep (1000);
+    }
+    elapsed = g_get_monotonic_time () - start;
+
+    g_print ("Replayed %u events in %.2f s, recorded over %.2f s\n", replay.events,
+             (gdouble) elapsed / G_USEC_PER_SEC, (gdouble) recorded / G_USEC_PER_SEC);
+    g_print ("  %u requests, %u input events\n", replay.requests, replay.inputs);
+    print_latency ("map", &replay.map, g_hash_table_size (replay.map_pending));
+    print_latency ("configure", &replay.configure, g_hash_table_size (replay.configure_pending));
+    print_rate ("_NET_CLIENT_LIST", &replay.client_list, elapsed);
+    print_rate ("_NET_CLIENT_LIST_STACKING", &replay.client_list_stacking, elapsed);
+
+    g_hash_table_destroy (replay.created);
+    g_hash_table_destroy (replay.windows);
+    g_hash_table_destroy (replay.atom_names);
+    g_hash_table_destroy (replay.map_pending);
+    g_hash_table_destroy (replay.configure_pending);
+    XCloseDisplay (replay.dpy);
+
+    return EXIT_SUCCESS;
+}
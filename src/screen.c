@@ -48,6 +48,8 @@
 #include "misc.h"
 #include "mywindow.h"
 #include "compositor.h"
+#include "netwm.h"
+#include "placement.h"
 #include "ui_style.h"
 
 #ifndef WM_EXITING_TIMEOUT
@@ -104,10 +106,10 @@ myScreenSetWMAtom (ScreenInfo *screen_info, gboolean replace_wm)
 
             return FALSE;
         }
-        gdk_error_trap_push ();
+        myDisplayErrorTrapPush (display_info);
         attrs.event_mask = StructureNotifyMask;
         XChangeWindowAttributes (display_info->dpy, current_wm, CWEventMask, &attrs);
-        if (gdk_error_trap_pop ())
+        if (myDisplayErrorTrapPop (display_info))
         {
             current_wm = None;
         }
@@ -239,8 +241,28 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     screen_info->workspace_names_items = 0;
 
     screen_info->windows_stack = NULL;
+    screen_info->windows_stack_top = NULL;
+    for (i = 0; i < WIN_LAYER_COUNT; i++)
+    {
+        screen_info->stack_layers[i] = g_sequence_new (NULL);
+    }
+    screen_info->applied_stack = NULL;
+    screen_info->applied_stack_len = 0;
+    screen_info->restack_full = 0;
+    screen_info->restack_partial = 0;
+    screen_info->restack_moves = 0;
+    screen_info->client_list = g_array_new (FALSE, FALSE, sizeof (Window));
+    screen_info->client_list_stacking = g_array_new (FALSE, FALSE, sizeof (Window));
+    screen_info->client_list_pending = FALSE;
+    screen_info->client_list_stacking_pending = FALSE;
+    screen_info->client_list_idle_id = 0;
+    screen_info->client_list_writes = 0;
+    screen_info->client_list_appends = 0;
+    screen_info->client_list_skips = 0;
     screen_info->last_raise = NULL;
     screen_info->windows = NULL;
+    screen_info->transients_by_parent = g_hash_table_new (g_direct_hash, g_direct_equal);
+    screen_info->transients_by_group = g_hash_table_new (g_direct_hash, g_direct_equal);
     screen_info->clients = NULL;
     screen_info->client_count = 0;
     screen_info->client_serial = 0L;
@@ -248,6 +270,9 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
 
     screen_info->key_grabs = 0;
     screen_info->pointer_grabs = 0;
+    screen_info->struts = NULL;
+    screen_info->work_areas = NULL;
+    screen_info->struts_valid = FALSE;
 
     getHint (display_info, screen_info->xroot, NET_SHOWING_DESKTOP, &desktop_visible);
     screen_info->show_desktop = (desktop_visible != 0);
@@ -339,6 +364,7 @@ myScreenInit (DisplayInfo *display_info, GdkScreen *gscr, unsigned long event_ma
     }
 
     screen_info->monitors_index = NULL;
+    screen_info->monitors = NULL;
     myScreenInvalidateMonitorCache (screen_info);
     myScreenRebuildMonitorIndex (screen_info);
 
@@ -349,6 +375,7 @@ ScreenInfo *
 myScreenClose (ScreenInfo *screen_info)
 {
     DisplayInfo *display_info;
+    int i;
 
     g_return_val_if_fail (screen_info, NULL);
     TRACE ("entering myScreenClose");
@@ -356,6 +383,7 @@ myScreenClose (ScreenInfo *screen_info)
     display_info = screen_info->display_info;
 
     clientUnframeAll (screen_info);
+    clientFlushNetClientList (screen_info);
     compositorUnmanageScreen (screen_info);
     closeSettings (screen_info);
 
@@ -386,15 +414,50 @@ myScreenClose (ScreenInfo *screen_info)
 
     g_list_free (screen_info->windows_stack);
     screen_info->windows_stack = NULL;
+    screen_info->windows_stack_top = NULL;
+    for (i = 0; i < WIN_LAYER_COUNT; i++)
+    {
+        g_sequence_free (screen_info->stack_layers[i]);
+        screen_info->stack_layers[i] = NULL;
+    }
+    g_free (screen_info->applied_stack);
+    screen_info->applied_stack = NULL;
+    screen_info->applied_stack_len = 0;
+    g_array_free (screen_info->client_list, TRUE);
+    screen_info->client_list = NULL;
+    g_array_free (screen_info->client_list_stacking, TRUE);
+    screen_info->client_list_stacking = NULL;
 
     g_list_free (screen_info->windows);
     screen_info->windows = NULL;
 
+    if (screen_info->struts)
+    {
+        g_array_free (screen_info->struts, TRUE);
+        screen_info->struts = NULL;
+    }
+    if (screen_info->work_areas)
+    {
+        g_array_free (screen_info->work_areas, TRUE);
+        screen_info->work_areas = NULL;
+    }
+
+    /* All clients are gone by now, and so are the lists */
+    g_hash_table_destroy (screen_info->transients_by_parent);
+    screen_info->transients_by_parent = NULL;
+    g_hash_table_destroy (screen_info->transients_by_group);
+    screen_info->transients_by_group = NULL;
+
     if (screen_info->monitors_index)
     {
         g_array_free (screen_info->monitors_index, TRUE);
         screen_info->monitors_index = NULL;
     }
+    if (screen_info->monitors)
+    {
+        g_array_free (screen_info->monitors, TRUE);
+        screen_info->monitors = NULL;
+    }
 
     return (screen_info);
 }
@@ -670,6 +733,7 @@ myScreenComputeSize (ScreenInfo *screen_info)
         height = screen_info->logical_height;
     }
 
+    clientInvalidateWorkArea (screen_info);
     changed = ((screen_info->width != width) | (screen_info->height != height));
     screen_info->width = width;
     screen_info->height = height;
@@ -698,11 +762,22 @@ myScreenGetMonitorIndex (ScreenInfo *screen_info, gint idx)
     return (g_array_index (screen_info->monitors_index, gint, idx));
 }
 
+void
+myScreenGetMonitorGeometry (ScreenInfo *screen_info, gint idx, GdkRectangle *rect)
+{
+    g_return_if_fail (screen_info != NULL);
+    g_return_if_fail (screen_info->monitors != NULL);
+    g_return_if_fail (rect != NULL);
+    TRACE ("entering myScreenGetMonitorGeometry");
+
+    *rect = g_array_index (screen_info->monitors, GdkRectangle, idx);
+}
+
 gboolean
 myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
 {
     gint i, j, num_monitors, previous_num_monitors;
-    GdkRectangle monitor, previous;
+    GdkRectangle monitor, *previous;
     gboolean cloned;
 
     g_return_val_if_fail (screen_info != NULL, FALSE);
@@ -717,6 +792,13 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
     }
     screen_info->monitors_index = g_array_new (FALSE, TRUE, sizeof (guint));
 
+    /* The geometry is read once here, and all lookups use this copy */
+    if (screen_info->monitors)
+    {
+        g_array_free (screen_info->monitors, TRUE);
+    }
+    screen_info->monitors = g_array_new (FALSE, TRUE, sizeof (GdkRectangle));
+
     /* GDK already sorts monitors for us, for "cloned" monitors, sort
      * the bigger ones first (giving preference to taller monitors
      * over wider monitors)
@@ -726,10 +808,10 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
     {
         gdk_screen_get_monitor_geometry (screen_info->gscr, i, &monitor);
         cloned = FALSE;
-        for (j = 0; j < (gint) screen_info->monitors_index->len; j++)
+        for (j = 0; j < (gint) screen_info->monitors->len; j++)
         {
-            gdk_screen_get_monitor_geometry (screen_info->gscr, j, &previous);
-            if ((previous.x == monitor.x) && (previous.y == monitor.y))
+            previous = &g_array_index (screen_info->monitors, GdkRectangle, j);
+            if ((previous->x == monitor.x) && (previous->y == monitor.y))
             {
                 cloned = TRUE;
             }
@@ -738,8 +820,10 @@ myScreenRebuildMonitorIndex (ScreenInfo *screen_info)
         {
             screen_info->num_monitors++;
             g_array_append_val (screen_info->monitors_index , i);
+            g_array_append_val (screen_info->monitors, monitor);
         }
     }
+    myScreenInvalidateMonitorCache (screen_info);
 
     TRACE ("Physical monitor reported.: %i", num_monitors);
     TRACE ("Logical views found.......: %i", screen_info->num_monitors);
@@ -759,20 +843,62 @@ myScreenInvalidateMonitorCache (ScreenInfo *screen_info)
     screen_info->cache_monitor.height = 0;
 }
 
+/* Distance from a point to the closest point of a rectangle, squared */
+static gint64
+distance_to_rect (GdkRectangle *rect, gint x, gint y)
+{
+    gint64 dx, dy;
+
+    dx = 0;
+    if (x < rect->x)
+    {
+        dx = rect->x - x;
+    }
+    else if (x >= rect->x + rect->width)
+    {
+        dx = x - (rect->x + rect->width - 1);
+    }
+
+    dy = 0;
+    if (y < rect->y)
+    {
+        dy = rect->y - y;
+    }
+    else if (y >= rect->y + rect->height)
+    {
+        dy = y - (rect->y + rect->height - 1);
+    }
+
+    return (dx * dx) + (dy * dy);
+}
+
+static gint64
+distance_to_center (GdkRectangle *rect, gint x, gint y)
+{
+    gint64 dx, dy;
+
+    dx = x - (rect->x + (rect->width / 2));
+    dy = y - (rect->y + (rect->height / 2));
+
+    return (dx * dx) + (dy * dy);
+}
+
 /*
    gdk_screen_get_monitor_at_point () doesn't give accurate results
-   when the point is off screen, use my own implementation from xfce 3
+   when the point is off screen, use my own implementation from xfce 3.
+   Points off all monitors, like in the gaps of L shaped layouts, go to
+   the monitor with the closest edge, then the closest center.
  */
 void
 myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangle *rect)
 {
-    gint dx, dy, center_x, center_y, num_monitors, i;
-    guint32 distsquare, min_distsquare;
-    GdkRectangle monitor, nearest_monitor = { G_MAXINT, G_MAXINT, 0, 0 };
+    GdkRectangle *monitor, *nearest_monitor;
+    gint64 dist, min_dist, center, min_center;
+    guint i;
 
     g_return_if_fail (screen_info != NULL);
     g_return_if_fail (rect != NULL);
-    g_return_if_fail (GDK_IS_SCREEN (screen_info->gscr));
+    g_return_if_fail (screen_info->monitors != NULL);
     TRACE ("entering myScreenFindMonitorAtPoint");
 
     /* Cache system */
@@ -783,41 +909,78 @@ myScreenFindMonitorAtPoint (ScreenInfo *screen_info, gint x, gint y, GdkRectangl
         return;
     }
 
-    min_distsquare = G_MAXUINT32;
-    num_monitors = myScreenGetNumMonitors (screen_info);
+    nearest_monitor = NULL;
+    min_dist = G_MAXINT64;
+    min_center = G_MAXINT64;
 
-    for (i = 0; i < num_monitors; i++)
+    for (i = 0; i < screen_info->monitors->len; i++)
     {
-        gint monitor_index;
+        monitor = &g_array_index (screen_info->monitors, GdkRectangle, i);
 
-        monitor_index = myScreenGetMonitorIndex (screen_info, i);
-        gdk_screen_get_monitor_geometry (screen_info->gscr, monitor_index, &monitor);
-
-        if ((x >= monitor.x) && (x < (monitor.x + monitor.width)) &&
-            (y >= monitor.y) && (y < (monitor.y + monitor.height)))
+        dist = distance_to_rect (monitor, x, y);
+        if (dist == 0)
         {
-            screen_info->cache_monitor = monitor;
+            screen_info->cache_monitor = *monitor;
             *rect = screen_info->cache_monitor;
             return;
         }
 
-        center_x = monitor.x + (monitor.width / 2);
-        center_y = monitor.y + (monitor.height / 2);
+        center = distance_to_center (monitor, x, y);
+        if ((dist < min_dist) || ((dist == min_dist) && (center < min_center)))
+        {
+            min_dist = dist;
+            min_center = center;
+            nearest_monitor = monitor;
+        }
+    }
 
-        dx = x - center_x;
-        dy = y - center_y;
+    if (nearest_monitor)
+    {
+        screen_info->cache_monitor = *nearest_monitor;
+    }
+    else
+    {
+        myScreenInvalidateMonitorCache (screen_info);
+    }
+    *rect = screen_info->cache_monitor;
+}
+
+/* The monitor showing most of the given area, or the closest one */
+void
+myScreenFindMonitorForRect (ScreenInfo *screen_info, GdkRectangle *area, GdkRectangle *rect)
+{
+    GdkRectangle *monitor, intersect;
+    gint64 size, max_size;
+    guint i;
 
-        distsquare = (dx * dx) + (dy * dy);
+    g_return_if_fail (screen_info != NULL);
+    g_return_if_fail (area != NULL);
+    g_return_if_fail (rect != NULL);
+    g_return_if_fail (screen_info->monitors != NULL);
+    TRACE ("entering myScreenFindMonitorForRect");
 
-        if (distsquare < min_distsquare)
+    max_size = 0;
+    for (i = 0; i < screen_info->monitors->len; i++)
+    {
+        monitor = &g_array_index (screen_info->monitors, GdkRectangle, i);
+        if (gdk_rectangle_intersect (monitor, area, &intersect))
         {
-            min_distsquare = distsquare;
-            nearest_monitor = monitor;
+            size = (gint64) intersect.width * intersect.height;
+            if (size > max_size)
+            {
+                max_size = size;
+                *rect = *monitor;
+            }
         }
     }
 
-    screen_info->cache_monitor = nearest_monitor;
-    *rect = screen_info->cache_monitor;
+    if (max_size == 0)
+    {
+        myScreenFindMonitorAtPoint (screen_info,
+                                    area->x + area->width / 2,
+                                    area->y + area->height / 2,
+                                    rect);
+    }
 }
 
 gboolean
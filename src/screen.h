@@ -55,12 +55,51 @@
                                  SuperMask | \
                                  HyperMask)
 
+/* See compositorSetPrePaintFunc () */
+typedef void (*CompositorPrePaintFunc) (gpointer);
+
 #ifdef HAVE_COMPOSITOR
 struct _gaussian_conv {
     int     size;
     double  *data;
 };
 typedef struct _gaussian_conv gaussian_conv;
+
+#define COMPOSITOR_FRAME_RECTS   16
+#define COMPOSITOR_FRAME_HISTORY 32
+
+/* Damage bounds of a painted frame, kept for the scene dump */
+struct _CompositorFrame {
+    gint64      time;
+    gint64      paint_time;
+    XRectangle  output;
+    guint       nrects;
+    XRectangle  rects[COMPOSITOR_FRAME_RECTS];
+};
+typedef struct _CompositorFrame CompositorFrame;
+
+/* One repaint schedule per RandR CRTC, so mixed refresh rates don't throttle each other */
+struct _CompositorOutput {
+    ScreenInfo *screen_info;
+    XRectangle  area;
+    gint        refresh_rate;
+
+    XserverRegion damage;
+    guint         timeout_id;
+    gint64        deadline;
+    gint64        present_time;
+
+    /* Bounds of the pending damage, the last one absorbs the overflow */
+    guint         nrects;
+    XRectangle    rects[COMPOSITOR_FRAME_RECTS];
+
+    /* Per output statistics */
+    guint64     frames;
+    guint64     late_frames;
+    gint64      paint_time_total;
+    gint64      paint_time_max;
+};
+typedef struct _CompositorOutput CompositorOutput;
 #endif /* HAVE_COMPOSITOR */
 
 struct _ScreenInfo
@@ -70,14 +109,40 @@ struct _ScreenInfo
 
     /* Window stacking, per screen */
     GList *windows_stack;
+    GList *windows_stack_top;
+    /* Clients of each layer in stacking order, see stacking.c */
+    GSequence *stack_layers[WIN_LAYER_COUNT];
+    /* Frames in the order last sent to the server, top first */
+    Window *applied_stack;
+    guint applied_stack_len;
+    guint64 restack_full;
+    guint64 restack_partial;
+    guint64 restack_moves;
+    /* _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING as last published */
+    GArray *client_list;
+    GArray *client_list_stacking;
+    gboolean client_list_pending;
+    gboolean client_list_stacking_pending;
+    guint client_list_idle_id;
+    guint64 client_list_writes;
+    guint64 client_list_appends;
+    guint64 client_list_skips;
     Client *last_raise;
     GList *windows;
+    /* Transients by parent window and transients for group by leader */
+    GHashTable *transients_by_parent;
+    GHashTable *transients_by_group;
     Client *clients;
     guint client_count;
     unsigned long client_serial;
     gint key_grabs;
     gint pointer_grabs;
 
+    /* Struts of the visible clients and work areas, see placement.c */
+    GArray *struts;
+    GArray *work_areas;
+    gboolean struts_valid;
+
     /* Theme pixmaps and other params, per screen */
     XfwmColor title_colors[2];
     XfwmColor title_shadow_colors[2];
@@ -122,6 +187,8 @@ struct _ScreenInfo
     GdkRectangle cache_monitor;
     gint num_monitors;
     GArray *monitors_index;
+    /* Geometry of the monitors in monitors_index */
+    GArray *monitors;
 
     /* Workspace definitions */
     guint workspace_count;
@@ -174,20 +241,32 @@ struct _ScreenInfo
     Picture rootBuffer;
     Picture blackPicture;
     Picture rootTile;
-    XserverRegion allDamage;
+    GPtrArray *outputs;
+    CompositorFrame *frames;
+    guint64 frame_count;
 
     guint wins_unredirected;
+    guint64 restack_notifies;
+    guint64 restack_reorders;
     gboolean compositor_active;
     gboolean clipChanged;
 
     gboolean damages_pending;
 
-    guint compositor_timeout_id;
-
     XTransform transform;
     gboolean zoomed;
     guint zoom_timeout_id;
 
+    /* Move/resize outline painted on top of the scene, see wireframe.c */
+    gboolean outline_visible;
+    XRectangle outline;
+    guint outline_width;
+    XRenderColor outline_color;
+
+    /* Run once right before the next repaint, see compositorSetPrePaintFunc () */
+    CompositorPrePaintFunc pre_paint_func;
+    gpointer pre_paint_data;
+
 #ifdef HAVE_LIBDRM
     gint dri_fd;
     gboolean dri_secondary;
@@ -240,12 +319,18 @@ gboolean                 myScreenComputeSize                    (ScreenInfo *);
 gint                     myScreenGetNumMonitors                 (ScreenInfo *);
 gint                     myScreenGetMonitorIndex                (ScreenInfo *,
                                                                  gint);
+void                     myScreenGetMonitorGeometry             (ScreenInfo *,
+                                                                 gint,
+                                                                 GdkRectangle *);
 gboolean                 myScreenRebuildMonitorIndex            (ScreenInfo *);
 void                     myScreenInvalidateMonitorCache         (ScreenInfo *);
 void                     myScreenFindMonitorAtPoint             (ScreenInfo *,
                                                                  gint,
                                                                  gint,
                                                                  GdkRectangle *);
+void                     myScreenFindMonitorForRect             (ScreenInfo *,
+                                                                 GdkRectangle *,
+                                                                 GdkRectangle *);
 gboolean                 myScreenUpdateFontHeight               (ScreenInfo *);
 
 #endif /* INC_SCREEN_H */
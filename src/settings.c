@@ -762,6 +762,7 @@ loadSettings (ScreenInfo *screen_info)
         {"snap_to_border", NULL, G_TYPE_BOOLEAN, TRUE},
         {"snap_to_windows", NULL, G_TYPE_BOOLEAN, TRUE},
         {"snap_width", NULL, G_TYPE_INT, TRUE},
+        {"stretch_resize", NULL, G_TYPE_BOOLEAN, TRUE},
         {"sync_to_vblank", NULL, G_TYPE_BOOLEAN, TRUE},
         {"theme", NULL, G_TYPE_STRING, TRUE},
         {"tile_on_move", NULL, G_TYPE_BOOLEAN, TRUE},
@@ -874,6 +875,8 @@ loadSettings (ScreenInfo *screen_info)
         getBoolValue ("snap_resist", rc);
     screen_info->params->snap_width =
         getIntValue ("snap_width", rc);
+    screen_info->params->stretch_resize =
+        getBoolValue ("stretch_resize", rc);
     screen_info->params->sync_to_vblank =
         getBoolValue ("sync_to_vblank", rc);
     screen_info->params->tile_on_move =
@@ -1306,6 +1309,10 @@ cb_xfwm4_channel_property_changed(XfconfChannel *channel, const gchar *property_
                 {
                     screen_info->params->snap_to_windows = g_value_get_boolean (value);
                 }
+                else if (!strcmp (name, "stretch_resize"))
+                {
+                    screen_info->params->stretch_resize = g_value_get_boolean (value);
+                }
                 else if (!strcmp (name, "wrap_workspaces"))
                 {
                     screen_info->params->wrap_workspaces = g_value_get_boolean (value);
@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
+
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
@@ -39,17 +41,286 @@
 #include "transients.h"
 #include "frame.h"
 #include "focus.h"
+#include "placement.h"
 
 static guint raise_timeout = 0;
 
+/*
+ * screen_info->windows_stack lists the clients from bottom to top. Each
+ * client knows its own link in there, and a key increasing along the
+ * list so that any two clients can be ordered without walking it. The
+ * clients of each layer are also kept in a sequence sorted on that key,
+ * which tells where a layer starts and ends in the stack, even when
+ * transients placed over their parent make the layers overlap.
+ */
+
+#define STACK_KEY_GAP (G_GUINT64_CONSTANT (1) << 32)
+#define STACK_LAYER(c) (MIN ((c)->win_layer, WIN_LAYER_COUNT - 1))
+
+static gint
+compare_stack_keys (gconstpointer a, gconstpointer b, gpointer data)
+{
+    const Client *c1 = a;
+    const Client *c2 = b;
+
+    if (c1->stack_key < c2->stack_key)
+    {
+        return -1;
+    }
+    return (c1->stack_key > c2->stack_key) ? 1 : 0;
+}
+
+static void
+stack_renumber (ScreenInfo *screen_info)
+{
+    GList *list;
+    guint64 key;
+
+    TRACE ("entering stack_renumber");
+
+    key = STACK_KEY_GAP;
+    for (list = screen_info->windows_stack; list; list = g_list_next (list))
+    {
+        ((Client *) list->data)->stack_key = key;
+        key += STACK_KEY_GAP;
+    }
+}
+
+static void
+stack_set_key (ScreenInfo *screen_info, Client *c)
+{
+    GList *link;
+    guint64 below, above;
+
+    link = c->stack_link;
+    below = link->prev ? ((Client *) link->prev->data)->stack_key : 0;
+    if (link->next)
+    {
+        above = ((Client *) link->next->data)->stack_key;
+        if (above - below < 2)
+        {
+            stack_renumber (screen_info);
+            return;
+        }
+        c->stack_key = below + (above - below) / 2;
+    }
+    else if (below > G_MAXUINT64 - STACK_KEY_GAP)
+    {
+        stack_renumber (screen_info);
+    }
+    else
+    {
+        c->stack_key = below + STACK_KEY_GAP;
+    }
+}
+
+static void
+stack_unlink (ScreenInfo *screen_info, Client *c)
+{
+    GList *link;
+
+    link = c->stack_link;
+    if (link == screen_info->windows_stack_top)
+    {
+        screen_info->windows_stack_top = link->prev;
+    }
+    screen_info->windows_stack = g_list_remove_link (screen_info->windows_stack, link);
+
+    g_sequence_remove (c->layer_iter);
+    c->layer_iter = NULL;
+}
+
+/* Link the client just below the given one, or on top of the stack */
+static void
+stack_link_below (ScreenInfo *screen_info, Client *c, Client *above)
+{
+    GList *link, *next;
+
+    link = c->stack_link;
+    next = above ? above->stack_link : NULL;
+    if (next)
+    {
+        link->prev = next->prev;
+        link->next = next;
+        next->prev = link;
+    }
+    else
+    {
+        link->prev = screen_info->windows_stack_top;
+        link->next = NULL;
+        screen_info->windows_stack_top = link;
+    }
+    if (link->prev)
+    {
+        link->prev->next = link;
+    }
+    else
+    {
+        screen_info->windows_stack = link;
+    }
+
+    stack_set_key (screen_info, c);
+    c->layer_iter = g_sequence_insert_sorted (screen_info->stack_layers[STACK_LAYER (c)],
+                                              c, compare_stack_keys, NULL);
+}
+
+/* Link the client just above the given one, or at the bottom of the stack */
+static void
+stack_link_above (ScreenInfo *screen_info, Client *c, Client *below)
+{
+    GList *next;
+
+    next = below ? below->stack_link->next : screen_info->windows_stack;
+    stack_link_below (screen_info, c, next ? (Client *) next->data : NULL);
+}
+
+/* Move a client within the stack, NULL meaning on top */
+static void
+stack_move_below (ScreenInfo *screen_info, Client *c, Client *above)
+{
+    if (above == c)
+    {
+        return;
+    }
+    stack_unlink (screen_info, c);
+    stack_link_below (screen_info, c, above);
+}
+
+/* Lowest client of the given layer and above, exclude aside */
+static Client *
+stack_lowest_from_layer (ScreenInfo *screen_info, guint layer, Client *exclude)
+{
+    GSequenceIter *iter;
+    Client *lowest, *c;
+    guint l;
+
+    lowest = NULL;
+    for (l = layer; l < WIN_LAYER_COUNT; l++)
+    {
+        iter = g_sequence_get_begin_iter (screen_info->stack_layers[l]);
+        if (!g_sequence_iter_is_end (iter) && (g_sequence_get (iter) == exclude))
+        {
+            iter = g_sequence_iter_next (iter);
+        }
+        if (!g_sequence_iter_is_end (iter))
+        {
+            c = (Client *) g_sequence_get (iter);
+            if (!lowest || (c->stack_key < lowest->stack_key))
+            {
+                lowest = c;
+            }
+        }
+    }
+
+    return lowest;
+}
+
+/*
+ * Restacking the whole list costs one ConfigureWindow per frame even
+ * though a raise or a lower usually moves a single frame. As the frames
+ * are placed one below the other from the top, a lower also makes the
+ * server send a ConfigureNotify, for the compositor to process, for the
+ * frames that were below the lowered one. So keep the order last sent to
+ * the server, keep the longest run of frames that are still in the same
+ * relative order, and move only the others, each right below the frame
+ * that precedes it in the new order.
+ *
+ * The first window of the list is never moved by XRestackWindows, so
+ * it anchors both the full and the partial restack.
+ */
+
+/* Restack everything when more than this part of the list moved */
+#define STACK_DELTA_MAX(n) ((n) / 2)
+
+static guint
+stack_find_kept (Window *stack, guint nwindows, Window *applied, guint napplied, gboolean *kept)
+{
+    GHashTable *positions;
+    gint *prev;
+    guint *tails;
+    guint *order;
+    guint ntails, count;
+    guint i, lo, hi, mid;
+    gint j;
+
+    positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = 1; i < napplied; i++)
+    {
+        g_hash_table_insert (positions, GUINT_TO_POINTER (applied[i]), GUINT_TO_POINTER (i));
+    }
+
+    /* Longest increasing run of former positions, by patience sorting */
+    order = g_new0 (guint, nwindows);
+    prev = g_new (gint, nwindows);
+    tails = g_new (guint, nwindows);
+    ntails = 0;
+    for (i = 1; i < nwindows; i++)
+    {
+        order[i] = GPOINTER_TO_UINT (g_hash_table_lookup (positions, GUINT_TO_POINTER (stack[i])));
+        prev[i] = -1;
+        if (order[i] == 0)
+        {
+            continue;
+        }
+        lo = 0;
+        hi = ntails;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (order[tails[mid]] < order[i])
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        if (lo > 0)
+        {
+            prev[i] = (gint) tails[lo - 1];
+        }
+        tails[lo] = i;
+        if (lo == ntails)
+        {
+            ntails++;
+        }
+    }
+
+    count = 0;
+    for (i = 0; i < nwindows; i++)
+    {
+        kept[i] = (i == 0);
+    }
+    for (j = ntails ? (gint) tails[ntails - 1] : -1; j >= 0; j = prev[j])
+    {
+        kept[j] = TRUE;
+        count++;
+    }
+
+    g_free (tails);
+    g_free (prev);
+    g_free (order);
+    g_hash_table_destroy (positions);
+
+    /* Number of windows to move */
+    return nwindows - 1 - count;
+}
+
 void
 clientApplyStackList (ScreenInfo *screen_info)
 {
+    DisplayInfo *display_info;
     Window *xwinstack;
+    XWindowChanges wc;
+    gboolean *kept;
     guint nwindows;
+    guint moves;
+    guint n;
     gint i;
 
     DBG ("applying stack list");
+    display_info = screen_info->display_info;
     nwindows = g_list_length (screen_info->windows_stack);
 
     i = 0;
@@ -64,17 +335,76 @@ clientApplyStackList (ScreenInfo *screen_info)
         GList *list;
         Client *c = NULL;
 
-        for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+        for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
         {
             c = (Client *) list->data;
             xwinstack[i++] = c->frame;
             DBG ("  [%i] \"%s\" (0x%lx)", i, c->name, c->window);
         }
     }
+    n = nwindows + 4;
 
-    XRestackWindows (myScreenGetXDisplay (screen_info), xwinstack, (int) nwindows + 4);
+    if ((screen_info->applied_stack == NULL) || (screen_info->applied_stack[0] != xwinstack[0]))
+    {
+        moves = n;
+        kept = NULL;
+    }
+    else
+    {
+        kept = g_new (gboolean, n);
+        moves = stack_find_kept (xwinstack, n, screen_info->applied_stack,
+                                 screen_info->applied_stack_len, kept);
+    }
 
-    g_free (xwinstack);
+    if (moves > STACK_DELTA_MAX (n))
+    {
+        XRestackWindows (display_info->dpy, xwinstack, (int) n);
+        screen_info->restack_full++;
+        screen_info->restack_moves += n - 1;
+    }
+    else if (moves > 0)
+    {
+        wc.stack_mode = Below;
+        for (i = 1; i < (gint) n; i++)
+        {
+            if (!kept[i])
+            {
+                DBG ("moving 0x%lx below 0x%lx", xwinstack[i], xwinstack[i - 1]);
+                wc.sibling = xwinstack[i - 1];
+                XConfigureWindow (display_info->dpy, xwinstack[i], CWSibling | CWStackMode, &wc);
+            }
+        }
+        screen_info->restack_partial++;
+        screen_info->restack_moves += moves;
+    }
+
+    g_free (kept);
+    g_free (screen_info->applied_stack);
+    screen_info->applied_stack = xwinstack;
+    screen_info->applied_stack_len = n;
+}
+
+void
+clientDumpStacking (DisplayInfo *display_info, FILE *f)
+{
+    ScreenInfo *screen_info;
+    GSList *screens;
+
+    g_return_if_fail (display_info != NULL);
+    g_return_if_fail (f != NULL);
+    TRACE ("entering clientDumpStacking");
+
+    for (screens = display_info->screens; screens; screens = g_slist_next (screens))
+    {
+        screen_info = (ScreenInfo *) screens->data;
+        fprintf (f, "[STACKING] screen %i\n", screen_info->screen);
+        fprintf (f, "  [FULL_RESTACKS] %" G_GUINT64_FORMAT "\n", screen_info->restack_full);
+        fprintf (f, "  [PARTIAL_RESTACKS] %" G_GUINT64_FORMAT "\n", screen_info->restack_partial);
+        fprintf (f, "  [WINDOWS_MOVED] %" G_GUINT64_FORMAT "\n", screen_info->restack_moves);
+        fprintf (f, "  [CLIENT_LIST] %" G_GUINT64_FORMAT " written, %" G_GUINT64_FORMAT " appended, %"
+                 G_GUINT64_FORMAT " unchanged\n", screen_info->client_list_writes,
+                 screen_info->client_list_appends, screen_info->client_list_skips);
+    }
 }
 
 Client *
@@ -161,88 +491,57 @@ clientGetTopMostForGroup (Client * c)
 gboolean
 clientIsTopMost (Client *c)
 {
-    ScreenInfo *screen_info;
-    GList *list, *list2;
+    GSequenceIter *iter;
     Client *c2;
 
     g_return_val_if_fail (c != NULL, FALSE);
     TRACE ("entering clientIsTopMost");
 
-    screen_info = c->screen_info;
-
-    list = g_list_find (screen_info->windows_stack, (gconstpointer) c);
-    if (list)
+    if (c->layer_iter)
     {
-        list2 = g_list_next (list);
-        while (list2)
+        for (iter = g_sequence_iter_next (c->layer_iter); !g_sequence_iter_is_end (iter);
+             iter = g_sequence_iter_next (iter))
         {
-            c2 = (Client *) list2->data;
+            c2 = (Client *) g_sequence_get (iter);
             if (FLAG_TEST (c2->xfwm_flags, XFWM_FLAG_VISIBLE) && (c2->win_layer == c->win_layer))
             {
                 return FALSE;
             }
-            list2 = g_list_next (list2);
         }
     }
     return TRUE;
 }
 
+/* Lowest client in the stack above the given layer */
 Client *
 clientGetNextTopMost (ScreenInfo *screen_info, guint layer, Client * exclude)
 {
-    Client *top, *c;
-    GList *list;
-
     TRACE ("entering clientGetNextTopMost");
 
-    top = NULL;
-    for (list = screen_info->windows_stack; list; list = g_list_next (list))
+    if (layer >= WIN_LAYER_COUNT - 1)
     {
-        c = (Client *) list->data;
-        TRACE ("*** stack window \"%s\" (0x%lx), layer %i", c->name, c->window, (int) c->win_layer);
-        if (!exclude || (c != exclude))
-        {
-            if (c->win_layer > layer)
-            {
-                top = c;
-                break;
-            }
-        }
+        return NULL;
     }
-
-    return top;
+    return stack_lowest_from_layer (screen_info, layer + 1, exclude);
 }
 
+/* Client just below the lowest one of the given layer and above */
 Client *
 clientGetBottomMost (ScreenInfo *screen_info, guint layer, Client * exclude)
 {
-    Client *bot, *c;
+    Client *c;
     GList *list;
 
     TRACE ("entering clientGetBottomMost");
 
-    bot = NULL;
-    for (list = screen_info->windows_stack; list; list = g_list_next (list))
+    c = stack_lowest_from_layer (screen_info, layer, exclude);
+    list = c ? g_list_previous (c->stack_link) : screen_info->windows_stack_top;
+    if (list && (list->data == exclude))
     {
-        c = (Client *) list->data;
-        if (c)
-        {
-            TRACE ("*** stack window \"%s\" (0x%lx), layer %i", c->name,
-                c->window, (int) c->win_layer);
-            if (!exclude || (c != exclude))
-            {
-                if (c->win_layer < layer)
-                {
-                    bot = c;
-                }
-                else if (c->win_layer >= layer)
-                {
-                    break;
-                }
-            }
-        }
+        list = g_list_previous (list);
     }
-    return bot;
+
+    return list ? (Client *) list->data : NULL;
 }
 
 /*
@@ -258,7 +557,7 @@ clientAtPosition (ScreenInfo *screen_info, int x, int y, GList * exclude_list)
     TRACE ("entering clientAtPosition");
 
     c = NULL;
-    for (list = g_list_last (screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
     {
         c2 = (Client *) list->data;
         if ((frameX (c2) <= x) && (frameX (c2) + frameWidth (c2) >= x)
@@ -283,9 +582,8 @@ clientRaise (Client * c, Window wsibling)
     DisplayInfo *display_info;
     Client *c2, *c3, *client_sibling;
     GList *transients;
-    GList *sibling;
+    GList *raised;
     GList *list1, *list2;
-    GList *windows_stack_copy;
 
     g_return_if_fail (c != NULL);
 
@@ -295,7 +593,7 @@ clientRaise (Client * c, Window wsibling)
     display_info = screen_info->display_info;
     client_sibling = NULL;
     transients = NULL;
-    sibling = NULL;
+    raised = NULL;
 
     if (c == screen_info->last_raise)
     {
@@ -315,33 +613,29 @@ clientRaise (Client * c, Window wsibling)
      * by clicking inside.
      */
 
-    if (g_list_length (screen_info->windows_stack) < 1)
+    if (!screen_info->windows_stack)
     {
         return;
     }
 
     if (FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
     {
-        /* Copy the existing window stack temporarily as reference */
-        windows_stack_copy = g_list_copy (screen_info->windows_stack);
+        /* Transients in their current stacking order, as reference */
+        transients = clientListTransientOrModal (c);
         /* Search for the window that will be just on top of the raised window  */
         if (wsibling)
         {
             c2 = myDisplayGetClientFromWindow (display_info, wsibling, SEARCH_FRAME | SEARCH_WINDOW);
-            if (c2)
+            if ((c2) && (c2->stack_link))
             {
-                sibling = g_list_find (screen_info->windows_stack, (gconstpointer) c2);
-                if (sibling)
+                list1 = g_list_next (c2->stack_link);
+                if (list1)
                 {
-                    list1 = g_list_next (sibling);
-                    if (list1)
+                    client_sibling = (Client *) list1->data;
+                    /* Do not place window under higher layers though */
+                    if ((client_sibling) && (client_sibling->win_layer < c->win_layer))
                     {
-                        client_sibling = (Client *) list1->data;
-                        /* Do not place window under higher layers though */
-                        if ((client_sibling) && (client_sibling->win_layer < c->win_layer))
-                        {
-                            client_sibling = NULL;
-                        }
+                        client_sibling = NULL;
                     }
                 }
             }
@@ -350,88 +644,50 @@ clientRaise (Client * c, Window wsibling)
         {
             client_sibling = clientGetNextTopMost (screen_info, c->win_layer, c);
         }
-        screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c);
-        if (client_sibling)
-        {
-            /* If there is one, look for its place in the list */
-            sibling = g_list_find (screen_info->windows_stack, (gconstpointer) client_sibling);
-            /* Place the raised window just before it */
-            screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c);
-        }
-        else
+        if (client_sibling == c)
         {
-            /* There will be no window on top of the raised window, so place it at the end of list */
-            screen_info->windows_stack = g_list_append (screen_info->windows_stack, c);
+            /* Already in place */
+            list1 = g_list_next (c->stack_link);
+            client_sibling = list1 ? (Client *) list1->data : NULL;
         }
+        /* Place the raised window just below the sibling, or on top if there is none */
+        stack_move_below (screen_info, c, client_sibling);
+
         /* Now, look for transients, transients of transients, etc. */
-        for (list1 = windows_stack_copy; list1; list1 = g_list_next (list1))
+        for (list1 = g_list_next (transients); list1; list1 = g_list_next (list1))
         {
             c2 = (Client *) list1->data;
-            if (c2)
+            if ((clientIsTransientOrModalFor (c2, c)) && (c2->win_layer <= c->win_layer))
+            {
+                raised = g_list_append (raised, c2);
+            }
+            else
             {
-                if ((c2 != c) && clientIsTransientOrModalFor (c2, c) && (c2->win_layer <= c->win_layer))
+                for (list2 = raised; list2; list2 = g_list_next (list2))
                 {
-                    transients = g_list_append (transients, c2);
-                    if (sibling)
-                    {
-                        /* Make sure client_sibling is not c2 otherwise we create a circular linked list */
-                        if (client_sibling != c2)
-                        {
-                            /* Place the transient window just before sibling */
-                            screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                            screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c2);
-                        }
-                    }
-                    else
+                    c3 = (Client *) list2->data;
+                    if ((c3 != c2) && clientIsTransientOrModalFor (c2, c3))
                     {
-                        /* There will be no window on top of the transient window, so place it at the end of list */
-                        screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                        screen_info->windows_stack = g_list_append (screen_info->windows_stack, c2);
+                        raised = g_list_append (raised, c2);
+                        break;
                     }
                 }
-                else
+                if (!list2)
                 {
-                    for (list2 = transients; list2; list2 = g_list_next (list2))
-                    {
-                        c3 = (Client *) list2->data;
-                        if ((c3 != c2) && clientIsTransientOrModalFor (c2, c3))
-                        {
-                            transients = g_list_append (transients, c2);
-                            if (sibling)
-                            {
-                                /* Again, make sure client_sibling is not c2 to avoid a circular linked list */
-                                if (client_sibling != c2)
-                                {
-                                    /* Place the transient window just before sibling */
-                                    screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                                    screen_info->windows_stack = g_list_insert_before (screen_info->windows_stack, sibling, c2);
-                                }
-                            }
-                            else
-                            {
-                                /* There will be no window on top of the transient window, so place it at the end of list */
-                                screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c2);
-                                screen_info->windows_stack = g_list_append (screen_info->windows_stack, c2);
-                            }
-                            break;
-                        }
-                    }
+                    continue;
                 }
             }
+            /* Place the transient window just below sibling as well */
+            stack_move_below (screen_info, c2, client_sibling);
         }
-        if (transients)
-        {
-            g_list_free (transients);
-        }
-        if (windows_stack_copy)
-        {
-            g_list_free (windows_stack_copy);
-        }
+        g_list_free (raised);
+        g_list_free (transients);
+
         /* Now, screen_info->windows_stack contains the correct window stack
            We still need to tell the X Server to reflect the changes
          */
         clientApplyStackList (screen_info);
-        clientSetNetClientList (c->screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+        clientQueueNetClientList (c->screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
         screen_info->last_raise = c;
     }
 }
@@ -442,9 +698,7 @@ clientLower (Client * c, Window wsibling)
     ScreenInfo *screen_info;
     DisplayInfo *display_info;
     Client *c2, *client_sibling;
-    GList *sibling;
     GList *list;
-    gint position;
 
     g_return_if_fail (c != NULL);
 
@@ -454,10 +708,9 @@ clientLower (Client * c, Window wsibling)
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
     client_sibling = NULL;
-    sibling = NULL;
     c2 = NULL;
 
-    if (g_list_length (screen_info->windows_stack) < 1)
+    if (!screen_info->windows_stack)
     {
         return;
     }
@@ -475,20 +728,16 @@ clientLower (Client * c, Window wsibling)
         else if (wsibling)
         {
             c2 = myDisplayGetClientFromWindow (display_info, wsibling, SEARCH_FRAME | SEARCH_WINDOW);
-            if (c2)
+            if ((c2) && (c2->stack_link))
             {
-                sibling = g_list_find (screen_info->windows_stack, (gconstpointer) c2);
-                if (sibling)
+                list = g_list_previous (c2->stack_link);
+                if (list)
                 {
-                    list = g_list_previous (sibling);
-                    if (list)
+                    client_sibling = (Client *) list->data;
+                    /* Do not place window above lower layers though */
+                    if ((client_sibling) && (client_sibling->win_layer > c->win_layer))
                     {
-                        client_sibling = (Client *) list->data;
-                        /* Do not place window above lower layers though */
-                        if ((client_sibling) && (client_sibling->win_layer > c->win_layer))
-                        {
-                            client_sibling = NULL;
-                        }
+                        client_sibling = NULL;
                     }
                 }
             }
@@ -498,29 +747,17 @@ clientLower (Client * c, Window wsibling)
         {
             client_sibling = clientGetBottomMost (screen_info, c->win_layer, c);
         }
-        if (client_sibling != c)
+        if ((client_sibling != c) && (!client_sibling || client_sibling->stack_link))
         {
-            screen_info->windows_stack = g_list_remove (screen_info->windows_stack, (gconstpointer) c);
-            /* Paranoid check to avoid circular linked list */
-            if (client_sibling)
-            {
-                sibling = g_list_find (screen_info->windows_stack, (gconstpointer) client_sibling);
-                position = g_list_position (screen_info->windows_stack, sibling) + 1;
-
-                screen_info->windows_stack = g_list_insert (screen_info->windows_stack, c, position);
-                TRACE ("lowest client is \"%s\" (0x%lx) at position %i",
-                        client_sibling->name, client_sibling->window, position);
-            }
-            else
-            {
-                screen_info->windows_stack = g_list_prepend (screen_info->windows_stack, c);
-            }
+            /* Place the window just above the sibling, or at the bottom if there is none */
+            stack_unlink (screen_info, c);
+            stack_link_above (screen_info, c, client_sibling);
         }
         /* Now, screen_info->windows_stack contains the correct window stack
            We still need to tell the X Server to reflect the changes
          */
         clientApplyStackList (screen_info);
-        clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+        clientQueueNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
         clientPassFocus (screen_info, c, NULL);
         if (screen_info->last_raise == c)
         {
@@ -587,11 +824,14 @@ clientAddToList (Client * c)
 
     TRACE ("adding window \"%s\" (0x%lx) to windows list", c->name, c->window);
     screen_info->windows = g_list_append (screen_info->windows, c);
-    screen_info->windows_stack = g_list_append (screen_info->windows_stack, c);
+    c->stack_link = g_list_alloc ();
+    c->stack_link->data = c;
+    stack_link_below (screen_info, c, NULL);
 
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
+    clientQueueNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST]);
 
     FLAG_SET (c->xfwm_flags, XFWM_FLAG_MANAGED);
+    clientUpdateTransientRelations (c);
 }
 
 void
@@ -604,6 +844,7 @@ clientRemoveFromList (Client * c)
     TRACE ("entering clientRemoveFromList");
 
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MANAGED);
+    clientUpdateTransientRelations (c);
 
     screen_info = c->screen_info;
     display_info = screen_info->display_info;
@@ -627,16 +868,44 @@ clientRemoveFromList (Client * c)
 
     TRACE ("removing window \"%s\" (0x%lx) from windows list", c->name, c->window);
     screen_info->windows = g_list_remove (screen_info->windows, c);
+    if (FLAG_TEST (c->flags, CLIENT_FLAG_HAS_STRUT))
+    {
+        clientInvalidateWorkArea (screen_info);
+    }
 
     TRACE ("removing window \"%s\" (0x%lx) from screen_info->windows_stack list", c->name, c->window);
-    screen_info->windows_stack = g_list_remove (screen_info->windows_stack, c);
+    stack_unlink (screen_info, c);
+    g_list_free_1 (c->stack_link);
+    c->stack_link = NULL;
 
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST], screen_info->windows);
-    clientSetNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING], screen_info->windows_stack);
+    clientQueueNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST]);
+    clientQueueNetClientList (screen_info, display_info->atoms[NET_CLIENT_LIST_STACKING]);
 
     FLAG_UNSET (c->xfwm_flags, XFWM_FLAG_MANAGED);
 }
 
+/* Layers are indexed, so they must be changed through here */
+void
+clientSetStackingLayer (Client *c, guint layer)
+{
+    ScreenInfo *screen_info;
+
+    g_return_if_fail (c != NULL);
+
+    screen_info = c->screen_info;
+    if (c->layer_iter)
+    {
+        g_sequence_remove (c->layer_iter);
+        c->win_layer = layer;
+        c->layer_iter = g_sequence_insert_sorted (screen_info->stack_layers[STACK_LAYER (c)],
+                                                  c, compare_stack_keys, NULL);
+    }
+    else
+    {
+        c->win_layer = layer;
+    }
+}
+
 GList *
 clientGetStackList (ScreenInfo *screen_info)
 {
@@ -27,6 +27,7 @@
 #include "config.h"
 #endif
 
+#include <stdio.h>
 #include <glib.h>
 #include "screen.h"
 #include "client.h"
@@ -52,6 +53,8 @@ void                     clientLower                            (Client *,
                                                                  Window);
 gboolean                 clientAdjustFullscreenLayer            (Client *,
                                                                  gboolean);
+void                     clientSetStackingLayer                 (Client *,
+                                                                 guint);
 void                     clientAddToList                        (Client *);
 void                     clientRemoveFromList                   (Client *);
 GList                   *clientGetStackList                     (ScreenInfo *);
@@ -60,5 +63,7 @@ Client                  *clientGetLastRaise                     (ScreenInfo *);
 void                     clientClearLastRaise                   (ScreenInfo *);
 void                     clientClearDelayedRaise                (void);
 void                     clientResetDelayedRaise                (ScreenInfo *);
+void                     clientDumpStacking                     (DisplayInfo *,
+                                                                 FILE *);
 
 #endif /* INC_STACKING_H */
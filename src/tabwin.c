@@ -383,7 +383,7 @@ getMinMonitorWidth (ScreenInfo *screen_info)
     for (min_width = i = 0; i < num_monitors; i++)
     {
         GdkRectangle monitor;
-        gdk_screen_get_monitor_geometry (screen_info->gscr, i, &monitor);
+        myScreenGetMonitorGeometry (screen_info, i, &monitor);
         if (min_width == 0 || monitor.width < min_width)
             min_width = monitor.width;
     }
@@ -397,7 +397,7 @@ getMinMonitorHeight (ScreenInfo *screen_info)
     for (min_height = i = 0; i < num_monitors; i++)
     {
         GdkRectangle monitor;
-        gdk_screen_get_monitor_geometry (screen_info->gscr, i, &monitor);
+        myScreenGetMonitorGeometry (screen_info, i, &monitor);
         if (min_height == 0 || monitor.height < min_height)
         {
             min_height = monitor.height;
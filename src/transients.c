@@ -295,7 +295,7 @@ clientGetModalFor (Client * c)
     TRACE ("entering clientGetModalFor");
 
     screen_info = c->screen_info;
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
     {
         c2 = (Client *) list->data;
         if (c2)
@@ -322,7 +322,7 @@ clientGetTransientFor (Client * c)
 
     latest_transient = c;
     screen_info = c->screen_info;
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
     {
         if (!clientIsTransient (latest_transient))
         {
@@ -341,86 +341,206 @@ clientGetTransientFor (Client * c)
     return latest_transient;
 }
 
-/* Build a GList of clients that have a transient relationship */
-GList *
-clientListTransient (Client * c)
+static void
+index_remove (GHashTable *index, Window key, Client *c)
+{
+    GList *list;
+
+    list = g_hash_table_lookup (index, (gconstpointer) key);
+    list = g_list_remove (list, c);
+    if (list)
+    {
+        g_hash_table_insert (index, (gpointer) key, list);
+    }
+    else
+    {
+        g_hash_table_remove (index, (gconstpointer) key);
+    }
+}
+
+static void
+index_add (GHashTable *index, Window key, Client *c)
+{
+    GList *list;
+
+    list = g_hash_table_lookup (index, (gconstpointer) key);
+    g_hash_table_insert (index, (gpointer) key, g_list_prepend (list, c));
+}
+
+/*
+ * File the client under the window it is transient for, or if it is
+ * transient for its group, under its group leader as well as under its
+ * own window (in case another client uses it as leader), so that the
+ * transients of a window are found without looking at every client.
+ * Must be called whenever transient_for or group_leader change.
+ */
+void
+clientUpdateTransientRelations (Client * c)
 {
     ScreenInfo *screen_info;
-    Client *c2, *c3;
-    GList *transients;
-    GList *list1, *list2;
 
-    g_return_val_if_fail (c != NULL, NULL);
+    g_return_if_fail (c != NULL);
+
+    TRACE ("entering clientUpdateTransientRelations");
 
-    transients = NULL;
     screen_info = c->screen_info;
-    transients = g_list_append (transients, c);
-    for (list1 = screen_info->windows_stack; list1; list1 = g_list_next (list1))
+    if (c->transient_key != None)
+    {
+        index_remove (screen_info->transients_by_parent, c->transient_key, c);
+        c->transient_key = None;
+    }
+    if (c->group_key != None)
     {
-        c2 = (Client *) list1->data;
-        if (c2 != c)
+        index_remove (screen_info->transients_by_group, c->group_key, c);
+        if (c->group_key != c->window)
         {
-            if (clientIsTransientFor (c2, c))
-            {
-                transients = g_list_append (transients, c2);
-            }
-            else
-            {
-                for (list2 = transients; list2;
-                    list2 = g_list_next (list2))
-                {
-                    c3 = (Client *) list2->data;
-                    if ((c3 != c2) && clientIsTransientFor (c2, c3))
-                    {
-                        transients = g_list_append (transients, c2);
-                        break;
-                    }
-                }
-            }
+            index_remove (screen_info->transients_by_group, c->window, c);
+        }
+        c->group_key = None;
+    }
+
+    if (!FLAG_TEST (c->xfwm_flags, XFWM_FLAG_MANAGED))
+    {
+        return;
+    }
+
+    if ((c->transient_for != None) && (c->transient_for != screen_info->xroot) && (c->transient_for != c->window))
+    {
+        c->transient_key = c->transient_for;
+        index_add (screen_info->transients_by_parent, c->transient_key, c);
+    }
+    else if (c->transient_for == screen_info->xroot)
+    {
+        c->group_key = (c->group_leader != None) ? c->group_leader : c->window;
+        index_add (screen_info->transients_by_group, c->group_key, c);
+        if (c->group_key != c->window)
+        {
+            index_add (screen_info->transients_by_group, c->window, c);
         }
     }
-    return transients;
 }
 
-/* Build a GList of clients that have a transient or modal relationship */
-GList *
-clientListTransientOrModal (Client * c)
+static void
+mark_candidates (Client *c, GList *candidates, GQueue *pending, guint mark)
 {
-    ScreenInfo *screen_info;
-    Client *c2, *c3;
-    GList *transients;
-    GList *list1, *list2;
+    GList *list;
+    Client *c2;
 
-    g_return_val_if_fail (c != NULL, NULL);
+    for (list = candidates; list; list = g_list_next (list))
+    {
+        c2 = (Client *) list->data;
+        if ((c2->transient_mark != mark) && clientIsTransientFor (c2, c))
+        {
+            c2->transient_mark = mark;
+            g_queue_push_tail (pending, c2);
+        }
+    }
+}
+
+static gint
+compare_stack_keys (gconstpointer a, gconstpointer b)
+{
+    const Client *c1 = a;
+    const Client *c2 = b;
+
+    if (c1->stack_key < c2->stack_key)
+    {
+        return -1;
+    }
+    return (c1->stack_key > c2->stack_key) ? 1 : 0;
+}
+
+/*
+ * Collect the transients of the client, recursively, each one once
+ * thanks to a new mark.
+ */
+static GList *
+collect_transients (Client * c)
+{
+    static guint transient_mark = 0;
+    ScreenInfo *screen_info;
+    GQueue pending;
+    GList *found;
+    Client *c1;
+    guint mark;
 
     screen_info = c->screen_info;
-    transients = NULL;
-    transients = g_list_append (transients, c);
-    for (list1 = screen_info->windows_stack; list1; list1 = g_list_next (list1))
+    if (++transient_mark == 0)
+    {
+        ++transient_mark;
+    }
+    mark = transient_mark;
+
+    g_queue_init (&pending);
+    c->transient_mark = mark;
+    g_queue_push_tail (&pending, c);
+    found = NULL;
+
+    while ((c1 = g_queue_pop_head (&pending)))
     {
-        c2 = (Client *) list1->data;
-        if (c2 != c)
+        if (c1 != c)
         {
-            if (clientIsTransientOrModalFor (c2, c))
+            found = g_list_prepend (found, c1);
+        }
+        mark_candidates (c1, g_hash_table_lookup (screen_info->transients_by_parent,
+                                                  (gconstpointer) c1->window),
+                         &pending, mark);
+        /* Transients for group don't apply to other transients */
+        if (c1->transient_for == None)
+        {
+            if (c1->group_leader != None)
             {
-                transients = g_list_append (transients, c2);
+                mark_candidates (c1, g_hash_table_lookup (screen_info->transients_by_group,
+                                                          (gconstpointer) c1->group_leader),
+                                 &pending, mark);
             }
-            else
+            if (c1->group_leader != c1->window)
             {
-                for (list2 = transients; list2;
-                    list2 = g_list_next (list2))
-                {
-                    c3 = (Client *) list2->data;
-                    if ((c3 != c2) && clientIsTransientOrModalFor (c2, c3))
-                    {
-                        transients = g_list_append (transients, c2);
-                        break;
-                    }
-                }
+                mark_candidates (c1, g_hash_table_lookup (screen_info->transients_by_group,
+                                                          (gconstpointer) c1->window),
+                                 &pending, mark);
             }
         }
     }
-    return transients;
+
+    return found;
+}
+
+/*
+ * Build a GList of clients that have a transient relationship, the client
+ * itself first, then its transients in stacking order.
+ */
+GList *
+clientListTransient (Client * c)
+{
+    GList *transients;
+
+    g_return_val_if_fail (c != NULL, NULL);
+
+    TRACE ("entering clientListTransient");
+
+    transients = collect_transients (c);
+    if (transients)
+    {
+        transients = g_list_sort (transients, compare_stack_keys);
+    }
+
+    return g_list_prepend (transients, c);
+}
+
+/*
+ * Build a GList of clients that have a transient or modal relationship,
+ * since being modal for a window requires being transient for it, that is
+ * the same list.
+ */
+GList *
+clientListTransientOrModal (Client * c)
+{
+    g_return_val_if_fail (c != NULL, NULL);
+
+    TRACE ("entering clientListTransientOrModal");
+
+    return clientListTransient (c);
 }
 
 /* Check if a window is not already listed in transients of a client.
@@ -60,4 +60,5 @@ GList                   *clientListTransient                    (Client *);
 GList                   *clientListTransientOrModal             (Client *);
 gboolean                 clientCheckTransientWindow             (Client *,
                                                                  Window);
+void                     clientUpdateTransientRelations         (Client *);
 #endif /* INC_TRANSIENTS_H */
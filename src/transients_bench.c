@@ -0,0 +1,281 @@
+/*      $Id$
+
+        This program is free software; you can redistribute it and/or modify
+        it under the terms of the GNU General Public License as published by
+        the Free Software Foundation; either version 2, or (at your option)
+        any later version.
+
+        This program is distributed in the hope that it will be useful,
+        but WITHOUT ANY WARRANTY; without even the implied warranty of
+        MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+        GNU General Public License for more details.
+
+        You should have received a copy of the GNU General Public License
+        along with this program; if not, write to the Free Software
+        Foundation, Inc., Inc., 51 Franklin Street, Fifth Floor, Boston,
+        MA 02110-1301, USA.
+
+
+        xfwm4    - (c) 2002-2015 Olivier Fourdan
+
+ */
+
+/*
+ * transients-bench links transients.c alone and lists the transients of
+ * every window of IDE-like sessions, each application a main window with
+ * dozens of dialogs, some transient for the main window, some for the
+ * group, some for another dialog and some modal:
+ *
+ *   ./transients-bench --dialogs=24 --iterations=100
+ *
+ * The clients only have what transients.c looks at, and the only lookup
+ * it needs from screen.c is provided here. The lists are timed and
+ * compared with the former scan of the whole stack, which gives the same
+ * result as long as dialogs are stacked above what they are transient
+ * for, as they are here. The exit status is non zero if any list differs,
+ * "make check" runs it with the defaults.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <glib.h>
+
+#include "screen.h"
+#include "client.h"
+#include "transients.h"
+
+#define BENCH_ROOT 1
+
+static gint dialogs = 24;
+static gint iterations = 100;
+static guint failures = 0;
+static GHashTable *bench_windows = NULL;
+
+Client *
+myScreenGetClientFromWindow (ScreenInfo *screen_info, Window w, unsigned short mode)
+{
+    return g_hash_table_lookup (bench_windows, (gconstpointer) w);
+}
+
+/* The former clientListTransient(), walking the stack and the result */
+static GList *
+list_transient_scan (Client *c)
+{
+    GList *transients;
+    GList *list1, *list2;
+    Client *c2, *c3;
+
+    transients = g_list_append (NULL, c);
+    for (list1 = c->screen_info->windows_stack; list1; list1 = g_list_next (list1))
+    {
+        c2 = (Client *) list1->data;
+        if (c2 == c)
+        {
+            continue;
+        }
+        if (clientIsTransientFor (c2, c))
+        {
+            transients = g_list_append (transients, c2);
+            continue;
+        }
+        for (list2 = transients; list2; list2 = g_list_next (list2))
+        {
+            c3 = (Client *) list2->data;
+            if ((c3 != c2) && clientIsTransientFor (c2, c3))
+            {
+                transients = g_list_append (transients, c2);
+                break;
+            }
+        }
+    }
+    return transients;
+}
+
+static void
+bench_client (ScreenInfo *screen_info, Client *c, Window w, Window transient_for,
+              Window group_leader, guint type, gboolean modal)
+{
+    c->screen_info = screen_info;
+    c->window = w;
+    c->transient_for = transient_for;
+    c->group_leader = group_leader;
+    c->type = type;
+    c->serial = w;
+    c->stack_key = w;
+    if (modal)
+    {
+        FLAG_SET (c->flags, CLIENT_FLAG_STATE_MODAL);
+    }
+    FLAG_SET (c->xfwm_flags, XFWM_FLAG_MANAGED);
+
+    g_hash_table_insert (bench_windows, (gpointer) w, c);
+    screen_info->windows_stack = g_list_prepend (screen_info->windows_stack, c);
+}
+
+static void
+bench_session (guint apps)
+{
+    ScreenInfo *screen_info;
+    Client *clients, *main_window, *c;
+    GList *found, *expected, *l1, *l2;
+    gint64 start, update_time, index_time, scan_time;
+    guint n, i, j, k;
+    gint iter;
+    Window w;
+
+    n = apps * (dialogs + 2);
+    clients = g_new0 (Client, n);
+    screen_info = g_new0 (ScreenInfo, 1);
+    screen_info->xroot = BENCH_ROOT;
+    screen_info->transients_by_parent = g_hash_table_new (g_direct_hash, g_direct_equal);
+    screen_info->transients_by_group = g_hash_table_new (g_direct_hash, g_direct_equal);
+    bench_windows = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    /* Stacked application by application, each dialog above its parent */
+    k = 0;
+    w = BENCH_ROOT;
+    for (i = 0; i < apps; i++)
+    {
+        main_window = &clients[k++];
+        w++;
+        bench_client (screen_info, main_window, w, None, w, WINDOW_NORMAL, FALSE);
+        for (j = 0; j < (guint) dialogs; j++)
+        {
+            c = &clients[k++];
+            switch (j % 3)
+            {
+                case 0:
+                    bench_client (screen_info, c, ++w, main_window->window,
+                                  main_window->window, WINDOW_DIALOG, (j % 4) == 0);
+                    break;
+                case 1:
+                    bench_client (screen_info, c, ++w, BENCH_ROOT,
+                                  main_window->window, WINDOW_DIALOG, (j % 4) == 0);
+                    break;
+                default:
+                    bench_client (screen_info, c, ++w, c[-1].window,
+                                  main_window->window, WINDOW_DIALOG, (j % 4) == 0);
+                    break;
+            }
+        }
+        /* And a window of some other application */
+        bench_client (screen_info, &clients[k++], ++w, None, None, WINDOW_NORMAL, FALSE);
+    }
+    screen_info->windows_stack = g_list_reverse (screen_info->windows_stack);
+
+    start = g_get_monotonic_time ();
+    for (iter = 0; iter < iterations; iter++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            clientUpdateTransientRelations (&clients[i]);
+        }
+    }
+    update_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    for (iter = 0; iter < iterations; iter++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            g_list_free (clientListTransient (&clients[i]));
+        }
+    }
+    index_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    for (iter = 0; iter < iterations; iter++)
+    {
+        for (i = 0; i < n; i++)
+        {
+            g_list_free (list_transient_scan (&clients[i]));
+        }
+    }
+    scan_time = g_get_monotonic_time () - start;
+
+    for (i = 0; i < n; i++)
+    {
+        found = clientListTransient (&clients[i]);
+        expected = list_transient_scan (&clients[i]);
+        for (l1 = found, l2 = expected; l1 && l2; l1 = g_list_next (l1), l2 = g_list_next (l2))
+        {
+            if (l1->data != l2->data)
+            {
+                break;
+            }
+        }
+        if (l1 || l2)
+        {
+            if (failures++ < 20)
+            {
+                g_printerr ("FAILED: transients of 0x%lx, %u listed instead of %u\n",
+                            clients[i].window, g_list_length (found), g_list_length (expected));
+            }
+        }
+        g_list_free (found);
+        g_list_free (expected);
+    }
+
+    g_print ("%5u %8u %12.3f %12.3f %12.3f\n", apps, n,
+             (gdouble) update_time / (iterations * n),
+             (gdouble) index_time / (iterations * n),
+             (gdouble) scan_time / (iterations * n));
+
+    g_list_free (screen_info->windows_stack);
+    g_hash_table_destroy (screen_info->transients_by_parent);
+    g_hash_table_destroy (screen_info->transients_by_group);
+    g_hash_table_destroy (bench_windows);
+    g_free (screen_info);
+    g_free (clients);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    guint apps;
+    GOptionEntry option_entries[] =
+    {
+        { "dialogs", 'd', 0, G_OPTION_ARG_INT, &dialogs, "Dialogs per application (default 24)", "N" },
+        { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Iterations over the windows (default 100)", "N" },
+        { NULL }
+    };
+
+    context = g_option_context_new (NULL);
+    g_option_context_add_main_entries (context, option_entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    if ((argc != 1) || (dialogs < 0) || (iterations <= 0))
+    {
+        g_printerr ("Usage: %s [--dialogs=N] [--iterations=N]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    g_print ("%5s %8s %12s %12s %12s\n", "apps", "windows", "update", "index", "scan");
+    for (apps = 1; apps <= 32; apps *= 2)
+    {
+        bench_session (apps);
+    }
+    g_print ("usec per window\n");
+
+    if (failures)
+    {
+        g_printerr ("%u lists differ\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
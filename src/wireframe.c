@@ -159,6 +159,23 @@ wireframeDrawCairo (WireFrame *wireframe, int width, int height)
                             wireframe->width, wireframe->height);
 }
 
+static gboolean
+wireframeDrawCompositor (WireFrame *wireframe, int width, int height)
+{
+    XRectangle rect;
+
+    rect.x = wireframe->x;
+    rect.y = wireframe->y;
+    rect.width = width;
+    rect.height = height;
+    wireframe->width = width;
+    wireframe->height = height;
+
+    return compositorSetOutline (wireframe->screen_info, &rect, OUTLINE_WIDTH,
+                                 wireframe->red, wireframe->green, wireframe->blue,
+                                 wireframe->alpha);
+}
+
 void
 wireframeUpdate (Client *c, WireFrame *wireframe)
 {
@@ -172,7 +189,12 @@ wireframeUpdate (Client *c, WireFrame *wireframe)
     wireframe->y = frameExtentY (c);
 
     screen_info = wireframe->screen_info;
-    if (compositorIsActive (screen_info))
+    if (wireframe->xwindow == None)
+    {
+         /* Painted by the compositor, no X request besides the damage */
+         wireframeDrawCompositor (wireframe, frameExtentWidth (c), frameExtentHeight (c));
+    }
+    else if (compositorIsActive (screen_info))
     {
          wireframeDrawCairo (wireframe, frameExtentWidth (c), frameExtentHeight (c));
     }
@@ -231,6 +253,20 @@ wireframeCreate (Client *c)
     wireframe->cr = NULL;
     wireframe->surface = NULL;
     wireframe->alpha = (compositorIsActive (screen_info) ? 0.5 : 1.0);
+    wireframe->xwindow = None;
+
+    if (compositorIsActive (screen_info))
+    {
+        wireframeInitColor (wireframe);
+
+        /* No need for a window if the compositor can draw the outline itself */
+        wireframe->x = frameExtentX (c);
+        wireframe->y = frameExtentY (c);
+        if (wireframeDrawCompositor (wireframe, frameExtentWidth (c), frameExtentHeight (c)))
+        {
+            return (wireframe);
+        }
+    }
 
     if (compositorIsActive (screen_info) &&
         XMatchVisualInfo (myScreenGetXDisplay (screen_info), screen_info->screen,
@@ -265,7 +301,6 @@ wireframeCreate (Client *c)
     if (compositorIsActive (screen_info))
     {
         /* Cairo */
-        wireframeInitColor (wireframe);
         wireframe->surface = cairo_xlib_surface_create (myScreenGetXDisplay (screen_info),
                                                         wireframe->xwindow, xvisual,
                                                         frameExtentWidth (c), frameExtentHeight (c));
@@ -288,6 +323,13 @@ wireframeDelete (WireFrame *wireframe)
     TRACE ("entering wireframeDelete");
 
     screen_info = wireframe->screen_info;
+    if (wireframe->xwindow == None)
+    {
+        compositorClearOutline (screen_info);
+        g_free (wireframe);
+        return;
+    }
+
     XUnmapWindow (myScreenGetXDisplay (screen_info), wireframe->xwindow);
     if (wireframe->cr)
     {
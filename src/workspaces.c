@@ -45,6 +45,7 @@
 #include "focus.h"
 #include "stacking.h"
 #include "hints.h"
+#include "placement.h"
 
 static void
 workspaceGetPosition (ScreenInfo *screen_info, int n, int * row, int * col)
@@ -243,9 +244,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     Client *c, *new_focus;
     Client *previous;
     GList *list;
-    Window dr, window;
-    gint rx, ry, wx, wy;
-    unsigned int mask;
+    gint rx, ry;
 
     g_return_if_fail (screen_info != NULL);
 
@@ -303,7 +302,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     }
 
     /* First pass: Show, from top to bottom */
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
     {
         c = (Client *) list->data;
         if (FLAG_TEST (c->flags, CLIENT_FLAG_STICKY))
@@ -345,7 +344,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     }
 
     /* Third pass: Check for focus, from top to bottom */
-    for (list = g_list_last(screen_info->windows_stack); list; list = g_list_previous (list))
+    for (list = screen_info->windows_stack_top; list; list = g_list_previous (list))
     {
         c = (Client *) list->data;
 
@@ -370,7 +369,7 @@ workspaceSwitch (ScreenInfo *screen_info, gint new_ws, Client * c2, gboolean upd
     setNetCurrentDesktop (display_info, screen_info->xroot, new_ws);
     if (!(screen_info->params->click_to_focus))
     {
-        if (!(c2) && (XQueryPointer (myScreenGetXDisplay (screen_info), screen_info->xroot, &dr, &window, &rx, &ry, &wx, &wy, &mask)))
+        if (!(c2) && (myDisplayGetPointer (display_info, screen_info->xroot, &rx, &ry, NULL)))
         {
             c = clientAtPosition (screen_info, rx, ry, NULL);
             if (c)
@@ -520,8 +519,10 @@ void
 workspaceUpdateArea (ScreenInfo *screen_info)
 {
     DisplayInfo *display_info;
+    GArray *all_struts;
+    GeometryStruts *struts;
     Client *c;
-    GdkRectangle top, left, right, bottom, workarea;
+    GdkRectangle workarea;
     int prev_top;
     int prev_left;
     int prev_right;
@@ -548,44 +549,45 @@ workspaceUpdateArea (ScreenInfo *screen_info)
 
     gdk_screen_get_monitor_geometry (screen_info->gscr, gdk_screen_get_primary_monitor(screen_info->gscr), &workarea);
 
-    for (c = screen_info->clients, i = 0; i < screen_info->client_count; c = c->next, i++)
-    {
-        if (strutsToRectangles (c, &left, &right, &top, &bottom))
+    all_struts = clientGetVisibleStruts (screen_info);
+    for (i = 0; i < all_struts->len; i++)
+    {
+        struts = &g_array_index (all_struts, GeometryStruts, i);
+        c = (Client *) struts->data;
+
+        /*
+         * NET_WORKAREA doesn't support L shaped displays at all.
+         * gdk works around this by ignoring it unless dealing with
+         * the primary monitor.
+         * Mimic this behaviour by ignoring struts not on the primary
+         * display when calculating NET_WORKAREA
+         */
+        if (geometryStrutsValid (&struts->left, &workarea, STRUTS_LEFT) &&
+            gdk_rectangle_intersect (&struts->left, &workarea, NULL))
         {
-            /*
-             * NET_WORKAREA doesn't support L shaped displays at all.
-             * gdk works around this by ignoring it unless dealing with
-             * the primary monitor.
-             * Mimic this behaviour by ignoring struts not on the primary
-             * display when calculating NET_WORKAREA
-             */
-            if (checkValidStruts (&left, &workarea, STRUTS_LEFT) &&
-                gdk_rectangle_intersect (&left, &workarea, NULL))
-            {
-                screen_info->margins[STRUTS_LEFT] = MAX(screen_info->margins[STRUTS_LEFT],
-                                                         c->struts[STRUTS_LEFT]);
-            }
+            screen_info->margins[STRUTS_LEFT] = MAX(screen_info->margins[STRUTS_LEFT],
+                                                     c->struts[STRUTS_LEFT]);
+        }
 
-            if (checkValidStruts (&right, &workarea, STRUTS_RIGHT) &&
-                gdk_rectangle_intersect (&right, &workarea, NULL))
-            {
-                screen_info->margins[STRUTS_RIGHT] = MAX(screen_info->margins[STRUTS_RIGHT],
-                                                         c->struts[STRUTS_RIGHT]);
-            }
+        if (geometryStrutsValid (&struts->right, &workarea, STRUTS_RIGHT) &&
+            gdk_rectangle_intersect (&struts->right, &workarea, NULL))
+        {
+            screen_info->margins[STRUTS_RIGHT] = MAX(screen_info->margins[STRUTS_RIGHT],
+                                                     c->struts[STRUTS_RIGHT]);
+        }
 
-            if (checkValidStruts (&top, &workarea, STRUTS_TOP) &&
-                gdk_rectangle_intersect (&top, &workarea, NULL))
-            {
-                screen_info->margins[STRUTS_TOP] = MAX(screen_info->margins[STRUTS_TOP],
-                                                       c->struts[STRUTS_TOP]);
-            }
+        if (geometryStrutsValid (&struts->top, &workarea, STRUTS_TOP) &&
+            gdk_rectangle_intersect (&struts->top, &workarea, NULL))
+        {
+            screen_info->margins[STRUTS_TOP] = MAX(screen_info->margins[STRUTS_TOP],
+                                                   c->struts[STRUTS_TOP]);
+        }
 
-            if (checkValidStruts (&bottom, &workarea, STRUTS_BOTTOM) ||
-                gdk_rectangle_intersect (&bottom, &workarea, NULL))
-            {
-                screen_info->margins[STRUTS_BOTTOM] = MAX(screen_info->margins[STRUTS_BOTTOM],
-                                                          c->struts[STRUTS_BOTTOM]);
-            }
+        if (geometryStrutsValid (&struts->bottom, &workarea, STRUTS_BOTTOM) ||
+            gdk_rectangle_intersect (&struts->bottom, &workarea, NULL))
+        {
+            screen_info->margins[STRUTS_BOTTOM] = MAX(screen_info->margins[STRUTS_BOTTOM],
+                                                      c->struts[STRUTS_BOTTOM]);
         }
     }
 
@@ -268,4 +268,69 @@ clientXSyncUpdateValue (Client *c, XSyncValue value)
     clientXSyncClearTimeout (c);
 }
 
+/*
+ * Extended counter only: the client sets the counter to an odd value when it
+ * starts drawing a frame and to an even value once the frame is complete.
+ */
+gboolean
+clientXSyncFrameComplete (Client *c)
+{
+    g_return_val_if_fail (c != NULL, FALSE);
+
+    return (FLAG_TEST (c->flags, CLIENT_FLAG_XSYNC_EXT_COUNTER) &&
+            (XSyncValueLow32 (c->xsync_value) % 2 == 0));
+}
+
+void
+clientXSyncFrameDrawn (Client *c, XSyncValue value, gint64 drawn_time)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    XClientMessageEvent xev;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("entering clientXSyncFrameDrawn");
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    xev.type = ClientMessage;
+    xev.window = c->window;
+    xev.message_type = display_info->atoms[NET_WM_FRAME_DRAWN];
+    xev.format = 32;
+    xev.data.l[0] = (long) XSyncValueLow32 (value);
+    xev.data.l[1] = (long) XSyncValueHigh32 (value);
+    /* Same clock as g_get_monotonic_time () in the client */
+    xev.data.l[2] = (long) (drawn_time & G_GINT64_CONSTANT (0xffffffff));
+    xev.data.l[3] = (long) (drawn_time >> 32);
+    xev.data.l[4] = 0;
+    XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+}
+
+void
+clientXSyncFrameTimings (Client *c, XSyncValue value, gint32 presentation_offset, gint32 refresh_interval)
+{
+    ScreenInfo *screen_info;
+    DisplayInfo *display_info;
+    XClientMessageEvent xev;
+
+    g_return_if_fail (c != NULL);
+    TRACE ("entering clientXSyncFrameTimings");
+
+    screen_info = c->screen_info;
+    display_info = screen_info->display_info;
+
+    /* Zero means unknown for both the presentation offset and the refresh interval */
+    xev.type = ClientMessage;
+    xev.window = c->window;
+    xev.message_type = display_info->atoms[NET_WM_FRAME_TIMINGS];
+    xev.format = 32;
+    xev.data.l[0] = (long) XSyncValueLow32 (value);
+    xev.data.l[1] = (long) XSyncValueHigh32 (value);
+    xev.data.l[2] = (long) presentation_offset;
+    xev.data.l[3] = (long) refresh_interval;
+    xev.data.l[4] = 0;
+    XSendEvent (display_info->dpy, c->window, FALSE, NoEventMask, (XEvent *) &xev);
+}
+
 #endif /* HAVE_XSYNC */
@@ -52,6 +52,14 @@ void                     clientXSyncClearTimeout                (Client *);
 void                     clientXSyncRequest                     (Client *);
 void                     clientXSyncUpdateValue                 (Client *,
                                                                  XSyncValue);
+gboolean                 clientXSyncFrameComplete               (Client *);
+void                     clientXSyncFrameDrawn                  (Client *,
+                                                                 XSyncValue,
+                                                                 gint64);
+void                     clientXSyncFrameTimings                (Client *,
+                                                                 XSyncValue,
+                                                                 gint32,
+                                                                 gint32);
 
 #endif /* HAVE_XSYNC */
 